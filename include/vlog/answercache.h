@@ -0,0 +1,81 @@
+#ifndef _ANSWER_CACHE_H
+#define _ANSWER_CACHE_H
+
+#include <vlog/concepts.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class TupleTable;
+
+//Complete answers of the queries evaluated by the reasoner. A query is
+//served by the entry of the same query or of a more general one, whose
+//rows are filtered. The entries are computed from the EDB layer that owns
+//the cache, so they are all dropped when its content changes. The size is
+//bounded by a number of terms, and the least recently used entries go
+//first.
+class AnswerCache {
+private:
+    struct Entry {
+        uint64_t program; //Program::getId()
+        //Positions and values of the constants of the query
+        std::vector<std::pair<uint8_t, Term_t>> consts;
+        uint8_t arity;
+        std::shared_ptr<const std::vector<Term_t>> rows; //rows[i * arity + j]
+        uint64_t lastUsed;
+    };
+
+    boost::mutex mutex;
+    std::unordered_map<PredId_t, std::vector<Entry>> entries;
+    size_t maxTerms;
+    size_t nTerms;
+    uint64_t clock;
+    std::atomic<uint64_t> hits, misses;
+
+    static std::vector<std::pair<uint8_t, Term_t>> getConstants(
+                const Literal &query);
+
+    //Removes the least recently used entry
+    void evict();
+
+public:
+    AnswerCache() : maxTerms(0), nTerms(0), clock(0), hits(0), misses(0) {}
+
+    //0, the default, disables the cache
+    void setCapacity(const size_t maxTerms);
+
+    bool isEnabled() {
+        return maxTerms > 0;
+    }
+
+    //Same format as QSQR::evaluateQuery: only the variables of query if
+    //onlyVars is set, otherwise the whole tuples. NULL if no entry
+    //subsumes query
+    TupleTable *get(const Program *program, const Literal &query,
+                    std::vector<uint8_t> *posJoins,
+                    std::vector<Term_t> *possibleValuesJoins,
+                    const bool onlyVars);
+
+    //answers must contain all the answers of query, in the format of get.
+    //Queries with repeated variables are not stored
+    void add(const Program *program, const Literal &query,
+             TupleTable *answers, const bool onlyVars);
+
+    void invalidate();
+
+    uint64_t getHits() const {
+        return hits;
+    }
+
+    uint64_t getMisses() const {
+        return misses;
+    }
+
+    ~AnswerCache();
+};
+
+#endif
@@ -4,8 +4,12 @@
 #include <vlog/concepts.h>
 #include <trident/model/table.h>
 
+#include <boost/thread/mutex.hpp>
+
+#include <atomic>
 #include <unordered_set>
 #include <functional>
+#include <memory>
 #include <boost/functional/hash.hpp>
 
 struct BindingsRow {
@@ -19,40 +23,6 @@ struct BindingsRow {
     bool operator==(const BindingsRow &other) const;
 };
 
-struct hash_BindingsRow {
-    size_t operator()(const BindingsRow &x) const {
-	size_t hash = 0;
-        for (uint8_t i = 0; i < x.size; ++i) {
-	    hash = (hash + (324723947 + x.row[i])) ^93485734985;
-	}
-	return hash;
-	/*
-        uint64_t h = 0;
-        std::hash<uint64_t> hashf;
-        for (uint8_t i = 0; i < x.size; ++i) {
-	    h = (h << 16) ^ ((h & 0xffff000000000000) >> 48);
-	    h = h ^ x.row[i];
-	}
-	return hashf(h);
-	*/
-	/*
-	size_t v = 0;
-        for (uint8_t i = 0; i < x.size; ++i) {
-	    boost::hash_combine(v, (uint32_t) x.row[i]);
-        }
-        return v;
-	*/
-	/*
-        std::hash<uint64_t> hashf;
-	size_t h = 0;
-        for (uint8_t i = 0; i < x.size; ++i) {
-	    h += hashf(x.row[i]);
-	}
-	return h;
-	*/
-    }
-};
-
 class RawBindings {
 private:
     const uint8_t sizeArray;
@@ -107,7 +77,39 @@ public:
 
 class BindingsTable {
 private:
-    std::unordered_set<BindingsRow, hash_BindingsRow> uniqueElements;
+    //Open addressing index of the unique rows in rawBindings. The rows are
+    //stored in insertion order, so the i-th unique row is at offset
+    //i * nPosToCopy
+    struct HashSlot {
+        size_t row; //(size_t) -1 if the slot is free
+        size_t hash;
+    };
+    std::vector<HashSlot> slots;
+    size_t nUniqueRows;
+    //The rows, in insertion order, are sorted on the fields 0 ..
+    //nSortedFields - 1
+    size_t nSortedFields;
+
+    //Only set if the table is shared by the threads of a concurrent QSQ-R
+    //evaluation. The rows are never moved, so a row can be read without
+    //the lock once it was returned
+    std::unique_ptr<boost::mutex> mutex;
+
+    //If set, counts the unique rows added to the table
+    std::atomic<size_t> *counter;
+
+    struct Lock {
+        boost::mutex *m;
+        Lock(boost::mutex *m) : m(m) {
+            if (m != NULL)
+                m->lock();
+        }
+        ~Lock() {
+            if (m != NULL)
+                m->unlock();
+        }
+    };
+
     RawBindings *rawBindings;
     Term_t *currentRow;
 
@@ -135,6 +137,26 @@ private:
         }
     };
 
+    static size_t hashRow(Term_t const * const row, const size_t size) {
+        //Every term is mixed on its own and the results are only combined
+        //with a xor, so that the loop can be vectorized. The position is
+        //added to the term before the mixing, so that the order matters
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+        for (size_t i = 0; i < size; ++i) {
+            uint64_t t = (uint64_t) row[i] + i * 0x9E3779B97F4A7C15ull;
+            t ^= t >> 32;
+            t *= 0xff51afd7ed558ccdull;
+            t ^= t >> 29;
+            h ^= t;
+        }
+        h ^= h >> 32;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 29;
+        return (size_t) h;
+    }
+
+    void resizeIndex(const size_t capacity);
+
     void insertIfNotExists(Term_t const * const cr);
 public:
     BindingsTable(uint8_t sizeAdornment, uint8_t adornment);
@@ -143,6 +165,14 @@ public:
 
     BindingsTable(uint8_t sizeTuple, std::vector<int> posToCopy);
 
+    void setConcurrent() {
+        mutex = std::unique_ptr<boost::mutex>(new boost::mutex());
+    }
+
+    void setCounter(std::atomic<size_t> *counter) {
+        this->counter = counter;
+    }
+
     void addTuple(const Literal *t);
 
 #if ! TERM_IS_UINT64
@@ -158,12 +188,20 @@ public:
 
     void addRawTuple(Term_t *row);
 
+    //Makes room for n more unique rows, so that the index is not rebuilt
+    //while they are added
+    void reserve(const size_t n);
+
     std::vector<Term_t> getProjection(std::vector<uint8_t> pos);
 
     std::vector<Term_t> getUniqueSortedProjection(std::vector<uint8_t> pos);
 
     size_t getNTuples();
 
+    //True if the rows are already in the order of fields. Then sortBy
+    //only copies them
+    bool isSortedBy(const std::vector<uint8_t> &fields);
+
     TupleTable *sortBy(std::vector<uint8_t> &fields);
 
     TupleTable *projectAndFilter(const Literal &l, const std::vector<uint8_t> *posToFilter,
@@ -0,0 +1,62 @@
+#ifndef _CARD_CACHE_H
+#define _CARD_CACHE_H
+
+#include <vlog/concepts.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+//Number of independently locked parts of the cache
+#define CARD_CACHE_NSHARDS 64
+
+//Cardinalities of the EDB literals. The planner asks for the same literals
+//many times, and some tables answer slowly or under a lock. The entries
+//of a predicate are dropped when its content changes.
+class CardinalityCache {
+public:
+    //Kinds of cardinality. The others are the positions of the columns
+    static const int EXACT = -1;
+    static const int ESTIMATE = -2;
+
+private:
+    struct Shard {
+        boost::mutex mutex;
+        std::unordered_map<PredId_t,
+            std::unordered_map<std::string, size_t>> values;
+    };
+
+    Shard shards[CARD_CACHE_NSHARDS];
+    std::atomic<uint64_t> hits, misses;
+
+    //Constants and the pattern of the variables, which are renamed in
+    //order of appearance
+    static std::string key(const Literal &query, const int kind);
+
+    Shard &getShard(const PredId_t predid) {
+        return shards[predid % CARD_CACHE_NSHARDS];
+    }
+
+public:
+    CardinalityCache() : hits(0), misses(0) {}
+
+    bool get(const Literal &query, const int kind, size_t &card);
+
+    void add(const Literal &query, const int kind, const size_t card);
+
+    void invalidate(const PredId_t predid);
+
+    uint64_t getHits() const {
+        return hits;
+    }
+
+    uint64_t getMisses() const {
+        return misses;
+    }
+
+    ~CardinalityCache();
+};
+
+#endif
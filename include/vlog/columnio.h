@@ -0,0 +1,33 @@
+#ifndef _COLUMNIO_H
+#define _COLUMNIO_H
+
+#include <vlog/segment.h>
+#include <vlog/fcinttable.h>
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+//Number of terms compressed together in one LZ4 frame
+#define COLUMNIO_CHUNK (1 << 20)
+
+//Serialization of the content of tables in a binary columnar format.
+//Every column is stored separately as a sequence of LZ4-compressed chunks.
+class ColumnIO {
+private:
+    static void writeColumn(std::ostream &out, const std::vector<Term_t> &column);
+
+    static void readColumn(std::istream &in, const size_t nrows,
+                           std::vector<Term_t> &column);
+
+public:
+    static void write(std::ostream &out,
+                      const std::vector<const std::vector<Term_t> *> &columns,
+                      const size_t nrows);
+
+    static void write(std::ostream &out, const FCInternalTable *table);
+
+    static std::shared_ptr<const Segment> read(std::istream &in);
+};
+
+#endif
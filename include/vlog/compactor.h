@@ -0,0 +1,55 @@
+#ifndef _COMPACTOR_H
+#define _COMPACTOR_H
+
+#include <vlog/concepts.h>
+#include <vlog/fcinttable.h>
+
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <set>
+#include <vector>
+
+//Blocks with at least this number of rows are never compacted
+#define COMPACT_MAX_ROWS (1 << 16)
+//Minimum number of adjacent small blocks that are merged together
+#define COMPACT_MIN_BLOCKS 16
+
+struct CompactionJob {
+    PredId_t pred;
+    std::vector<std::shared_ptr<const FCInternalTable>> tables;
+    size_t iteration;
+    std::shared_ptr<const FCInternalTable> result;
+};
+
+//Merges runs of small blocks on a background thread. The blocks are
+//replaced in their FCTable by the reasoner once the merge is finished.
+class Compactor {
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<std::shared_ptr<CompactionJob>> pending;
+    std::vector<std::shared_ptr<CompactionJob>> finished;
+    //Predicates with a job that is not installed yet
+    std::set<PredId_t> busy;
+    bool stop;
+    boost::thread thread;
+
+    void run();
+
+    static std::shared_ptr<const FCInternalTable> compact(
+        const CompactionJob &job);
+
+public:
+    Compactor();
+
+    bool isBusy(const PredId_t pred);
+
+    void submit(std::shared_ptr<CompactionJob> job);
+
+    std::vector<std::shared_ptr<CompactionJob>> getFinishedJobs();
+
+    ~Compactor();
+};
+
+#endif
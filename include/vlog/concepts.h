@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
 
 /*** PREDICATES ***/
 #define EDB 0
@@ -369,6 +370,14 @@ private:
 
     Dictionary additionalConstants;
 
+    //Changes whenever the rules do
+    uint64_t id;
+    static std::atomic<uint64_t> nextId;
+
+    void rulesChanged() {
+        id = ++nextId;
+    }
+
     void parseRule(std::string rule);
 
     std::string rewriteRDFOWLConstants(std::string input);
@@ -401,6 +410,12 @@ public:
         return additionalConstants.getRawValue(val);
     }
 
+    //Identifies the rules of the program. Unlike the address, it is never
+    //reused by another program
+    uint64_t getId() const {
+        return id;
+    }
+
     void sortRulesByIDBPredicates();
 
     std::vector<Rule> getAllRules();
@@ -415,6 +430,10 @@ public:
 
     void addAllRules(std::vector<Rule> &rules);
 
+    //Keep only the rules needed to derive the target predicates. Returns
+    //the number of removed rules
+    int sliceForPredicates(const std::vector<std::string> &targets);
+
     bool isPredicateIDB(const PredId_t id);
 
     std::string getAllPredicates();
@@ -0,0 +1,97 @@
+#ifndef _CONNECTION_POOL_H
+#define _CONNECTION_POOL_H
+
+#include <vlog/edbiterator.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <functional>
+#include <vector>
+
+//Connections to a database that are opened on demand and reused by the
+//parallel scans
+template<typename C>
+class ConnectionPool {
+private:
+    std::function<C()> open;
+    std::function<void(C)> close;
+
+    boost::mutex mutex;
+    std::vector<C> all;
+    std::vector<C> available;
+
+public:
+    ConnectionPool(std::function<C()> open, std::function<void(C)> close) :
+        open(open), close(close) {}
+
+    C acquire() {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if (!available.empty()) {
+                C c = available.back();
+                available.pop_back();
+                return c;
+            }
+        }
+        C c = open();
+        boost::mutex::scoped_lock lock(mutex);
+        all.push_back(c);
+        return c;
+    }
+
+    void release(C c) {
+        boost::mutex::scoped_lock lock(mutex);
+        available.push_back(c);
+    }
+
+    ~ConnectionPool() {
+        for (auto c : all) {
+            close(c);
+        }
+    }
+};
+
+//Iterator over a query executed on a connection of the pool. The
+//connection goes back to the pool when the iterator is deleted
+template<typename C>
+class PooledIterator : public EDBIterator {
+private:
+    ConnectionPool<C> *pool;
+    C con;
+    EDBIterator *itr;
+
+public:
+    PooledIterator(ConnectionPool<C> *pool, C con, EDBIterator *itr) :
+        pool(pool), con(con), itr(itr) {}
+
+    bool hasNext() {
+        return itr->hasNext();
+    }
+
+    void next() {
+        itr->next();
+    }
+
+    void clear() {
+        itr->clear();
+    }
+
+    void skipDuplicatedFirstColumn() {
+        itr->skipDuplicatedFirstColumn();
+    }
+
+    PredId_t getPredicateID() {
+        return itr->getPredicateID();
+    }
+
+    Term_t getElementAt(const uint8_t p) {
+        return itr->getElementAt(p);
+    }
+
+    ~PooledIterator() {
+        delete itr;
+        pool->release(con);
+    }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _DICT_CACHE_H
+#define _DICT_CACHE_H
+
+#include <boost/thread/mutex.hpp>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//Number of terms kept in the cache
+#define DICT_CACHE_SIZE 1000000
+//Number of rows whose terms the exporters resolve with one getDictTexts
+#define EXPORT_DICT_BATCH 100000
+
+//Bounded LRU cache of the terms of a dictionary, in both directions. Used
+//in front of dictionaries that cost a round-trip for every lookup.
+class DictCache {
+private:
+    struct Entry {
+        uint64_t id;
+        std::string text;
+    };
+
+    const size_t capacity;
+    boost::mutex mutex;
+    std::list<Entry> entries; //the most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> byId;
+    std::unordered_map<std::string, std::list<Entry>::iterator> byText;
+
+    uint64_t hits, misses;
+
+public:
+    DictCache(const size_t capacity) : capacity(capacity), hits(0),
+        misses(0) {}
+
+    bool getText(const uint64_t id, std::string &text);
+
+    bool getNumber(const std::string &text, uint64_t &id);
+
+    void add(const uint64_t id, const std::string &text);
+
+    ~DictCache();
+};
+
+#endif
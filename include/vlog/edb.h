@@ -10,13 +10,19 @@
 #include <vlog/edbtable.h>
 #include <vlog/edbiterator.h>
 #include <vlog/edbconf.h>
+#include <vlog/dictcache.h>
+#include <vlog/cardcache.h>
+#include <vlog/answercache.h>
 
 #include <kognac/factory.h>
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <string>
 
 class Column;
+class MmapDictionary;
 class EDBMemIterator : public EDBIterator {
 private:
     uint8_t nfields = 0;
@@ -78,8 +84,50 @@ private:
     Factory<EDBMemIterator> memItrFactory;
     IndexedTupleTable *tmpRelations[MAX_NPREDS];
 
+    //Cache of the dictionary if it is in a database
+    std::unique_ptr<DictCache> dictCache;
+
+    //Cardinalities already asked to the tables
+    CardinalityCache cardCache;
+
+    //Answers of the queries on this layer
+    AnswerCache answerCache;
+
+    size_t computeCardinality(const Literal &query);
+
+    size_t computeCardinalityColumn(const Literal &query, uint8_t posColumn);
+
+    size_t computeEstimate(const Literal &query);
+
+    //Read the tables on disk or in a database in a background thread
+    bool prefetch;
+
+    //The tables can be queried by several threads at once
+    bool multithreaded;
+
+    EDBIterator *getTableIterator(const Literal &query,
+                                  const EDBInfoTable &info,
+                                  const std::vector<uint8_t> *fields);
+
+    //Dictionary used by the tables, "" for the tables that read the
+    //dictionary of the KB. All the tables must use the same one, otherwise
+    //the same ID would denote different terms
+    string dictionary;
+
+    void checkDictionary(const string &predname, const string &dict);
+
     void addTridentTable(const EDBConf::Table &tableConf, bool multithreaded);
 
+    //Dictionary shared by all the in-memory tables
+    std::shared_ptr<Dictionary> inmemoryDict;
+
+    void addInmemoryTable(const EDBConf::Table &tableConf);
+
+    //Dictionaries of the directories of the mmap tables
+    std::map<string, std::shared_ptr<MmapDictionary>> mmapDicts;
+
+    void addMmapTable(const EDBConf::Table &tableConf);
+
 #ifdef MYSQL
     void addMySQLTable(const EDBConf::Table &tableConf);
 #endif
@@ -91,11 +139,16 @@ private:
 #endif
 
 public:
-    EDBLayer(EDBConf &conf, bool multithreaded) {
+    EDBLayer(EDBConf &conf, bool multithreaded) : prefetch(false),
+        multithreaded(multithreaded) {
         const std::vector<EDBConf::Table> tables = conf.getTables();
         for (const auto &table : tables) {
             if (table.type == "Trident") {
                 addTridentTable(table, multithreaded);
+            } else if (table.type == "INMEMORY") {
+                addInmemoryTable(table);
+            } else if (table.type == "MMAP") {
+                addMmapTable(table);
 #ifdef MYSQL
             } else if (table.type == "MySQL") {
                 addMySQLTable(table);
@@ -114,6 +167,14 @@ public:
             }
         }
 
+        if (!dbPredicates.empty()) {
+            const string type = dbPredicates.begin()->second.type;
+            if (type == "MySQL" || type == "ODBC" || type == "MAPI") {
+                dictCache = std::unique_ptr<DictCache>(
+                                new DictCache(DICT_CACHE_SIZE));
+            }
+        }
+
         for (int i = 0; i < MAX_NPREDS; ++i) {
             tmpRelations[i] = NULL;
         }
@@ -190,6 +251,12 @@ public:
 
     bool getDictText(const uint64_t id, char *text);
 
+    //Resolves many ids with as few lookups as possible. found[i] is false
+    //if ids[i] is not in the dictionary
+    void getDictTexts(const std::vector<uint64_t> &ids,
+                      std::vector<std::string> &texts,
+                      std::vector<bool> &found);
+
     Predicate getDBPredicate(int idx);
 
     std::shared_ptr<EDBTable> getEDBTable(PredId_t id) {
@@ -210,8 +277,24 @@ public:
 
     uint64_t getNTerms();
 
+    const CardinalityCache &getCardinalityCache() const {
+        return cardCache;
+    }
+
+    AnswerCache &getAnswerCache() {
+        return answerCache;
+    }
+
     void releaseIterator(EDBIterator *itr);
 
+    void setPrefetching(const bool prefetch) {
+        this->prefetch = prefetch;
+    }
+
+    bool isMultithreaded() const {
+        return multithreaded;
+    }
+
     ~EDBLayer() {
         for (int i = 0; i < MAX_NPREDS; ++i) {
             if (tmpRelations[i] != NULL) {
@@ -1,6 +1,11 @@
 #ifndef _EDB_TABLE_H
 #define _EDB_TABLE_H
 
+#include <kognac/consts.h>
+
+#include <string>
+#include <vector>
+
 class Column;
 class EDBIterator;
 class EDBTable {
@@ -41,6 +46,15 @@ public:
     virtual EDBIterator *getSortedIterator(const Literal &query,
                                            const std::vector<uint8_t> &fields) = 0;
 
+    //Iterator that reads the rows ahead of the caller in a background
+    //thread (sorted on fields if not NULL). The thread must not share the
+    //connection to the backend with the other users of the table, so
+    //NULL if the table cannot provide that
+    virtual EDBIterator *getPrefetchingIterator(const Literal &query,
+            const std::vector<uint8_t> *fields) {
+        return NULL;
+    }
+
     virtual void releaseIterator(EDBIterator *itr) = 0;
 
     virtual bool getDictNumber(const char *text, const size_t sizeText,
@@ -48,6 +62,20 @@ public:
 
     virtual bool getDictText(const uint64_t id, char *text) = 0;
 
+    //Resolves many ids at once. found[i] is false if ids[i] is not in the
+    //dictionary. Tables with a remote dictionary should batch the lookups
+    virtual void getDictTexts(const std::vector<uint64_t> &ids,
+                              std::vector<std::string> &texts,
+                              std::vector<bool> &found) {
+        char text[MAX_TERM_SIZE];
+        texts.resize(ids.size());
+        found.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            found[i] = getDictText(ids[i], text);
+            texts[i] = found[i] ? std::string(text) : std::string();
+        }
+    }
+
     virtual uint64_t getNTerms() = 0;
 };
 
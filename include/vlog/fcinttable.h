@@ -580,6 +580,8 @@ private:
     Factory<EDBFCInternalTableItr> factory;
     std::vector<uint8_t> defaultSorting;
 
+    bool containsRow(SegmentIterator &itr) const;
+
     EDBFCInternalTable(const size_t iteration,
                        const uint8_t nfields, uint8_t const posFields[MAX_ROWSIZE],
                        const QSQQuery &query,
@@ -606,6 +608,15 @@ public:
         return *query.getLiteral();
     }
 
+    //True if one of the rows is in the table. Every row is looked up in
+    //the EDB layer, so the cost does not depend on the size of the table
+    bool containsAny(std::shared_ptr<const Segment> rows) const;
+
+    //The rows that are in the table, in the same order, looked up as in
+    //containsAny
+    std::shared_ptr<const Segment> getContained(
+        std::shared_ptr<const Segment> rows) const;
+
     size_t getNRows() const;
 
     bool isEmpty() const;
@@ -32,9 +32,14 @@ struct FCBlock {
 
     bool isCompleted;
 
+    //Compacted blocks contain the derivations of the iterations
+    //[firstIteration, iteration]. Otherwise firstIteration == iteration
+    size_t firstIteration;
+
     FCBlock(size_t iteration, std::shared_ptr<const FCInternalTable> table, Literal query, const RuleExecutionDetails *rule,
             const uint8_t ruleExecOrder, bool isCompleted) : iteration(iteration),
-        table(table), query(query), rule(rule), ruleExecOrder(ruleExecOrder), isCompleted(isCompleted) {
+        table(table), query(query), rule(rule), ruleExecOrder(ruleExecOrder), isCompleted(isCompleted),
+        firstIteration(iteration) {
         BOOST_LOG_TRIVIAL(debug) << "FCBlock " << this << ": table = " << table << ", iteration = " << iteration;
     }
 
@@ -45,6 +50,8 @@ struct FCBlock {
     */
 };
 
+class SpillManager;
+
 struct FCCacheBlock {
     std::shared_ptr<FCTable> table;
     size_t begin, end;
@@ -89,6 +96,8 @@ private:
     const uint8_t sizeRow;
 
     std::vector<FCBlock> blocks;
+    //Number of blocks that were already considered by makeSpillable
+    size_t sealedBlocks;
 
     FCCache cache;
     std::string getSignature(const Literal &literal);
@@ -141,6 +150,9 @@ public:
 
     bool isEmpty(size_t count) const;
 
+    //True if the table only consists of the untouched EDB block
+    bool isOnlyEDB() const;
+
     FCBlock &getLastBlock();
 
     //size_t getNRows(size_t count) const;
@@ -162,6 +174,31 @@ public:
              const uint8_t ruleExecOrder,
              const size_t iteration, const bool isCompleted, int nthreads);
 
+    //Remove the given (sorted) rows from all blocks. Returns true if
+    //some rows were removed
+    bool remove(std::shared_ptr<const Segment> rows, int nthreads);
+
+    //Let the manager move the tables of the sealed blocks (all but the last
+    //one) to disk. Returns the blocks whose table was replaced
+    std::vector<FCBlock> makeSpillable(SpillManager *manager,
+                                       const size_t minRows);
+
+    //Bytes used by the in-memory blocks that are not managed by a
+    //SpillManager and by the tables in the cache
+    size_t getResidentMemory();
+
+    //Returns the longest run of adjacent blocks that can be compacted. All
+    //the blocks are older than maxIteration, smaller than maxRows and
+    //were produced by the same rule with the same query
+    std::vector<FCBlock> getCompactionRun(const size_t maxIteration,
+                                          const size_t maxRows,
+                                          const size_t minBlocks) const;
+
+    //Replace the blocks of the run with a single block that contains the
+    //table merged. Returns false if the blocks were changed in the meantime
+    bool replaceBlocks(const std::vector<std::shared_ptr<const FCInternalTable>> &run,
+                       std::shared_ptr<const FCInternalTable> merged);
+
     ~FCTable();
 };
 
@@ -2,9 +2,15 @@
 #define IDXTUPLETABLE_H
 
 #include <vlog/qsqquery.h>
+#include <vlog/edbiterator.h>
 #include <trident/model/table.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include <vector>
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include <algorithm>
 #include <google/dense_hash_set>
 
@@ -13,7 +19,22 @@ typedef google::dense_hash_set<Term_t, std::hash<Term_t>, std::equal_to<Term_t>>
 class IndexedTupleTable {
 
 private:
+    //Rows sorted on the columns of order. The columns of each row keep
+    //their position
+    struct Permutation {
+        std::vector<uint8_t> order;
+        std::vector<Term_t> rows;
+    };
+
+    //Ranges of rows of a permutation with the same values in its first
+    //columns, by the hash of these values. Hashes shared by different keys
+    //are marked with an empty range and looked up with a binary search
+    struct KeyIndex {
+        std::unordered_map<uint64_t, std::pair<size_t, size_t>> ranges;
+    };
+
     const uint8_t sizeTuple;
+    size_t nrows;
     std::vector<Term_t> *singleColumn;
 
     std::vector<std::pair<Term_t, Term_t>> *twoColumn1;
@@ -21,9 +42,27 @@ private:
     std::vector<std::pair<Term_t, Term_t>> *twoColumn2;
     std::unique_ptr<GoogleSet> setColumn2;
 
-    TupleTable *spo;
-    TupleTable *pos;
-    TupleTable *osp;
+    //Built on demand, for any arity. The rows in the natural order are
+    //built at loading time if the arity is larger than two
+    boost::mutex mutex;
+    std::map<std::vector<uint8_t>, std::unique_ptr<Permutation>> permutations;
+    std::map<std::pair<std::vector<uint8_t>, uint8_t>,
+        std::unique_ptr<KeyIndex>> indexes;
+    std::vector<size_t> distinctValues;
+
+    static uint64_t hashKey(const Term_t *row, const uint8_t *cols,
+                            const uint8_t ncols);
+
+    //order followed by the columns that are not in it
+    std::vector<uint8_t> completeOrder(const std::vector<uint8_t> &order) const;
+
+    const Permutation *getPermutation(const std::vector<uint8_t> &order);
+
+    const KeyIndex *getKeyIndex(const Permutation *perm, const uint8_t nkeys);
+
+    //Compares the first nkeys columns of the order of perm with key
+    static int compareKey(const Permutation *perm, const size_t row,
+                          const uint8_t nkeys, const Term_t *key);
 
     std::unique_ptr<GoogleSet> fillSet(std::vector<Term_t> &v) {
         std::unique_ptr<GoogleSet> ptr1(new GoogleSet());
@@ -50,6 +89,27 @@ private:
 public:
     IndexedTupleTable(TupleTable *table);
 
+    //Rows sorted on the columns of order (then on the others) whose first
+    //nkeys columns have the values in key. rows is set to the packed rows
+    //of the permutation, the range is in rows
+    std::pair<size_t, size_t> lookup(const std::vector<uint8_t> &order,
+                                     const uint8_t nkeys, const Term_t *key,
+                                     const Term_t *&rows);
+
+    //Rows that match the constants and the repeated variables of the
+    //literal, sorted on the constants, then on the variables in fields
+    //(indices among the variables), then on the other columns
+    EDBIterator *getIterator(const Literal &query,
+                             const std::vector<uint8_t> &fields);
+
+    //Rows that match the literal and one of the tuples in valuesToFilter
+    void query(const Literal &query, std::vector<uint8_t> *posToFilter,
+               std::vector<Term_t> *valuesToFilter, TupleTable *outputTable);
+
+    size_t count(const Literal &query);
+
+    bool isEmpty(const Literal &query);
+
     ~IndexedTupleTable();
 
     uint8_t getSizeTuple() const {
@@ -61,16 +121,13 @@ public:
     }
 
     size_t getNTuples() {
-        if (sizeTuple == 1) {
-            return singleColumn->size();
-        } else if (sizeTuple == 2) {
-            return twoColumn1->size();
-        } else {
-            return spo->getNRows();
-        }
+        return nrows;
     }
 
     size_t size(uint8_t colid) {
+        if (sizeTuple > 2) {
+            return distinct(colid);
+        }
 	if (colid == 0) {
 	    if (setColumn1 == NULL) {
 		if (sizeTuple == 1) {
@@ -131,11 +188,16 @@ public:
             }
             return false;
         } else {
-            //not supported
-            throw 10;
+            const Term_t *rows;
+            std::vector<uint8_t> order(1, colid);
+            std::pair<size_t, size_t> r = lookup(order, 1, &value, rows);
+            return r.first < r.second;
         }
     }
 
+    //Number of distinct values in a column
+    size_t distinct(const uint8_t colid);
+
     std::vector<std::pair<Term_t, Term_t>> *getTwoColumn1() {
         return twoColumn1;
     }
@@ -145,4 +207,47 @@ public:
     }
 };
 
+//Iterator over a range of rows of a permutation of an IndexedTupleTable
+class IndexedTupleTableItr : public EDBIterator {
+private:
+    PredId_t predid;
+    const Term_t *rows;
+    uint8_t sizeTuple;
+    size_t current, nextRow, end;
+    std::vector<std::pair<uint8_t, uint8_t>> repeatedVars;
+    int posFirstVar;
+    bool skipDuplicatedFirst;
+    bool isFirst;
+
+    bool matches(const size_t row) const;
+
+public:
+    IndexedTupleTableItr(PredId_t predid, const Term_t *rows,
+                         const uint8_t sizeTuple, const size_t start,
+                         const size_t end, const Literal &query,
+                         const int posFirstVar);
+
+    bool hasNext();
+
+    void next();
+
+    Term_t getElementAt(const uint8_t p) {
+        return rows[current * sizeTuple + p];
+    }
+
+    PredId_t getPredicateID() {
+        return predid;
+    }
+
+    void skipDuplicatedFirstColumn();
+
+    //Rows left in the range, including the ones that do not match the
+    //repeated variables
+    size_t getNRows() const {
+        return end - nextRow;
+    }
+
+    void clear() {}
+};
+
 #endif
@@ -0,0 +1,199 @@
+#ifndef _INMEMORY_TABLE_H
+#define _INMEMORY_TABLE_H
+
+#include <vlog/column.h>
+#include <vlog/edbtable.h>
+#include <vlog/edbiterator.h>
+#include <vlog/support.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Rows of a relation sorted by an order of the columns. If index is NULL the
+//columns are physically sorted by the order, otherwise index contains the
+//positions of the rows in the columns
+struct InmemoryPermutation {
+    std::vector<uint8_t> order;
+    std::vector<const Term_t*> columns;
+    const uint64_t *index;
+
+    //Minimum and maximum of each column in blocks of rows. Column-major.
+    //NULL if not available
+    const Term_t *blockMin;
+    const Term_t *blockMax;
+    size_t blockSize;
+    size_t nblocks;
+
+    InmemoryPermutation() : index(NULL), blockMin(NULL), blockMax(NULL),
+        blockSize(0), nblocks(0) {}
+
+    Term_t get(const uint8_t column, const size_t i) const {
+        return columns[column][index == NULL ? i : index[i]];
+    }
+};
+
+class InmemoryIterator : public EDBIterator {
+private:
+    PredId_t predid;
+    const InmemoryPermutation *perm;
+    std::vector<std::pair<uint8_t, uint8_t>> repeatedVars;
+    //Constants that are not covered by the order of the permutation
+    std::vector<std::pair<uint8_t, Term_t>> filters;
+    int sortField; //first variable column in the order of the rows
+
+    size_t start, current, nextRow, end;
+    size_t checkedBlock;
+    bool isFirst;
+    bool skipDuplicatedFirst;
+
+    bool isValid(const size_t i) const;
+
+    bool skipBlock(const size_t block) const;
+
+public:
+    void init(PredId_t predid, const InmemoryPermutation *perm,
+              const size_t start, const size_t end,
+              const std::vector<std::pair<uint8_t, uint8_t>> &repeatedVars,
+              const std::vector<std::pair<uint8_t, Term_t>> &filters,
+              const int sortField);
+
+    bool hasNext();
+
+    void next();
+
+    Term_t getElementAt(const uint8_t p);
+
+    PredId_t getPredicateID() {
+        return predid;
+    }
+
+    void moveTo(const uint8_t field, const Term_t t);
+
+    void skipDuplicatedFirstColumn();
+
+    void clear() {
+    }
+
+    //Number of rows left, to be called before the first next()
+    size_t count();
+
+    //Upper bound of count()
+    size_t estimateCount() const {
+        return end - start;
+    }
+
+    const char *getUnderlyingArray(uint8_t column);
+
+    std::pair<uint8_t, std::pair<uint8_t, uint8_t>> getSizeElemUnderlyingArray(uint8_t column);
+};
+
+/*** Relation of arbitrary arity loaded from a TSV/CSV file (possibly gzipped).
+ * The terms are encoded with a dictionary shared by all in-memory tables.
+ * The rows are kept sorted by the order of the columns. Indices that sort the
+ * rows by other orders are built the first time they are needed.
+ ***/
+class InmemoryTable : public EDBTable {
+private:
+    std::vector<std::vector<Term_t>> data;
+    std::shared_ptr<Dictionary> dict;
+    std::list<std::vector<uint64_t>> builtIndices;
+
+    void load(std::string path, char separator);
+
+    void sortAndRemoveDuplicates();
+
+    int cmp(const InmemoryPermutation &perm, const size_t i,
+            const Term_t *key, const uint8_t sizeKey) const;
+
+    //Order of the columns with the constants first, then the given
+    //variables, and then all others
+    std::vector<uint8_t> getOrder(const Literal &query,
+                                  const std::vector<uint8_t> &positions,
+                                  const std::vector<uint8_t> &sortFields,
+                                  std::vector<bool> &bound, size_t &nsorted);
+
+    const InmemoryPermutation *getPermutation(const std::vector<uint8_t> &order,
+            const size_t nbound, const size_t nsorted, size_t &prefix);
+
+    InmemoryIterator *getIterator(const Literal &query,
+                                  const std::vector<uint8_t> &positions,
+                                  const Term_t *values,
+                                  const std::vector<uint8_t> &sortFields);
+
+    bool exists(const Literal &query, const std::vector<uint8_t> &positions,
+                const Term_t *values);
+
+protected:
+    PredId_t predid;
+    uint8_t arity;
+    size_t nrows;
+
+    boost::mutex mutex;
+    std::list<InmemoryPermutation> permutations;
+
+    //If no permutation has the right order, scan the one with the longest
+    //prefix of constants instead of building a new index
+    bool scanWithoutIndex;
+
+    InmemoryTable(PredId_t predid);
+
+public:
+    InmemoryTable(PredId_t predid, std::string path, std::string separator,
+                  std::shared_ptr<Dictionary> dict);
+
+    uint8_t getArity() const {
+        return arity;
+    }
+
+    std::vector<std::shared_ptr<Column>> checkNewIn(const Literal &l1,
+                                      std::vector<uint8_t> &posInL1,
+                                      const Literal &l2,
+                                      std::vector<uint8_t> &posInL2);
+
+    std::vector<std::shared_ptr<Column>> checkNewIn(
+                                          std::vector <
+                                          std::shared_ptr<Column >> &checkValues,
+                                          const Literal &l2,
+                                          std::vector<uint8_t> &posInL2);
+
+    std::shared_ptr<Column> checkIn(
+        std::vector<Term_t> &values,
+        const Literal &l2,
+        uint8_t posInL2,
+        size_t &sizeOutput);
+
+    void query(QSQQuery *query, TupleTable *outputTable,
+               std::vector<uint8_t> *posToFilter,
+               std::vector<Term_t> *valuesToFilter);
+
+    size_t estimateCardinality(const Literal &query);
+
+    size_t getCardinality(const Literal &query);
+
+    size_t getCardinalityColumn(const Literal &query, uint8_t posColumn);
+
+    bool isEmpty(const Literal &query, std::vector<uint8_t> *posToFilter,
+                 std::vector<Term_t> *valuesToFilter);
+
+    EDBIterator *getIterator(const Literal &query);
+
+    EDBIterator *getSortedIterator(const Literal &query,
+                                   const std::vector<uint8_t> &fields);
+
+    void releaseIterator(EDBIterator *itr);
+
+    bool getDictNumber(const char *text, const size_t sizeText,
+                       uint64_t &id);
+
+    bool getDictText(const uint64_t id, char *text);
+
+    uint64_t getNTerms();
+
+    virtual ~InmemoryTable() {}
+};
+
+#endif
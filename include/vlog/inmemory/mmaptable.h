@@ -0,0 +1,107 @@
+#ifndef _MMAP_TABLE_H
+#define _MMAP_TABLE_H
+
+#include <vlog/inmemory/inmemorytable.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EDBLayer;
+
+//Read-only mapping of a whole file
+class MmapFile {
+private:
+    const char *data;
+    size_t size;
+
+public:
+    MmapFile(std::string path);
+
+    const char *getData() const {
+        return data;
+    }
+
+    size_t getSize() const {
+        return size;
+    }
+
+    ~MmapFile();
+};
+
+/*** Dictionary of a directory created by "vlog convert" (file dict.bin).
+ * Layout, all numbers are uint64:
+ * "VLOGDIC1" nterms maxid
+ * ids[nterms]           sorted
+ * offsets[nterms + 1]   offsets of the texts of ids[i] in the blob
+ * bytext[nterms]        positions in ids sorted by the text
+ * blob
+ ***/
+class MmapDictionary {
+private:
+    MmapFile file;
+    uint64_t nterms;
+    uint64_t maxid;
+    const uint64_t *ids;
+    const uint64_t *offsets;
+    const uint64_t *bytext;
+    const char *blob;
+
+    int cmpText(const uint64_t idx, const char *text,
+                const size_t sizeText) const;
+
+public:
+    MmapDictionary(std::string path);
+
+    bool getDictNumber(const char *text, const size_t sizeText,
+                       uint64_t &id) const;
+
+    bool getDictText(const uint64_t id, char *text) const;
+
+    uint64_t getNTerms() const {
+        return maxid + 1;
+    }
+};
+
+/*** Relation stored in a file <predicate>.rel created by "vlog convert".
+ * The file is mapped in memory and never copied, so opening it costs
+ * nothing. Layout, all numbers are uint64:
+ * "VLOGREL1" arity nrows nperms blocksize
+ * and for each permutation:
+ * order[arity]
+ * columns[arity][nrows]  rows sorted by the order
+ * blockmin[arity][nblocks] blockmax[arity][nblocks]
+ ***/
+class MmapTable : public InmemoryTable {
+private:
+    std::unique_ptr<MmapFile> file;
+    std::shared_ptr<MmapDictionary> dict;
+
+    static void writePermutation(std::ofstream &out,
+                                 const std::vector<std::vector<Term_t>> &rows,
+                                 const std::vector<uint8_t> &order,
+                                 const size_t blockSize);
+
+    static void convertRelation(EDBLayer &layer, const PredId_t predid,
+                                const uint8_t arity, std::string path);
+
+    static void convertDictionary(EDBLayer &layer, std::string path);
+
+public:
+    MmapTable(PredId_t predid, std::string path,
+              std::shared_ptr<MmapDictionary> dict);
+
+    bool getDictNumber(const char *text, const size_t sizeText,
+                       uint64_t &id);
+
+    bool getDictText(const uint64_t id, char *text);
+
+    uint64_t getNTerms();
+
+    //Writes all the EDB predicates of the layer in the directory, together
+    //with the dictionary and an edb.conf to load them
+    static void convert(EDBLayer &layer, std::string outdir);
+};
+
+#endif
@@ -32,8 +32,14 @@ struct LessTwoTuples {
 //If the previous table has less than these lines, then it executes an hash join
 #define THRESHOLD_HASHJOIN 1000
 
+//An EDB literal is looked up once for every key of the previous table if
+//this many lookups (of log(N) each) still cost less than reading its N rows
+#define INDEXJOIN_RATIO 10
+
 #define FLUSH_SIZE (1 << 20)
 
+enum JoinAlgorithm { VERIFICATIVEJOIN, TWOTOONEJOIN, INDEXJOIN, HASHJOIN, MERGEJOIN };
+
 class Output {
 private:
 
@@ -238,6 +244,10 @@ private:
                                    const uint8_t rowSize, const uint8_t s2,
                                    ResultJoinProcessor *output);
 
+    static bool isJoinIndexable(SemiNaiver *naiver, const FCInternalTable *t1,
+                                const Literal &literal,
+                                const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates);
+
     static bool isJoinSelective(JoinHashMap &map, const Literal &literal,
                                 const size_t minIteration, const size_t maxIteration,
                                 SemiNaiver *naiver, const uint8_t joinPos);
@@ -288,6 +298,15 @@ public:
 					  const Term_t *valBlocks,
 					  Output * output);
 
+    //Algorithm that join() will use for the given inputs
+    static JoinAlgorithm chooseAlgorithm(SemiNaiver *naiver,
+                                         const FCInternalTable *t1,
+                                         const RuleExecutionPlan &plan,
+                                         const int currentLiteral,
+                                         const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates);
+
+    static const char *getAlgorithmName(const JoinAlgorithm algo);
+
     static void join(SemiNaiver *naiver, const FCInternalTable * t1, const Literal *outputLiteral, const Literal &literal,
                      const size_t min, const size_t max,
                      const std::vector<std::pair<uint8_t, uint8_t>> *filterValueVars,
@@ -305,6 +324,13 @@ public:
                           std::vector<std::pair<uint8_t, uint8_t>> joinsCoordinates,
                           ResultJoinProcessor * output, int nthreads);
 
+    //Reads the rows of the EDB literal that match each distinct key of t1
+    //with a lookup in the indices of the EDB layer
+    static void indexjoin(const FCInternalTable * t1, SemiNaiver *naiver,
+                          const Literal &literal,
+                          const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates,
+                          ResultJoinProcessor * output);
+
     static void hashjoin(const FCInternalTable * t1, SemiNaiver *naiver, const Literal *outputLiteral,
                          const Literal &literal, const size_t min, const size_t max,
                          const std::vector<std::pair<uint8_t, uint8_t>> *filterValueVars,
@@ -3,16 +3,33 @@
 
 #include <vlog/column.h>
 #include <vlog/sqltable.h>
+#include <vlog/connectionpool.h>
 
 #include <monetdb/mapi.h>
 
 class MAPITable : public SQLTable {
 private:
     Mapi con;
+    //Further connections for the parallel scans
+    std::unique_ptr<ConnectionPool<Mapi>> pool;
+
+protected:
+    size_t exactCardinality(const Literal &query);
+
+    size_t exactCardinalityColumn(const Literal &query, uint8_t posColumn);
+
+    void executeUpdate(const string &sql);
+
+    EDBIterator *executeQuery(const string &sql, const Literal &query,
+                              const uint8_t ncolumns);
+
+    EDBIterator *executePooledQuery(const string &sql, const Literal &query,
+                                    const uint8_t ncolumns);
 
 public:
     MAPITable(string host, int port, string user, string pwd, string dbname,
-	                           string tablename, string tablefields);
+	                           string tablename, string tablefields,
+	                           string statistics);
 
     static MapiHdl doquery(Mapi dbh, string q);
     
@@ -22,10 +39,6 @@ public:
                std::vector<uint8_t> *posToFilter,
                std::vector<Term_t> *valuesToFilter);
 
-    size_t getCardinality(const Literal &query);
-
-    size_t getCardinalityColumn(const Literal &query, uint8_t posColumn);
-
     bool isEmpty(const Literal &query, std::vector<uint8_t> *posToFilter,
                  std::vector<Term_t> *valuesToFilter);
 
@@ -39,6 +52,10 @@ public:
 
     bool getDictText(const uint64_t id, char *text);
 
+    void getDictTexts(const std::vector<uint64_t> &ids,
+                      std::vector<std::string> &texts,
+                      std::vector<bool> &found);
+
     uint64_t getNTerms();
 
     ~MAPITable();
@@ -3,6 +3,7 @@
 
 #include <vlog/column.h>
 #include <vlog/sqltable.h>
+#include <vlog/connectionpool.h>
 
 //Mysql connectors header
 #include <mysql_connection.h>
@@ -27,19 +28,31 @@ class MySQLTable : public SQLTable {
 private:
     sql::Driver *driver;
     sql::Connection *con;
+    //Further connections for the parallel scans
+    std::unique_ptr<ConnectionPool<sql::Connection*>> pool;
+
+protected:
+    size_t exactCardinality(const Literal &query);
+
+    size_t exactCardinalityColumn(const Literal &query, uint8_t posColumn);
+
+    void executeUpdate(const string &sql);
+
+    EDBIterator *executeQuery(const string &sql, const Literal &query,
+                              const uint8_t ncolumns);
+
+    EDBIterator *executePooledQuery(const string &sql, const Literal &query,
+                                    const uint8_t ncolumns);
 
 public:
     MySQLTable(string host, string user, string pwd, string dbname,
-               string tablename, string tablefields);
+               string tablename, string tablefields,
+               string statistics);
 
     void query(QSQQuery *query, TupleTable *outputTable,
                std::vector<uint8_t> *posToFilter,
                std::vector<Term_t> *valuesToFilter);
 
-    size_t getCardinality(const Literal &query);
-
-    size_t getCardinalityColumn(const Literal &query, uint8_t posColumn);
-
     bool isEmpty(const Literal &query, std::vector<uint8_t> *posToFilter,
                  std::vector<Term_t> *valuesToFilter);
 
@@ -53,9 +66,14 @@ public:
 
     bool getDictText(const uint64_t id, char *text);
 
+    void getDictTexts(const std::vector<uint64_t> &ids,
+                      std::vector<std::string> &texts,
+                      std::vector<bool> &found);
+
     uint64_t getNTerms();
 
     ~MySQLTable() {
+        pool.reset();
         if (con) {
 	    con->close();
             delete con;
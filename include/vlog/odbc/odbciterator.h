@@ -9,6 +9,9 @@
 #include <sqltypes.h>
 #include <sqlext.h>
 
+//Rows fetched with one SQLFetch
+#define ODBC_ROWSET_SIZE 1024
+
 class ODBCIterator : public EDBIterator {
 private:
     PredId_t predid;
@@ -21,9 +24,16 @@ private:
     SQLSMALLINT columns;
     SQLLEN *indicator;
     SQLUBIGINT *values;
+    SQLULEN rowsFetched;
+    SQLULEN currentRow;
 
     SQLHANDLE stmt;
 
+    void execute(SQLHANDLE con, string sqlQuery);
+
+    //Moves to the next row, fetching a new block if needed
+    bool fetchRow();
+
 public:
     ODBCIterator(SQLHANDLE con,
                   string tableName,
@@ -3,6 +3,7 @@
 
 #include <vlog/column.h>
 #include <vlog/sqltable.h>
+#include <vlog/connectionpool.h>
 
 #include <sql.h>
 #include <sqltypes.h>
@@ -12,10 +13,26 @@ class ODBCTable : public SQLTable {
 private:
     SQLHANDLE env;
     SQLHANDLE con;
+    //Further connections for the parallel scans
+    std::unique_ptr<ConnectionPool<SQLHANDLE>> pool;
+
+protected:
+    size_t exactCardinality(const Literal &query);
+
+    size_t exactCardinalityColumn(const Literal &query, uint8_t posColumn);
+
+    void executeUpdate(const string &sql);
+
+    EDBIterator *executeQuery(const string &sql, const Literal &query,
+                              const uint8_t ncolumns);
+
+    EDBIterator *executePooledQuery(const string &sql, const Literal &query,
+                                    const uint8_t ncolumns);
 
 public:
     ODBCTable(string user, string pwd, string dbname,
-               string tablename, string tablefields);
+               string tablename, string tablefields,
+               string statistics);
 
     static void check(SQLRETURN rc, string msg);
 
@@ -23,10 +40,6 @@ public:
                std::vector<uint8_t> *posToFilter,
                std::vector<Term_t> *valuesToFilter);
 
-    size_t getCardinality(const Literal &query);
-
-    size_t getCardinalityColumn(const Literal &query, uint8_t posColumn);
-
     bool isEmpty(const Literal &query, std::vector<uint8_t> *posToFilter,
                  std::vector<Term_t> *valuesToFilter);
 
@@ -40,6 +53,10 @@ public:
 
     bool getDictText(const uint64_t id, char *text);
 
+    void getDictTexts(const std::vector<uint64_t> &ids,
+                      std::vector<std::string> &texts,
+                      std::vector<bool> &found);
+
     uint64_t getNTerms();
 
     ~ODBCTable();
@@ -0,0 +1,95 @@
+#ifndef _PREFETCH_ITERATOR_H
+#define _PREFETCH_ITERATOR_H
+
+#include <vlog/edbiterator.h>
+#include <vlog/concepts.h>
+
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <exception>
+#include <vector>
+
+//Rows of a batch of the ring
+#define PREFETCH_BATCH_ROWS 4096
+//Batches of the ring. The consumer holds one of them while it reads it
+#define PREFETCH_NBATCHES 4
+
+//Reads another EDB iterator in a background thread, so that the I/O and
+//the decompression of the tables overlap with the joins. The rows are
+//copied column by column into a bounded ring of batches.
+class PrefetchingEDBIterator : public EDBIterator {
+private:
+    struct Batch {
+        std::vector<Term_t> values; //values[column * PREFETCH_BATCH_ROWS + row]
+        size_t nrows;
+    };
+
+    EDBIterator *itr;
+    const PredId_t predid;
+    const uint8_t arity;
+
+    boost::thread thread;
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    Batch ring[PREFETCH_NBATCHES];
+    size_t head, count; //protected by the mutex
+    bool done, stopped;
+    //Set if the underlying iterator threw. It is rethrown by hasNext once
+    //the batches read before are consumed
+    std::exception_ptr error;
+
+    //Consumer side
+    bool started;
+    size_t tail;
+    bool holdsBatch;
+    size_t nextRow, currentRow;
+    bool hasNextChecked, hasNextValue;
+
+    void prefetch();
+
+    void start();
+
+    void stop();
+
+public:
+    PrefetchingEDBIterator(EDBIterator *itr, const PredId_t predid,
+                           const uint8_t arity);
+
+    bool hasNext();
+
+    void next();
+
+    Term_t getElementAt(const uint8_t p);
+
+    PredId_t getPredicateID() {
+        return predid;
+    }
+
+    //Only before the first hasNext
+    void moveTo(const uint8_t field, const Term_t t);
+
+    //Only before the first hasNext
+    void skipDuplicatedFirstColumn();
+
+    void clear();
+
+    //The raw arrays are available as long as the prefetching has not
+    //started. The caller then reads the underlying iterator itself
+    const char *getUnderlyingArray(uint8_t column);
+
+    std::pair<uint8_t, std::pair<uint8_t, uint8_t>> getSizeElemUnderlyingArray(uint8_t column);
+
+    EDBIterator *getUnderlyingIterator() {
+        return itr;
+    }
+
+    //Stops the background thread and returns the underlying iterator,
+    //which the caller must release
+    EDBIterator *release();
+
+    ~PrefetchingEDBIterator();
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+//One operator executed while evaluating a rule (first atom, join, ...)
+struct ProfiledOperator {
+    const char *name;
+    const char *algorithm;
+    int literal;
+    double start; //microseconds since the beginning of the profiling
+    double duration; //microseconds
+    size_t rowsIn;
+    size_t rowsOut;
+};
+
+struct ProfiledRule {
+    size_t ruleid;
+    size_t iteration;
+    int thread;
+    double start;
+    double duration;
+    size_t derived;
+    long peakMemMB;
+    std::vector<ProfiledOperator> operators;
+};
+
+//Collects the profile of every rule execution. Adding a profile only
+//copies it in a vector, so the profiler can be left on in long runs.
+class Profiler {
+private:
+    const boost::chrono::system_clock::time_point startTime;
+
+    boost::mutex mutex;
+    std::vector<ProfiledRule> rules;
+    std::map<boost::thread::id, int> threads;
+
+    static std::string escape(const std::string &s);
+
+public:
+    Profiler();
+
+    double getMicros(const boost::chrono::system_clock::time_point &t) const {
+        boost::chrono::duration<double, boost::micro> d = t - startTime;
+        return d.count();
+    }
+
+    static void addOperator(ProfiledRule &rule, const char *name,
+                            const char *algorithm, const int literal,
+                            const double start, const double end,
+                            const size_t rowsIn, const size_t rowsOut);
+
+    void add(ProfiledRule &rule);
+
+    //Aggregated statistics per rule and the list of all executions
+    void writeJSON(std::string path, const std::vector<std::string> &ruleNames);
+
+    //File that can be loaded in chrome://tracing
+    void writeChromeTrace(std::string path,
+                          const std::vector<std::string> &ruleNames);
+};
+
+#endif
@@ -13,6 +13,15 @@
 
 #include <trident/model/table.h>
 
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <vector>
 
 class TupleTable;
@@ -25,7 +34,9 @@ class RuleExecutor;
 
 class QSQR;
 
-enum QSQR_TaskType { RULE, QUERY, RULE_QUERY}; //Execute rule or query
+//Execute rule or query. QUERY_RULE executes only the rule currentRuleIndex
+//of a query, and is used by the concurrent evaluation
+enum QSQR_TaskType { RULE, QUERY, RULE_QUERY, QUERY_RULE};
 struct QSQR_Task {
     const QSQR_TaskType type;
 
@@ -49,6 +60,29 @@ struct QSQR_Task {
 
     QSQR_Task(QSQR_TaskType type, Predicate &p) : type(type), pred(p), repeat(false) {}
 };
+
+//Tasks that must be processed in LIFO order, as by the sequential
+//scheduler. In the concurrent evaluation, the rules of a subquery are
+//evaluated by child strands while the strand that issued the subquery
+//waits for them.
+struct QSQR_Strand {
+    std::vector<QSQR_Task> tasks;
+    QSQR_Strand *parent;
+    std::atomic<size_t> pendingChildren;
+    //Subqueries issued by the last processed task
+    std::vector<QSQR_Task> forks;
+    //Subqueries evaluated by the children
+    std::vector<QSQR_Task> waiting;
+
+    QSQR_Strand(QSQR_Strand *parent) : parent(parent), pendingChildren(0) {}
+};
+
+//Runnable strands of a thread. The owner takes the last one, the other
+//threads steal the first one
+struct QSQR_Worker {
+    boost::mutex mutex;
+    std::deque<QSQR_Strand*> strands;
+};
 #endif
 
 class QSQR {
@@ -67,16 +101,65 @@ private:
 #ifndef RECURSIVE_QSQR
     std::vector<QSQR_Task> tasks;
     void processTask(QSQR_Task &task);
+
+    //Concurrent evaluation
+    int nthreads;
+    boost::mutex mutex; //Protects the allocation of the tables and rules
+    boost::thread_specific_ptr<QSQR_Strand> currentStrand;
+    std::vector<std::unique_ptr<QSQR_Worker>> workers;
+    boost::mutex poolMutex;
+    boost::condition_variable poolCond;
+    std::atomic<size_t> nQueued;
+    std::atomic<bool> poolDone;
+    std::exception_ptr poolError;
+    //Strands that were running when their thread failed
+    std::vector<QSQR_Strand*> failedStrands;
+
+    //The strands are owned by the pool, not by the threads
+    static void keepStrand(QSQR_Strand *s) {
+    }
+
+    void evaluateConcurrently(Predicate &pred, BindingsTable *inputTable,
+                              size_t offsetInput);
+
+    void runWorker(const size_t id);
+
+    QSQR_Strand *nextStrand(const size_t id);
+
+    void schedule(QSQR_Strand *s, const size_t id);
+
+    void runStrand(QSQR_Strand *s, const size_t id);
+
+    //Creates a child strand for every rule of the subqueries in s->forks
+    void fork(QSQR_Strand *s, const size_t id);
+
+    void finishStrand(QSQR_Strand *s, const size_t id);
+
+    //Deletes the strands left by a failed evaluation, with their tasks
+    void drainStrands();
+
+    RuleExecutor *getRule(const Predicate &pred, const int idx);
 #endif
 
 
-    size_t calculateAllAnswers();
+    //Unique rows added to all the answer tables so far
+    std::atomic<size_t> nAnswers;
+
+    size_t calculateAllAnswers() {
+        return nAnswers;
+    }
 
     void createRules(Predicate &pred);
 
 public:
     QSQR(EDBLayer &layer, Program *program) : layer(layer),
-        program(program) {
+        program(program)
+#ifndef RECURSIVE_QSQR
+        , nthreads(1), currentStrand(&QSQR::keepStrand), nQueued(0),
+        poolDone(false)
+#endif
+        , nAnswers(0)
+    {
         for (int i = 0; i < MAX_NPREDS; ++i) {
             inputs[i] = NULL;
             answers[i] = NULL;
@@ -92,7 +175,18 @@ public:
 
 #ifndef RECURSIVE_QSQR
     void pushTask(QSQR_Task &task) {
-        tasks.push_back(task);
+        QSQR_Strand *s = currentStrand.get();
+        if (s != NULL) {
+            s->tasks.push_back(task);
+        } else {
+            tasks.push_back(task);
+        }
+    }
+
+    //Evaluate the queries with several threads. The EDB layer must support
+    //concurrent queries
+    void setNThreads(const int n) {
+        nthreads = n;
     }
 #endif
 
@@ -20,6 +20,7 @@ class Reasoner {
 private:
 
     const uint64_t threshold;
+    int qsqrThreads;
 
     void cleanBindings(std::vector<Term_t> &bindings, std::vector<uint8_t> * posJoins,
                        TupleTable *input);
@@ -44,7 +45,12 @@ private:
 
 public:
 
-    Reasoner(const uint64_t threshold) : threshold(threshold) {}
+    Reasoner(const uint64_t threshold) : threshold(threshold), qsqrThreads(1) {}
+
+    //Threads used by the top-down evaluation
+    void setQSQRThreads(const int n) {
+        qsqrThreads = n;
+    }
 
     size_t estimate(Literal &query, std::vector<uint8_t> *posBindings,
                     std::vector<Term_t> *valueBindings, EDBLayer &layer,
@@ -14,6 +14,9 @@ struct RuleExecutionDetails {
     const Literal *atomFailure = NULL;
 
     uint8_t nIDBs = 0;
+    //The rule can derive new facts only if one of these predicates has
+    //a block that is not older than lastExecution
+    std::vector<PredId_t> idbBodyPredicates;
     std::vector<RuleExecutionPlan> orderExecutions;
 
     std::vector<uint8_t> posEDBVarsInHead;
@@ -14,6 +14,10 @@ class TupleTable;
 
 //#define LINEAGE 1
 
+//Largest input on which a join builds a hash table. If both inputs are
+//larger, they are sorted and merged
+#define HASHJOIN_MAX_BUILD_ROWS 1000000
+
 #ifdef LINEAGE
 struct LineageInfo {
     Rule *adornedRule;
@@ -86,8 +90,18 @@ private:
 #endif
                      );
 
+    //Joins the bindings retrieved for a body atom with its supplementary
+    //relation. A merge join is used if both are already sorted on the join
+    //fields or if they are too large to be hashed
+    void joinBindings(TupleTable *retrieved, BindingsTable *supplRelation,
+                      const uint8_t bodyAtom, BindingsTable *output);
+
     void join(TupleTable *r1, TupleTable *r2, std::pair<uint8_t, uint8_t> *joins, uint8_t njoins, BindingsTable *output);
 
+    void hashJoin(TupleTable *r1, BindingsTable *r2, std::pair<uint8_t, uint8_t> *joins, uint8_t njoins, BindingsTable *output);
+
+    static bool isSortedBy(TupleTable *t, const std::vector<uint8_t> &fields);
+
     void copyLastRelInAnswers(QSQR *qsqr,
                               size_t nTuples,
                               BindingsTable **supplRelations,
@@ -117,6 +131,9 @@ public:
 
 #ifndef RECURSIVE_QSQR
     void processTask(QSQR_Task *task);
+
+    //Frees the suppl. relations of a RULE task that will not be processed
+    void discardTask(QSQR_Task *task);
 #endif
 
     string tostring() {
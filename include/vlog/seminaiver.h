@@ -6,10 +6,16 @@
 #include <vlog/fctable.h>
 #include <vlog/ruleexecplan.h>
 #include <vlog/ruleexecdetails.h>
+#include <vlog/spilledtable.h>
+#include <vlog/compactor.h>
+#include <vlog/profiler.h>
 #include <trident/model/table.h>
 
 #include <boost/chrono.hpp>
+#include <boost/thread.hpp>
 #include <vector>
+#include <map>
+#include <set>
 #include <unordered_map>
 
 namespace timens = boost::chrono;
@@ -34,6 +40,15 @@ struct StatsRule {
     StatsRule() : idRule(-1) {}
 };
 
+//Cost of all executions of a rule, used to prioritize the rules
+struct RuleCost {
+    size_t executions;
+    size_t productive;
+    double timems;
+    size_t derived;
+    RuleCost() : executions(0), productive(0), timems(0), derived(0) {}
+};
+
 struct StatsSizeIDB {
     size_t iteration;
     int idRule;
@@ -41,6 +56,32 @@ struct StatsSizeIDB {
 };
 
 typedef std::unordered_map<std::string, FCTable*> EDBCache;
+typedef std::map<PredId_t, std::shared_ptr<const Segment>> EDBUpdate;
+
+//Content of a FCBlock that is stored in a checkpoint
+struct CheckpointBlock {
+    PredId_t pred;
+    size_t firstIteration;
+    size_t iteration;
+    std::shared_ptr<const FCInternalTable> table;
+    Literal query;
+    int ruleid;
+    uint8_t ruleExecOrder;
+    bool isCompleted;
+
+    CheckpointBlock(PredId_t pred, const FCBlock &block) : pred(pred),
+        firstIteration(block.firstIteration), iteration(block.iteration), table(block.table), query(block.query),
+        ruleid(block.rule != NULL ? (int) block.rule->ruleid : -1),
+        ruleExecOrder(block.ruleExecOrder), isCompleted(block.isCompleted) {}
+};
+
+struct Checkpoint {
+    size_t iteration;
+    std::vector<std::pair<size_t, uint32_t>> lastExecutions;
+    std::vector<StatsRule> stats;
+    std::vector<CheckpointBlock> blocks;
+};
+
 class ResultJoinProcessor;
 class SemiNaiver {
 private:
@@ -55,6 +96,9 @@ private:
     std::vector<FCBlock> listDerivations;
     std::vector<StatsRule> statsRuleExecution;
 
+    bool costAwareOrder;
+    std::vector<RuleCost> ruleCosts;
+
 
 #ifdef WEBINTERFACE
     long statsLastIteration;
@@ -63,6 +107,23 @@ private:
     string allRules;
 #endif
 
+    //Checkpointing (see checkpoint.cpp)
+    std::string checkpointPath;
+    long checkpointInterval;
+    boost::chrono::system_clock::time_point lastCheckpoint;
+    boost::thread checkpointThread;
+    bool resumed;
+    std::map<size_t, uint32_t> resumedLastExecutions;
+
+    std::unique_ptr<SpillManager> spillManager;
+    //Memory of the tables that the SpillManager cannot move to disk
+    std::unordered_map<PredId_t, size_t> residentMemory;
+    size_t totalResidentMemory;
+
+    std::unique_ptr<Compactor> compactor;
+
+    std::unique_ptr<Profiler> profiler;
+
 private:
     FCIterator getTableFromIDBLayer(const Literal & literal, const size_t minIteration, TableFilterer *filter);
 
@@ -90,6 +151,17 @@ private:
                               std::vector<std::pair<uint8_t, uint8_t>> *filterValueVars,
                               ResultJoinProcessor *joinOutput);
 
+    void executeRemainingAtomsPartitioned(
+        std::shared_ptr<const FCInternalTable> firstResults,
+        const int startIdx,
+        RuleExecutionPlan &plan,
+        Literal &headLiteral,
+        FCTable *endTable,
+        const uint32_t iteration,
+        const RuleExecutionDetails &ruleDetails,
+        const uint8_t orderExecution,
+        int &processedTables);
+
     void reorderPlan(RuleExecutionPlan &plan,
                      const std::vector<size_t> &cards,
                      const Literal &headLiteral);
@@ -100,6 +172,53 @@ private:
                              const size_t minIteration,
                              const size_t maxIteration);
 
+    //Support for the incremental maintenance (see incremental.cpp)
+    Literal getGenericLiteral(const PredId_t pred);
+
+    //Temporary predicates in use
+    std::set<PredId_t> tmpPredicates;
+
+    Predicate newTmpPredicate(const uint8_t card);
+
+    Literal setTmpTable(const Literal &literal,
+                        std::shared_ptr<const Segment> rows);
+
+    void removeTmpTable(const PredId_t pred);
+
+    std::shared_ptr<const Segment> evaluateTmpRule(const Literal &head,
+            const std::vector<Literal> &body);
+
+    void addRows(FCTable *table, const Literal &literal,
+                 std::shared_ptr<const Segment> rows);
+
+    void deleteAndRederive(const EDBUpdate &deletions);
+
+    void propagateAdditions(const EDBUpdate &additions);
+
+    bool isRuleActive(const RuleExecutionDetails &ruleDetails) const;
+
+    void updateRuleCost(const size_t ruleIdx, const StatIteration &stat);
+
+    double getRuleScore(const size_t ruleIdx) const;
+
+    void computeRuleSCCs(std::vector<int> &sccs);
+
+    bool reorderRulesByCost(const std::vector<int> &sccs,
+                            std::vector<size_t> &ruleOrder);
+
+    void checkpointIfNeeded();
+
+    void updateResidentMemory(const PredId_t pred);
+
+    void spillIfNeeded(const Rule &rule);
+
+    void compactIfNeeded(const PredId_t pred);
+
+    const RuleExecutionDetails *getRuleDetails(const int ruleid) const;
+
+    static void writeCheckpoint(std::shared_ptr<Checkpoint> checkpoint,
+                                std::string path);
+
 protected:
     FCTable *predicatesTables[MAX_NPREDS];
     EDBLayer &layer;
@@ -144,6 +263,47 @@ public:
 
     void run(size_t lastIteration, size_t iteration);
 
+    //Incremental maintenance of a materialization computed with run().
+    //Both maps contain, per EDB predicate, the rows that were added to or
+    //removed from it. Deletions are handled with Delete-and-Rederive, then
+    //additions are propagated semi-naively. The EDB layer itself is not
+    //modified: the changes are kept in the tables of the EDB predicates.
+    void updateEDB(const EDBUpdate &additions, const EDBUpdate &deletions);
+
+    //Reads an update for updateEDB. Every line is "+ fact" or "- fact",
+    //where fact is a ground EDB atom written as in the rules
+    static void readUpdate(std::string pathFile, Program *program,
+                           EDBUpdate &additions, EDBUpdate &deletions);
+
+    //Periodically store the state of the materialization in path. The
+    //checkpoint is written in the background from an immutable snapshot of
+    //the tables. A value of intervalSeconds <= 0 disables checkpointing
+    void setCheckpoint(std::string path, const long intervalSeconds);
+
+    //Reorder the rules of each SCC after every pass, so that cheap rules
+    //that derive many new facts run first and rules that produce only
+    //duplicates run last
+    void setCostAwareOrder(const bool enabled);
+
+    //Record the time and the rows of every operator of the rule executions
+    void enableProfiling();
+
+    //Write the profile in <prefix>.json and, in the Chrome trace_event
+    //format, in <prefix>.trace.json
+    void writeProfile(std::string prefix);
+
+    //Merge in the background runs of small blocks that are not read
+    //separately anymore
+    void setCompaction(const bool enabled);
+
+    //Keep the derived blocks within budget bytes of memory. Sealed blocks
+    //that were not used recently are compressed and moved to dir
+    void setMemoryBudget(const size_t budget, std::string dir);
+
+    //Restore the state stored by setCheckpoint. Returns the iteration that
+    //must be passed to run() to continue the materialization
+    size_t loadCheckpoint(std::string path);
+
     void storeOnFiles(std::string path, const bool decompress,
                       const int minLevel);
 
@@ -156,6 +316,10 @@ public:
 
     size_t getSizeTable(const PredId_t predid) const;
 
+    //True if the rows of the EDB predicate are still the ones of the EDB
+    //layer, i.e. they were not changed by updateEDB
+    bool isEDBTableUnchanged(const PredId_t predid) const;
+
     std::vector<FCBlock> &getDerivationsSoFar() {
         return listDerivations;
     }
@@ -0,0 +1,159 @@
+#ifndef _SPILLEDTABLE_H
+#define _SPILLEDTABLE_H
+
+#include <vlog/fcinttable.h>
+
+#include <boost/thread.hpp>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//Blocks with fewer rows are never moved to disk
+#define SPILL_MIN_ROWS 1024
+
+class SpilledFCInternalTable;
+
+//Keeps the tables of sealed blocks within a memory budget. Tables that were
+//not accessed recently are compressed and moved to disk.
+class SpillManager {
+private:
+    const size_t budget;
+    const std::string dir;
+
+    boost::mutex mutex;
+    //Resident tables, the most recently used is at the front
+    std::list<SpilledFCInternalTable*> lru;
+    size_t usedMemory;
+    //Memory of the tables that cannot be moved to disk
+    size_t pinnedMemory;
+    size_t counter;
+
+    //Stats
+    size_t nspills;
+    size_t nloads;
+
+public:
+    SpillManager(const size_t budget, std::string dir);
+
+    std::string getNewFile();
+
+    void touch(SpilledFCInternalTable *table);
+
+    void loaded(SpilledFCInternalTable *table);
+
+    void unregister(SpilledFCInternalTable *table);
+
+    void setPinnedMemory(const size_t size);
+
+    //Move tables to disk until the memory budget is respected
+    void enforceBudget();
+
+    size_t getUsedMemory() const {
+        return usedMemory + pinnedMemory;
+    }
+
+    ~SpillManager();
+};
+
+//Wrapper around the table of a sealed block. The table is loaded from disk
+//when it is accessed and it can be evicted by the SpillManager.
+class SpilledFCInternalTable : public FCInternalTable {
+private:
+    friend class SpillManager;
+
+    SpillManager *manager;
+    const uint8_t nfields;
+    const size_t iteration;
+    const size_t nrows;
+    const bool sorted;
+    const std::string file;
+
+    mutable boost::mutex mutex;
+    mutable std::shared_ptr<const FCInternalTable> table;
+    mutable bool onDisk;
+    //Tables used by iterators that are still open. They cannot be evicted
+    mutable std::unordered_map<FCInternalTableItr*,
+            std::shared_ptr<const FCInternalTable>> openIterators;
+
+    //Used by the SpillManager
+    mutable std::list<SpilledFCInternalTable*>::iterator lruPos;
+    mutable bool resident;
+    mutable size_t accesses;
+
+    std::shared_ptr<const FCInternalTable> acquire() const;
+
+    FCInternalTableItr *registerIterator(FCInternalTableItr *itr,
+                                         std::shared_ptr<const FCInternalTable> t) const;
+
+    size_t getMemorySize() const {
+        return nrows * nfields * sizeof(Term_t);
+    }
+
+    //Returns false if the table is in use and cannot be evicted
+    bool evict();
+
+public:
+    SpilledFCInternalTable(SpillManager *manager,
+                           std::shared_ptr<const FCInternalTable> table,
+                           const size_t iteration);
+
+    bool isEmpty() const {
+        return nrows == 0;
+    }
+
+    uint8_t getRowSize() const {
+        return nfields;
+    }
+
+    size_t getNRows() const {
+        return nrows;
+    }
+
+    bool isSorted() const {
+        return sorted;
+    }
+
+    bool supportsDirectAccess() const;
+
+    std::shared_ptr<const FCInternalTable> cloneWithIteration(
+        const size_t iteration) const;
+
+    FCInternalTableItr *getIterator() const;
+
+    FCInternalTableItr *getSortedIterator() const;
+
+    FCInternalTableItr *getSortedIterator(int nthreads) const;
+
+    size_t estimateNRows(const uint8_t nconstantsToFilter,
+                         const uint8_t *posConstantsToFilter,
+                         const Term_t *valuesConstantsToFilter) const;
+
+    std::shared_ptr<const FCInternalTable> filter(
+        const uint8_t nPosToCopy, const uint8_t *posVarsToCopy,
+        const uint8_t nPosToFilter, const uint8_t *posConstantsToFilter,
+        const Term_t *valuesConstantsToFilter, const uint8_t nRepeatedVars,
+        const std::pair<uint8_t, uint8_t> *repeatedVars, int nthreads) const;
+
+    std::shared_ptr<Column> getColumn(const uint8_t columnIdx) const;
+
+    bool isColumnConstant(const uint8_t columnid) const;
+
+    Term_t getValueConstantColumn(const uint8_t columnid) const;
+
+    Term_t get(const size_t rowId, const uint8_t columnId) const;
+
+    std::shared_ptr<const FCInternalTable> merge(
+        std::shared_ptr<const FCInternalTable> t, int nthreads) const;
+
+    FCInternalTableItr *sortBy(const std::vector<uint8_t> &fields) const;
+
+    FCInternalTableItr *sortBy(const std::vector<uint8_t> &fields,
+                               const int nthreads) const;
+
+    void releaseIterator(FCInternalTableItr *itr) const;
+
+    ~SpilledFCInternalTable();
+};
+
+#endif
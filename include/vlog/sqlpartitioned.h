@@ -0,0 +1,86 @@
+#ifndef _SQL_PARTITIONED_H
+#define _SQL_PARTITIONED_H
+
+#include <vlog/edbiterator.h>
+#include <vlog/concepts.h>
+
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Rows that a scan thread reads before handing them to the consumer
+#define SQL_PARTITION_CHUNK_ROWS 4096
+//Chunks that a scan thread reads ahead of the consumer
+#define SQL_PARTITION_MAX_CHUNKS 8
+
+//Iterator over the union of queries on disjoint and increasing ranges of a
+//column. Every query is read by its own thread on its own connection. The
+//partitions are returned in order, so the result is sorted if every query
+//is sorted with that column first.
+class PartitionedSQLIterator : public EDBIterator {
+private:
+    struct Partition {
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        std::deque<std::vector<Term_t>> chunks;
+        bool done;
+        bool stopped;
+        //Exception raised by the scan, thrown again by the consumer
+        std::exception_ptr error;
+
+        Partition() : done(false), stopped(false) {}
+    };
+
+    const PredId_t predid;
+    const uint8_t arity;
+    const int posFirstVar;
+
+    std::vector<std::unique_ptr<Partition>> partitions;
+    std::vector<boost::thread> threads;
+
+    size_t currentPartition;
+    std::vector<Term_t> chunk;
+    size_t nextRow;
+    std::vector<Term_t> currentRow;
+
+    bool hasNextChecked;
+    bool hasNextValue;
+    bool isFirst;
+    bool skipDuplicatedFirst;
+
+    void scan(Partition *p, std::function<EDBIterator*()> open);
+
+    //Makes sure that chunk contains nextRow. False at the end
+    bool loadNextRow();
+
+public:
+    //Each element of queries opens the iterator over one partition
+    PartitionedSQLIterator(const PredId_t predid, const uint8_t arity,
+                           const int posFirstVar,
+                           std::vector<std::function<EDBIterator*()>> queries);
+
+    bool hasNext();
+
+    void next();
+
+    void clear();
+
+    void skipDuplicatedFirstColumn();
+
+    PredId_t getPredicateID() {
+        return predid;
+    }
+
+    Term_t getElementAt(const uint8_t p);
+
+    ~PartitionedSQLIterator();
+};
+
+#endif
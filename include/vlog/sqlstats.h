@@ -0,0 +1,64 @@
+#ifndef _SQL_STATS_H
+#define _SQL_STATS_H
+
+#include <vlog/concepts.h>
+
+#include <string>
+#include <vector>
+
+//Number of buckets of the histogram of each column
+#define SQLSTATS_NBUCKETS 64
+
+//Histogram of a column. Bucket i contains the values in
+//(upper[i - 1], upper[i]]. The buckets cover ranges of values of equal
+//width, so that the database computes them with a single GROUP BY
+struct SQLColumnStats {
+    uint64_t ndv;
+    Term_t min;
+    std::vector<Term_t> upper;
+    std::vector<uint64_t> rows;
+    std::vector<uint64_t> distinct;
+
+    SQLColumnStats() : ndv(0), min(0) {}
+
+    //Estimated number of rows with the value v. 0 only if there is none
+    double estimateRows(const Term_t v) const;
+};
+
+//Statistics of a SQL table, used to answer the cardinality questions of
+//the planner without running aggregate queries
+class SQLStats {
+private:
+    uint64_t nrows;
+    std::vector<SQLColumnStats> columns;
+
+public:
+    SQLStats() : nrows(0) {}
+
+    uint64_t getNRows() const {
+        return nrows;
+    }
+
+    void setNRows(const uint64_t n) {
+        nrows = n;
+    }
+
+    void addColumn(const SQLColumnStats &column) {
+        columns.push_back(column);
+    }
+
+    //True only if the literal has certainly no row
+    bool isEmpty(const Literal &query) const;
+
+    //Cardinality assuming independent columns. Never 0 unless isEmpty
+    size_t estimateCardinality(const Literal &query) const;
+
+    size_t estimateCardinalityColumn(const Literal &query,
+                                     const uint8_t posColumn) const;
+
+    bool load(std::string path, const size_t ncolumns);
+
+    void save(std::string path) const;
+};
+
+#endif
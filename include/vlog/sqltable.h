@@ -3,9 +3,76 @@
 
 #include <vlog/column.h>
 #include <vlog/sqltable.h>
+#include <vlog/sqlstats.h>
 #include <vlog/edbiterator.h>
 
+#include <boost/thread/mutex.hpp>
+
+#include <memory>
+#include <unordered_map>
+
+//Scans of at least this many rows are split among several connections
+#define SQL_PARALLEL_SCAN_THRESHOLD 100000
+//Number of ranges of a parallel scan
+#define SQL_SCAN_PARTITIONS 4
+
 class SQLTable : public EDBTable {
+private:
+    //Statistics of the table, collected at the first cardinality question
+    bool useStats;
+    string statsFile;
+    std::unique_ptr<SQLStats> stats;
+    boost::mutex statsMutex;
+    //Results of the count queries. The table does not change
+    std::unordered_map<string, size_t> exactCounts;
+
+    SQLStats *getStats(const Literal &query);
+
+    static string countKey(const Literal &query, const int posColumn);
+
+    static string selectFields(const std::vector<string> &fields);
+
+    string existsSubQuery(const Literal &l, const std::vector<uint8_t> &fields,
+                          const std::vector<string> &outerFields,
+                          const bool exists);
+
+    //Adds to output the candidate tuples (row by row) that match (exists)
+    //or do not match (!exists) a row of l on the given fields. Small sets
+    //are sent in batched IN lists, large ones in a temporary table
+    void semiJoin(const Literal &l, const std::vector<uint8_t> &fields,
+                  std::vector<Term_t> &candidates, const bool exists,
+                  std::vector<std::shared_ptr<ColumnWriter>> &output);
+
+protected:
+    virtual size_t exactCardinality(const Literal &query) = 0;
+
+    virtual size_t exactCardinalityColumn(const Literal &query,
+                                          uint8_t posColumn) = 0;
+
+    //"exact" runs a count query for every estimate. Otherwise the
+    //statistics are used, and kept in the given file if not empty
+    void initStatistics(string param);
+
+    //Executes a statement that returns no rows
+    virtual void executeUpdate(const string &sql) = 0;
+
+    //Iterator over the result of sql, which has ncolumns integer columns
+    virtual EDBIterator *executeQuery(const string &sql, const Literal &query,
+                                      const uint8_t ncolumns) = 0;
+
+    //Same as executeQuery, but on a connection of the pool so that it can
+    //run in another thread
+    virtual EDBIterator *executePooledQuery(const string &sql,
+                                            const Literal &query,
+                                            const uint8_t ncolumns) = 0;
+
+    //Splits a large scan into ranges of its first sorting field (or of its
+    //first variable) that are read in parallel. NULL if the scan is small,
+    //unless prefetch is set: then a small scan is read in one partition
+    EDBIterator *partitionedScan(const Literal &query,
+                                 const std::vector<uint8_t> *sortingFieldsIdx,
+                                 const bool prefetch);
+
 public:
     string tablename;
     std::vector<string> fieldTables;
@@ -27,15 +94,28 @@ public:
         uint8_t posInL2,
         size_t &sizeOutput);
 
+    //The partitions are read on connections of the pool
+    EDBIterator *getPrefetchingIterator(const Literal &query,
+                                        const std::vector<uint8_t> *fields);
+
     void releaseIterator(EDBIterator *itr);
 
     size_t estimateCardinality(const Literal &query);
 
+    size_t getCardinality(const Literal &query);
+
+    size_t getCardinalityColumn(const Literal &query, uint8_t posColumn);
+
     static string literalConstraintsToSQLQuery(const Literal &query,
                                     const std::vector<string> &fieldTables);
 
     static string repeatedToSQLQuery(const Literal &query,
                                     const std::vector<string> &fieldTables);
+
+    //Query that returns the ids and texts of the distinct ids in
+    //[start, end), and end to use for the next batch
+    static string dictTextsQuery(const std::vector<uint64_t> &ids,
+                                 const size_t start, size_t &end);
 };
 
 
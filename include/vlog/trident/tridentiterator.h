@@ -8,9 +8,13 @@
 
 #include <boost/thread/mutex.hpp>
 
+struct TridentQuerier;
+
 class TridentIterator : public EDBIterator {
 private:
     uint8_t nfields;
+    //Querier that created the iterator. It must also release it
+    TridentQuerier *owner;
 
     TridentTupleItr kbItr;
     PredId_t predid;
@@ -19,7 +23,7 @@ private:
     //long nconcepts;
 
 public:
-    TridentIterator() {
+    TridentIterator() : owner(NULL) {
         //nconcepts = 0;
     }
 
@@ -42,6 +46,14 @@ public:
         return predid;
     }
 
+    void setOwner(TridentQuerier *tq) {
+        owner = tq;
+    }
+
+    TridentQuerier *getOwner() {
+        return owner;
+    }
+
     bool isDuplicatedColumn() {
 	return duplicatedFirstColumn;
     }
@@ -4,14 +4,20 @@
 #include <vlog/trident/tridentiterator.h>
 #include <vlog/column.h>
 #include <vlog/edbtable.h>
+#include <vlog/connectionpool.h>
 
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <trident/kb/kb.h>
 #include <trident/kb/querier.h>
 //#include <trident/binarytables/binarytable.h>
 #include <kognac/factory.h>
 
+//Values to check above which checkNewIn is split in partitions
+#define TRIDENT_ANTIJOIN_PARALLEL_THRESHOLD 1000000
+#define TRIDENT_ANTIJOIN_MAXPARTITIONS 8
+
 class SeqColumnWriter : public SequenceWriter {
 private:
     ColumnWriter *writer;
@@ -24,18 +30,51 @@ public:
     }
 };
 
+//Trident queriers are not thread-safe, but several queriers can read
+//the same KB concurrently. In multithreaded mode every thread gets its
+//own querier and pool of iterators, so that EDB lookups do not wait on
+//each other. The mutex of a querier is uncontended unless an iterator
+//is consumed by another thread than the one that created it.
+struct TridentQuerier {
+    Querier *q;
+    Factory<TridentIterator> itrFactory;
+    boost::mutex mutex;
+
+    TridentQuerier(Querier *q) : q(q) {
+    }
+
+    ~TridentQuerier() {
+        delete q;
+    }
+};
+
 class TridentTable: public EDBTable {
 
 private:
 
     KB *kb;
-    Querier *q;
+    TridentQuerier *mainQuerier;
+    boost::thread_specific_ptr<TridentQuerier> threadQuerier;
     DictMgmt *dict;
-    Factory<TridentIterator> kbItrFactory;
     boost::mutex mutex;
     bool multithreaded;
+    //Queriers of the partitions of the anti-joins
+    std::unique_ptr<ConnectionPool<TridentQuerier*>> partitionQueriers;
+
+    //Queriers of the threads, deleted with the table before the KB
+    std::vector<TridentQuerier*> queriers;
 
-    TridentIterator *getTridentIter();
+    //The queriers are owned by the table, not by the threads
+    static void keepQuerier(TridentQuerier *tq) {
+    }
+
+    TridentQuerier *getThreadQuerier();
+
+    boost::mutex *getMutex(TridentQuerier *tq) {
+        return multithreaded ? &tq->mutex : NULL;
+    }
+
+    TridentIterator *getTridentIter(TridentQuerier *tq);
 
     std::vector<std::shared_ptr<Column>> performAntiJoin(const Literal &l1,
                                       std::vector<uint8_t> &pos1, const Literal &l2,
@@ -48,6 +87,15 @@ private:
                                           const Literal &l,
                                           std::vector<uint8_t> &pos);
 
+    //Splits the sorted values to check in ranges of keys and merges the
+    //ranges with the KB in parallel
+    std::vector<std::shared_ptr<Column>> parallelAntiJoin(
+                                          std::vector<std::shared_ptr<Column>>
+                                          &valuesToCheck,
+                                          const Literal &l,
+                                          std::vector<uint8_t> &pos,
+                                          const bool firstCol);
+
     void getQueryFromEDBRelation0(QSQQuery *query, TupleTable *outputTable);
 
     void getQueryFromEDBRelation12(QSQQuery *query, TupleTable *outputTable,
@@ -66,12 +114,23 @@ private:
 
 
 public:
-    TridentTable(string kbDir, bool multithreaded) {
+    TridentTable(string kbDir, bool multithreaded) :
+        threadQuerier(&TridentTable::keepQuerier) {
         KBConfig config;
         kb = new KB(kbDir.c_str(), true, false, true, config);
-        q = kb->query();
+        mainQuerier = new TridentQuerier(kb->query());
         dict = kb->getDictMgmt();
         this->multithreaded = multithreaded;
+        partitionQueriers = std::unique_ptr<ConnectionPool<TridentQuerier*>>(
+                                new ConnectionPool<TridentQuerier*>(
+        [this]() {
+            //As in getThreadQuerier
+            boost::mutex::scoped_lock lock(mutex);
+            return new TridentQuerier(kb->query());
+        },
+        [](TridentQuerier * tq) {
+            delete tq;
+        }));
     }
 
     std::vector<std::shared_ptr<Column>> checkNewIn(const Literal &l1,
@@ -97,7 +156,7 @@ public:
                std::vector<Term_t> *valuesToFilter);
 
     Querier *getQuerier() {
-        return q;
+        return getThreadQuerier()->q;
     }
 
     KB *getKB() {
@@ -115,6 +174,10 @@ public:
 
     EDBIterator *getIterator(const Literal &query);
 
+    //Only in multithreaded mode, where the iterators lock their querier
+    EDBIterator *getPrefetchingIterator(const Literal &query,
+                                        const std::vector<uint8_t> *fields);
+
     EDBIterator *getSortedIterator(const Literal &query,
                                    const std::vector<uint8_t> &fields);
 
@@ -127,10 +190,7 @@ public:
 
     void releaseIterator(EDBIterator *itr);
 
-    ~TridentTable() {
-        delete q;
-        delete kb;
-    }
+    ~TridentTable();
 
 };
 
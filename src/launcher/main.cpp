@@ -7,6 +7,7 @@
 #include <vlog/webinterface.h>
 #include <vlog/fcinttable.h>
 #include <vlog/exporter.h>
+#include <vlog/inmemory/mmaptable.h>
 
 //Used to load a Trident KB
 #include <launcher/vloglayer.h>
@@ -37,6 +38,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
 // #include <boost/sort/spreadsort/integer_sort.hpp>
 
 //TBB
@@ -84,6 +86,7 @@ void printHelp(const char *programName, po::options_description &desc) {
     cout << "queryLiteral\t\t execute a Literal query." << endl;
     cout << "server\t\t starts in server mode." << endl;
     cout << "load\t\t load a Trident KB." << endl;
+    cout << "convert\t\t convert the EDB relations to the binary format of MMAP tables." << endl;
     cout << "lookup\t\t lookup for values in the dictionary." << endl << endl;
 
     cout << desc << endl;
@@ -107,7 +110,8 @@ bool checkParams(po::variables_map &vm, int argc, const char** argv,
     }
 
     if (cmd != "help" && cmd != "query" && cmd != "lookup" && cmd != "load" && cmd != "queryLiteral"
-            && cmd != "mat" && cmd != "rulesgraph" && cmd != "server") {
+            && cmd != "mat" && cmd != "rulesgraph" && cmd != "server"
+            && cmd != "convert") {
         printErrorMsg(
                 (string("The command \"") + cmd + string("\" is unknown.")).c_str());
         return false;
@@ -146,6 +150,12 @@ bool checkParams(po::variables_map &vm, int argc, const char** argv,
                         "Both the -t and -n parameters are set, and this is ambiguous. Please choose either one or the other.");
                 return false;
             }
+        } else if (cmd == "convert") {
+            if (!vm.count("output")) {
+                printErrorMsg(
+                        "The parameter -o (directory where to write the converted relations) is not set.");
+                return false;
+            }
         } else if (cmd == "load") {
             if (!vm.count("input") and !vm.count("comprinput")) {
                 printErrorMsg(
@@ -207,6 +217,11 @@ bool checkParams(po::variables_map &vm, int argc, const char** argv,
                             path + string("' does not exists")).c_str());
                 return false;
             }
+            string ruleorder = vm["ruleorder"].as<string>();
+            if (ruleorder != "static" && ruleorder != "cost") {
+                printErrorMsg("The parameter --ruleorder must be either 'static' or 'cost'");
+                return false;
+            }
         }
     }
 
@@ -235,7 +250,7 @@ bool initParams(int argc, const char** argv, po::variables_map &vm) {
     query_options.add_options()("premat", po::value<string>()->default_value(""),
             "Pre-materialize the atoms in the file passed as argument. Default is '' (disabled).");
     query_options.add_options()("multithreaded",
-            "Run multithreaded (currently only supported for <mat>).");
+            "Run multithreaded (currently only supported for <mat> and for the qsqr algorithm of <queryLiteral>).");
     query_options.add_options()("nthreads", po::value<int>()->default_value(tbb::task_scheduler_init::default_num_threads() / 2),
             string("Set maximum number of threads to use when run in multithreaded mode. Default is " + to_string(tbb::task_scheduler_init::default_num_threads() / 2)).c_str());
     query_options.add_options()("interRuleThreads", po::value<int>()->default_value(0),
@@ -250,10 +265,28 @@ bool initParams(int argc, const char** argv, po::variables_map &vm) {
             "Directory where to store all results of the materialization. Default is '' (disable).");
     query_options.add_options()("storemat_format", po::value<string>()->default_value("files"),
             "Format in which to dump the materialization. 'files' simply dumps the IDBs in files. 'db' creates a new RDF database. Default is 'files'.");
+    query_options.add_options()("checkpoint_path", po::value<string>()->default_value(""),
+            "File where to periodically store a checkpoint of the materialization (only for <mat>). Default is '' (disabled).");
+    query_options.add_options()("checkpoint_interval", po::value<long>()->default_value(600),
+            "Minimum number of seconds between two checkpoints. Default is 600.");
+    query_options.add_options()("resume",
+            "Resume the materialization from the checkpoint in <checkpoint_path>.");
+    query_options.add_options()("update", po::value<string>()->default_value(""),
+            "File with EDB facts to add (lines '+ fact') or remove (lines '- fact') after the materialization, which is then updated incrementally (only for <mat>). Default is '' (disabled).");
+    query_options.add_options()("memory_budget", po::value<long>()->default_value(0),
+            "Maximum number of MB used by the derived blocks during the materialization. Older blocks are compressed and moved to disk. Default is 0 (unlimited).");
+    query_options.add_options()("spill_path", po::value<string>()->default_value(""),
+            "Directory where to move the blocks that exceed the memory budget. Default is a temporary directory.");
+    query_options.add_options()("profile", po::value<string>()->default_value(""),
+            "Profile the rule executions of <mat> and write the report in <arg>.json and a Chrome trace in <arg>.trace.json. Default is '' (disabled).");
     query_options.add_options()("explain", po::value<bool>()->default_value(false),
             "Explain the query instead of executing it. Default is false.");
     query_options.add_options()("decompressmat", po::value<bool>()->default_value(false),
             "Decompress the results of the materialization when we write it to a file. Default is false.");
+    query_options.add_options()("prefetch", po::value<bool>()->default_value(false),
+            "Read the EDB tables that are on disk or in a database in a background thread, ahead of the joins. SQL tables use their own connections, Trident tables only with --multithreaded. Default is false.");
+    query_options.add_options()("answer_cache", po::value<long>()->default_value(0),
+            "Maximum number of MB used to keep the answers of the queries, so that the queries subsumed by a previous one are not evaluated again. Default is 0 (disabled).");
 
 #ifdef WEBINTERFACE
     query_options.add_options()("webinterface", po::value<bool>()->default_value(false),
@@ -265,6 +298,12 @@ bool initParams(int argc, const char** argv, po::variables_map &vm) {
             "Disable filter optimization.");
     query_options.add_options()("no-intersect",
             "Disable intersection optimization.");
+    query_options.add_options()("compaction",
+            "Merge the small blocks of the derivations in a background thread (only for <mat>). Default is disabled.");
+    query_options.add_options()("targets", po::value<string>()->default_value(""),
+            "Comma-separated list of predicates. If set, <mat> only materializes these predicates and the ones they depend on. Default is all predicates.");
+    query_options.add_options()("ruleorder", po::value<string>()->default_value("static"),
+            "Order in which the rules are executed (only for <mat>). 'static' follows the program. 'cost' reorders the rules of each recursive component by their past execution time and number of new derivations. Default is 'static'.");
     query_options.add_options()("graphfile", po::value<string>(),
             "Path to store the rule dependency graph");
 
@@ -272,7 +311,7 @@ bool initParams(int argc, const char** argv, po::variables_map &vm) {
     load_options.add_options()("input,i", po::value<string>(),
             "Path to the files that contain the compressed triples. This parameter is REQUIRED if already compressed triples/dict are not provided.");
     load_options.add_options()("output,o", po::value<string>(),
-            "Path to the KB that should be created. This parameter is REQUIRED.");
+            "Path to the KB that should be created. For <convert>, the directory where to write the relations. This parameter is REQUIRED.");
     load_options.add_options()("maxThreads",
             po::value<int>()->default_value(Utils::getNumberPhysicalCores()),
             "Sets the maximum number of threads to use during the compression. Default is the number of physical cores");
@@ -383,6 +422,21 @@ void launchFullMat(int argc,
     Program p(db.getNTerms(), &db);
     p.readFromFile(pathRules);
 
+    std::vector<std::string> names, targets;
+    boost::split(names, vm["targets"].as<string>(), boost::is_any_of(","));
+    for (auto &name : names) {
+        boost::trim(name);
+        if (name != "") {
+            targets.push_back(name);
+        }
+    }
+    if (!targets.empty()) {
+        //Only keep the rules needed for the target predicates
+        int removed = p.sliceForPredicates(targets);
+        BOOST_LOG_TRIVIAL(info) << "Removed " << removed <<
+            " rules not needed for the targets. Remaining: " << p.getNRules();
+    }
+
     //Set up the ruleset and perform the pre-materialization if necessary
     {
         if (!vm["automat"].empty()) {
@@ -440,10 +494,46 @@ void launchFullMat(int argc,
 
         BOOST_LOG_TRIVIAL(info) << "Starting full materialization";
         timens::system_clock::time_point start = timens::system_clock::now();
-        sn->run();
+        sn->setCompaction(!vm["compaction"].empty());
+        sn->setCostAwareOrder(vm["ruleorder"].as<string>() == "cost");
+        if (vm["profile"].as<string>() != "") {
+            sn->enableProfiling();
+        }
+        if (vm["memory_budget"].as<long>() > 0) {
+            string spillPath = vm["spill_path"].as<string>();
+            if (spillPath == "") {
+                spillPath = (fs::temp_directory_path() /
+                        fs::unique_path("vlog-%%%%-%%%%")).string();
+            }
+            sn->setMemoryBudget(vm["memory_budget"].as<long>() * 1024 * 1024,
+                    spillPath);
+        }
+        string checkpointPath = vm["checkpoint_path"].as<string>();
+        sn->setCheckpoint(checkpointPath, vm["checkpoint_interval"].as<long>());
+        if (!vm["resume"].empty()) {
+            if (checkpointPath == "" || !fs::exists(checkpointPath)) {
+                BOOST_LOG_TRIVIAL(error) << "No checkpoint to resume from";
+                return;
+            }
+            size_t it = sn->loadCheckpoint(checkpointPath);
+            sn->run(0, it);
+        } else {
+            sn->run();
+        }
         boost::chrono::duration<double> sec = boost::chrono::system_clock::now() - start;
         BOOST_LOG_TRIVIAL(info) << "Runtime materialization = " << sec.count() * 1000 << " milliseconds";
+        BOOST_LOG_TRIVIAL(info) << "EDB cardinality cache: " << db.getCardinalityCache().getHits() << " hits, " << db.getCardinalityCache().getMisses() << " misses";
         sn->printCountAllIDBs();
+        if (vm["update"].as<string>() != "") {
+            EDBUpdate additions, deletions;
+            SemiNaiver::readUpdate(vm["update"].as<string>(), &p,
+                                   additions, deletions);
+            sn->updateEDB(additions, deletions);
+            sn->printCountAllIDBs();
+        }
+        if (vm["profile"].as<string>() != "") {
+            sn->writeProfile(vm["profile"].as<string>());
+        }
 
         if (vm["storemat_path"].as<string>() != "") {
             timens::system_clock::time_point start = timens::system_clock::now();
@@ -694,23 +784,37 @@ void runLiteralQuery(EDBLayer &edb, Program &p, Literal &literal, Reasoner &reas
 	cout << (iter->hasNext() ? "TRUE" : "FALSE") << endl;
 	count = (iter->hasNext() ? 1 : 0);
     } else {
-	while (iter->hasNext()) {
+	//Rows are buffered to resolve their terms at once
+	std::vector<uint64_t> values;
+	std::vector<std::string> texts;
+	std::vector<bool> found;
+	bool more = iter->hasNext();
+	while (more) {
 	    iter->next();
 	    count++;
 	    for (int i = 0; i < sz; i++) {
-		char supportText[MAX_TERM_SIZE];
-		uint64_t value = iter->getElementAt(i);
-		if (i != 0) {
+		values.push_back(iter->getElementAt(i));
+	    }
+	    more = iter->hasNext();
+	    if (values.size() < EXPORT_DICT_BATCH * sz && more) {
+		continue;
+	    }
+	    edb.getDictTexts(values, texts, found);
+	    for (size_t j = 0; j < values.size(); j++) {
+		if (j % sz != 0) {
 		    cout << " ";
 		}
-		if (!edb.getDictText(value, supportText)) {
-		    cerr << "Term " << value << " not found" << endl;
-		    cout << value;
+		if (!found[j]) {
+		    cerr << "Term " << values[j] << " not found" << endl;
+		    cout << values[j];
 		} else {
-		    cout << supportText;
+		    cout << texts[j];
+		}
+		if (j % sz == sz - 1) {
+		    cout << endl;
 		}
 	    }
-	    cout << endl;
+	    values.clear();
 	}
     }
     boost::chrono::duration<double> durationQ1 = boost::chrono::system_clock::now() - startQ1;
@@ -800,6 +904,9 @@ void execLiteralQuery(EDBLayer &edb, po::variables_map &vm) {
     }
     Literal literal = p.parseLiteral(query);
     Reasoner reasoner(vm["reasoningThreshold"].as<long>());
+    if (!vm["multithreaded"].empty()) {
+        reasoner.setQSQRThreads(vm["nthreads"].as<int>());
+    }
     runLiteralQuery(edb, p, literal, reasoner, vm);
 }
 
@@ -864,7 +971,11 @@ int main(int argc, const char** argv) {
 
     if (cmd == "query" || cmd == "queryLiteral") {
         EDBConf conf(edbFile);
-        EDBLayer *layer = new EDBLayer(conf, false);
+        EDBLayer *layer = new EDBLayer(conf, cmd == "queryLiteral" &&
+                                       !vm["multithreaded"].empty());
+        layer->setPrefetching(vm["prefetch"].as<bool>());
+        layer->getAnswerCache().setCapacity(vm["answer_cache"].as<long>() *
+                                            1024 * 1024 / sizeof(Term_t));
 
         //Execute the query
         if (cmd == "query") {
@@ -872,6 +983,9 @@ int main(int argc, const char** argv) {
         } else {
             execLiteralQuery(*layer, vm);
         }
+        if (layer->getAnswerCache().isEnabled()) {
+            BOOST_LOG_TRIVIAL(info) << "Answer cache: " << layer->getAnswerCache().getHits() << " hits, " << layer->getAnswerCache().getMisses() << " misses";
+        }
         delete layer;
     } else if (cmd == "lookup") {
         EDBConf conf(edbFile);
@@ -881,6 +995,7 @@ int main(int argc, const char** argv) {
     } else if (cmd == "mat") {
         EDBConf conf(edbFile);
         EDBLayer *layer = new EDBLayer(conf, ! vm["multithreaded"].empty());
+        layer->setPrefetching(vm["prefetch"].as<bool>());
         // EDBLayer layer(conf, false);
         launchFullMat(argc, argv, full_path.string(), *layer, vm,
                 vm["rules"].as<string>());
@@ -891,6 +1006,11 @@ int main(int argc, const char** argv) {
         writeRuleDependencyGraph(*layer, vm["rules"].as<string>(),
                 vm["graphfile"].as<string>());
         delete layer;
+    } else if (cmd == "convert") {
+        EDBConf conf(edbFile);
+        EDBLayer *layer = new EDBLayer(conf, false);
+        MmapTable::convert(*layer, vm["output"].as<string>());
+        delete layer;
     } else if (cmd == "load") {
         Loader *loader = new Loader();
         bool onlyCompress = false;
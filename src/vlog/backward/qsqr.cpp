@@ -6,10 +6,12 @@
 #include <trident/iterators/arrayitr.h>
 
 #include <cstring>
+#include <set>
 #include <unordered_map>
 
 BindingsTable *QSQR::getInputTable(const Predicate pred) {
     //raiseIfExpired();
+    boost::mutex::scoped_lock lock(mutex);
     BindingsTable **table = inputs[pred.getId()];
     if (table == NULL) {
         const uint8_t maxAdornments = (uint8_t)pow(2, pred.getCardinality());
@@ -20,12 +22,15 @@ BindingsTable *QSQR::getInputTable(const Predicate pred) {
     }
     if (table[pred.getAdorment()] == NULL) {
         table[pred.getAdorment()] = new BindingsTable(pred.getCardinality(), pred.getAdorment());
+        if (nthreads > 1)
+            table[pred.getAdorment()]->setConcurrent();
     }
     return table[pred.getAdorment()];
 }
 
 BindingsTable *QSQR::getAnswerTable(const Predicate pred, uint8_t adornment) {
     //raiseIfExpired();
+    boost::mutex::scoped_lock lock(mutex);
     BindingsTable **table = answers[pred.getId()];
     if (table == NULL) {
         const uint8_t maxAdornments = (uint8_t)pow(2, pred.getCardinality());
@@ -36,6 +41,9 @@ BindingsTable *QSQR::getAnswerTable(const Predicate pred, uint8_t adornment) {
     }
     if (table[adornment] == NULL) {
         table[adornment] = new BindingsTable(pred.getCardinality());
+        table[adornment]->setCounter(&nAnswers);
+        if (nthreads > 1)
+            table[adornment]->setConcurrent();
     }
     return table[adornment];
 }
@@ -83,20 +91,6 @@ void QSQR::deallocateAllRules() {
     }
 }
 
-size_t QSQR::calculateAllAnswers() {
-    size_t total = 0;
-    for (int i = 0; i < MAX_NPREDS; ++i) {
-        if (answers[i] != NULL) {
-            for (uint32_t j = 0; j < sizePreds[i]; ++j) {
-                if (answers[i][j] != NULL) {
-                    total += answers[i][j]->getNTuples();
-                }
-            }
-        }
-    }
-    return total;
-}
-
 void QSQR::cleanAllInputs() {
     for (int i = 0; i < MAX_NPREDS; ++i) {
         if (inputs[i] != NULL) {
@@ -111,6 +105,7 @@ void QSQR::cleanAllInputs() {
 
 void QSQR::createRules(Predicate &pred) {
     //check if the adorned rules are created. If not, then create them.
+    boost::mutex::scoped_lock lock(mutex);
     if (rules[pred.getId()] == NULL) {
         const uint16_t maxAdornments = (uint16_t)pow(2, pred.getCardinality());
         rules[pred.getId()] = new RuleExecutor**[maxAdornments];
@@ -198,7 +193,17 @@ void QSQR::evaluate(Predicate &pred, BindingsTable *inputTable,
 #else
     createRules(pred);
     size_t sz = program->getAllRulesByPredicate(pred.getId())->size();
-    if (sz > 0) {
+    QSQR_Strand *strand = currentStrand.get();
+    if (sz > 0 && strand != NULL) {
+        //The strand waits for the rules of the subquery once the current
+        //task is processed
+        QSQR_Task task(QSQR_TaskType::QUERY, pred);
+        task.inputTable = inputTable;
+        task.offsetInput = offsetInput;
+        task.repeat = repeat;
+        task.totalAnswers = calculateAllAnswers();
+        strand->forks.push_back(task);
+    } else if (sz > 0) {
 	QSQR_Task task(QSQR_TaskType::QUERY, pred);
 	task.currentRuleIndex = 1;
 	task.inputTable = inputTable;
@@ -250,6 +255,11 @@ void QSQR::processTask(QSQR_Task &task) {
         }
         break;
     }
+    case QUERY_RULE: {
+        RuleExecutor *exec = getRule(task.pred, task.currentRuleIndex);
+        exec->evaluate(task.inputTable, task.offsetInput, this, layer);
+        break;
+    }
     case RULE:
     case RULE_QUERY:
         RuleExecutor *exec = task.executor;
@@ -257,6 +267,232 @@ void QSQR::processTask(QSQR_Task &task) {
         break;
     }
 }
+
+RuleExecutor *QSQR::getRule(const Predicate &pred, const int idx) {
+    boost::mutex::scoped_lock lock(mutex);
+    return rules[pred.getId()][pred.getAdorment()][idx];
+}
+
+void QSQR::evaluateConcurrently(Predicate &pred, BindingsTable *inputTable,
+                                size_t offsetInput) {
+    createRules(pred);
+    if (program->getAllRulesByPredicate(pred.getId())->empty()) {
+        return;
+    }
+
+    workers.clear();
+    for (int i = 0; i < nthreads; ++i) {
+        workers.push_back(std::unique_ptr<QSQR_Worker>(new QSQR_Worker()));
+    }
+    nQueued = 0;
+    poolDone = false;
+    poolError = std::exception_ptr();
+    failedStrands.clear();
+
+    //The root strand has no tasks. It completes when all the rules of the
+    //query are evaluated
+    QSQR_Strand root(NULL);
+    QSQR_Task task(QSQR_TaskType::QUERY, pred);
+    task.inputTable = inputTable;
+    task.offsetInput = offsetInput;
+    task.repeat = false;
+    task.totalAnswers = calculateAllAnswers();
+    root.forks.push_back(task);
+    fork(&root, 0);
+
+    std::vector<boost::thread> threads;
+    for (int i = 0; i < nthreads; ++i) {
+        threads.push_back(boost::thread(&QSQR::runWorker, this, i));
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    if (poolError) {
+        drainStrands();
+        workers.clear();
+        std::rethrow_exception(poolError);
+    }
+    workers.clear();
+}
+
+void QSQR::drainStrands() {
+    //The queued strands, the failed ones and the strands suspended on them.
+    //The root is on the stack
+    std::set<QSQR_Strand*> strands;
+    std::vector<QSQR_Strand*> toVisit(failedStrands);
+    for (auto &w : workers) {
+        toVisit.insert(toVisit.end(), w->strands.begin(), w->strands.end());
+        w->strands.clear();
+    }
+    for (auto s : toVisit) {
+        while (s != NULL && s->parent != NULL && strands.insert(s).second) {
+            s = s->parent;
+        }
+    }
+    //Only the RULE tasks own their suppl. relations
+    std::set<BindingsTable**> supplRelations;
+    for (auto s : strands) {
+        for (auto &task : s->tasks) {
+            if (task.type == QSQR_TaskType::RULE &&
+                    supplRelations.insert(task.supplRelations).second) {
+                task.executor->discardTask(&task);
+            }
+        }
+        delete s;
+    }
+    failedStrands.clear();
+    nQueued = 0;
+}
+
+void QSQR::schedule(QSQR_Strand *s, const size_t id) {
+    {
+        boost::mutex::scoped_lock lock(workers[id]->mutex);
+        workers[id]->strands.push_back(s);
+    }
+    boost::mutex::scoped_lock lock(poolMutex);
+    nQueued++;
+    poolCond.notify_one();
+}
+
+QSQR_Strand *QSQR::nextStrand(const size_t id) {
+    {
+        QSQR_Worker *w = workers[id].get();
+        boost::mutex::scoped_lock lock(w->mutex);
+        if (!w->strands.empty()) {
+            QSQR_Strand *s = w->strands.back();
+            w->strands.pop_back();
+            nQueued--;
+            return s;
+        }
+    }
+    //Steal from the others
+    for (size_t i = 1; i < workers.size(); ++i) {
+        QSQR_Worker *w = workers[(id + i) % workers.size()].get();
+        boost::mutex::scoped_lock lock(w->mutex);
+        if (!w->strands.empty()) {
+            QSQR_Strand *s = w->strands.front();
+            w->strands.pop_front();
+            nQueued--;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+void QSQR::runWorker(const size_t id) {
+    while (!poolDone) {
+        QSQR_Strand *s = nextStrand(id);
+        if (s != NULL) {
+            try {
+                runStrand(s, id);
+            } catch (...) {
+                BOOST_LOG_TRIVIAL(error) << "Concurrent QSQ-R evaluation failed";
+                currentStrand.reset(NULL);
+                boost::mutex::scoped_lock lock(poolMutex);
+                if (!poolError)
+                    poolError = std::current_exception();
+                poolDone = true;
+                poolCond.notify_all();
+                return;
+            }
+        } else {
+            boost::mutex::scoped_lock lock(poolMutex);
+            while (!poolDone && nQueued == 0) {
+                poolCond.wait(lock);
+            }
+            if (poolDone) {
+                return;
+            }
+        }
+    }
+}
+
+void QSQR::runStrand(QSQR_Strand *s, const size_t id) {
+    currentStrand.reset(s);
+    while (!s->tasks.empty()) {
+        QSQR_Task task = s->tasks.back();
+        s->tasks.pop_back();
+        try {
+            processTask(task);
+        } catch (...) {
+            boost::mutex::scoped_lock lock(poolMutex);
+            failedStrands.push_back(s);
+            throw;
+        }
+        if (!s->forks.empty()) {
+            //Suspend the strand until the subqueries are evaluated
+            currentStrand.reset(NULL);
+            fork(s, id);
+            return;
+        }
+    }
+    currentStrand.reset(NULL);
+    finishStrand(s, id);
+}
+
+void QSQR::fork(QSQR_Strand *s, const size_t id) {
+    std::vector<QSQR_Task> waiting;
+    waiting.swap(s->forks);
+    std::vector<QSQR_Strand*> children;
+    for (auto &query : waiting) {
+        size_t sz = program->getAllRulesByPredicate(query.pred.getId())->size();
+        for (size_t i = 0; i < sz; ++i) {
+            QSQR_Strand *child = new QSQR_Strand(s);
+            QSQR_Task task(QSQR_TaskType::QUERY_RULE, query.pred);
+            task.currentRuleIndex = (int) i;
+            task.inputTable = query.inputTable;
+            task.offsetInput = query.offsetInput;
+            child->tasks.push_back(task);
+            children.push_back(child);
+        }
+    }
+    s->waiting.clear();
+    for (auto &query : waiting) {
+        s->waiting.push_back(query);
+    }
+    s->pendingChildren = children.size();
+    if (children.empty()) {
+        schedule(s, id);
+    }
+    for (auto child : children) {
+        schedule(child, id);
+    }
+}
+
+void QSQR::finishStrand(QSQR_Strand *s, const size_t id) {
+    QSQR_Strand *parent = s->parent;
+    if (parent == NULL) {
+        //The root strand: the evaluation is over
+        boost::mutex::scoped_lock lock(poolMutex);
+        poolDone = true;
+        poolCond.notify_all();
+        return;
+    }
+    delete s;
+    if (--parent->pendingChildren == 0) {
+        //Repeat the subqueries that produced new answers, as the sequential
+        //scheduler does
+        for (auto &query : parent->waiting) {
+            if (query.repeat) {
+                size_t newAnswers = calculateAllAnswers();
+                if (newAnswers > query.totalAnswers) {
+                    QSQR_Task task(QSQR_TaskType::QUERY, query.pred);
+                    task.inputTable = query.inputTable;
+                    task.offsetInput = query.offsetInput;
+                    task.repeat = true;
+                    task.totalAnswers = newAnswers;
+                    parent->forks.push_back(task);
+                }
+            }
+        }
+        parent->waiting.clear();
+        if (!parent->forks.empty()) {
+            fork(parent, id);
+        } else {
+            schedule(parent, id);
+        }
+    }
+}
 #endif
 
 TupleTable *QSQR::evaluateQuery(int evaluateOrEstimate, QSQQuery *query,
@@ -320,7 +556,15 @@ TupleTable *QSQR::evaluateQuery(int evaluateOrEstimate, QSQQuery *query,
                 totalAnswers = calculateAllAnswers();
 
                 if (evaluateOrEstimate == QSQR_EVAL) {
+#ifndef RECURSIVE_QSQR
+                    if (nthreads > 1) {
+                        evaluateConcurrently(pred2, inputTable, 0);
+                    } else {
+                        evaluate(pred2, inputTable, 0, false);
+                    }
+#else
                     evaluate(pred2, inputTable, 0, false);
+#endif
 #ifndef RECURSIVE_QSQR
                     //evaluate in this case is not recursive. Process the tasks
                     //until the queue is empty
@@ -347,7 +591,15 @@ TupleTable *QSQR::evaluateQuery(int evaluateOrEstimate, QSQQuery *query,
                 inputTable->addTuple(query->getLiteral());
                 if (evaluateOrEstimate == QSQR_EVAL) {
                     totalAnswers = calculateAllAnswers();
+#ifndef RECURSIVE_QSQR
+                    if (nthreads > 1) {
+                        evaluateConcurrently(pred, inputTable, 0);
+                    } else {
+                        evaluate(pred, inputTable, 0, false);
+                    }
+#else
                     evaluate(pred, inputTable, 0, false);
+#endif
 #ifndef RECURSIVE_QSQR
                     //evaluate in this case is not recursive. Process the tasks
                     //until the queue is empty
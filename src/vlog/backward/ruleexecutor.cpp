@@ -310,6 +310,7 @@ size_t RuleExecutor::estimateRule(const int depth, const uint8_t bodyAtom,
                 }
             }
             std::vector<std::pair<uint8_t, uint8_t>> pairs = posFromSupplRelation[bodyAtom];
+            table->reserve(supplRelations[bodyAtom]->getNTuples());
             for (size_t i = 0; i < supplRelations[bodyAtom]->getNTuples(); ++i) {
                 const Term_t *tuple = supplRelations[bodyAtom]->getTuple(i);
                 for (std::vector<std::pair<uint8_t, uint8_t>>::iterator itr = pairs.begin();
@@ -337,18 +338,9 @@ size_t RuleExecutor::estimateRule(const int depth, const uint8_t bodyAtom,
 
     size_t card = retrievedBindings->getNRows();
     if (nCurrentJoins > 0) {
-        //Sort the current TupleBindings to perform a merge sort with the just-retrieved tuples
-        TupleTable *sortedBindings2 = supplRelations[bodyAtom]->sortBy(posJoinsSupplRel);
-
-        //Sort also the retrieved tuples
-        TupleTable *sortedBindings1 = retrievedBindings->sortBy(posJoinsLiteral);
-
         //Do the join and copy the results in the following suppl. relation
-        RuleExecutor::join(sortedBindings1, sortedBindings2, &(joins.at(startJoins[bodyAtom])),
-                           nCurrentJoins, supplRelations[bodyAtom + 1]);
-
-        delete sortedBindings1;
-        delete sortedBindings2;
+        joinBindings(retrievedBindings, supplRelations[bodyAtom], bodyAtom,
+                     supplRelations[bodyAtom + 1]);
     } else {
         if (supplRelations[bodyAtom]->getSizeTuples() == 0) {
             //Simply copy all retrieved elements in the following relation
@@ -438,6 +430,7 @@ void RuleExecutor::evaluateRule(const uint8_t bodyAtom,
                 }
             }
             std::vector<std::pair<uint8_t, uint8_t>> pairs = posFromSupplRelation[bodyAtom];
+            table->reserve(supplRelations[bodyAtom]->getNTuples());
             for (size_t i = 0; i < supplRelations[bodyAtom]->getNTuples(); ++i) {
                 const Term_t *tuple = supplRelations[bodyAtom]->getTuple(i);
                 for (std::vector<std::pair<uint8_t, uint8_t>>::iterator itr = pairs.begin();
@@ -480,18 +473,9 @@ void RuleExecutor::evaluateRule(const uint8_t bodyAtom,
     }
 
     if (nCurrentJoins > 0) {
-        //Sort the current TupleBindings to perform a merge sort with the just-retrieved tuples
-        TupleTable *sortedBindings2 = supplRelations[bodyAtom]->sortBy(posJoinsSupplRel);
-
-        //Sort also the retrieved tuples
-        TupleTable *sortedBindings1 = retrievedBindings->sortBy(posJoinsLiteral);
-
         //Do the join and copy the results in the following suppl. relation
-        RuleExecutor::join(sortedBindings1, sortedBindings2, &(joins.at(startJoins[bodyAtom])),
-                           nCurrentJoins, supplRelations[bodyAtom + 1]);
-
-        delete sortedBindings1;
-        delete sortedBindings2;
+        joinBindings(retrievedBindings, supplRelations[bodyAtom], bodyAtom,
+                     supplRelations[bodyAtom + 1]);
     } else {
         if (supplRelations[bodyAtom]->getSizeTuples() == 0) {
             //Simply copy all retrieved elements in the following relation
@@ -598,6 +582,7 @@ void RuleExecutor::copyLastRelInAnswers(QSQR *qsqr,
             }
         }
 
+        answer->reserve(nTuples);
         for (size_t i = 0; i < nTuples; ++i) {
             const Term_t *supplRow = lastSupplRelation->getTuple(i);
             for (uint8_t j = 0; j < nvars; ++j) {
@@ -705,15 +690,6 @@ void RuleExecutor::processTask(QSQR_Task *t) {
         TupleTable *retrievedBindings = answer->
                                         projectAndFilter(l, NULL, NULL);
         const uint8_t nCurrentJoins = this->njoins[task.currentRuleIndex];
-        std::vector<uint8_t> posJoinsSupplRel;
-        std::vector<uint8_t> posJoinsLiteral;
-        if (nCurrentJoins > 0) {
-            int startIdx = startJoins[task.currentRuleIndex];
-            for (int i = 0; i < nCurrentJoins; ++i) {
-                posJoinsSupplRel.push_back(joins[startIdx + i].second);
-                posJoinsLiteral.push_back(joins[startIdx + i].first);
-            }
-        }
 
         if (retrievedBindings == NULL || retrievedBindings->getNRows() == 0) {
             if (retrievedBindings != NULL) {
@@ -721,22 +697,11 @@ void RuleExecutor::processTask(QSQR_Task *t) {
                 retrievedBindings = NULL;
             }
         } else if (nCurrentJoins > 0) {
-            TupleTable *sortedBindings2 = task.supplRelations[task.
-                                          currentRuleIndex]->
-                                          sortBy(posJoinsSupplRel);
-
-            //Sort also the retrieved tuples
-            TupleTable *sortedBindings1 = retrievedBindings->
-                                          sortBy(posJoinsLiteral);
-
             //Do the join and copy the results in the following suppl. relation
-            RuleExecutor::join(sortedBindings1, sortedBindings2,
-                               &(joins.at(startJoins[task.currentRuleIndex])),
-                               nCurrentJoins, task.supplRelations[task.
-                                       currentRuleIndex + 1]);
-
-            delete sortedBindings1;
-            delete sortedBindings2;
+            joinBindings(retrievedBindings,
+                         task.supplRelations[task.currentRuleIndex],
+                         (uint8_t) task.currentRuleIndex,
+                         task.supplRelations[task.currentRuleIndex + 1]);
         } else {
             if (task.supplRelations[task.
                                     currentRuleIndex]->getSizeTuples() == 0) {
@@ -760,6 +725,12 @@ void RuleExecutor::processTask(QSQR_Task *t) {
         throw 10;
     }
 }
+
+void RuleExecutor::discardTask(QSQR_Task *task) {
+    if (task->type == RULE) {
+        deleteSupplRelations(task->supplRelations);
+    }
+}
 #endif
 
 RuleExecutor::~RuleExecutor() {
@@ -779,6 +750,154 @@ char RuleExecutor::cmp(const uint64_t *row1, const uint64_t *row2, const std::pa
     return 0;
 }
 
+bool RuleExecutor::isSortedBy(TupleTable *t, const std::vector<uint8_t> &fields) {
+    const size_t nrows = t->getNRows();
+    for (size_t i = 1; i < nrows; ++i) {
+        const uint64_t *prev = t->getRow(i - 1);
+        const uint64_t *row = t->getRow(i);
+        for (size_t f = 0; f < fields.size(); ++f) {
+            if (prev[fields[f]] != row[fields[f]]) {
+                if (row[fields[f]] < prev[fields[f]]) {
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void RuleExecutor::joinBindings(TupleTable *retrieved,
+                                BindingsTable *supplRelation,
+                                const uint8_t bodyAtom,
+                                BindingsTable *output) {
+    std::pair<uint8_t, uint8_t> *j = &(joins.at(startJoins[bodyAtom]));
+    const uint8_t nj = njoins[bodyAtom];
+    std::vector<uint8_t> fields1;
+    std::vector<uint8_t> fields2;
+    for (uint8_t i = 0; i < nj; ++i) {
+        fields1.push_back(j[i].first);
+        fields2.push_back(j[i].second);
+    }
+
+    const size_t n1 = retrieved->getNRows();
+    const size_t n2 = supplRelation->getNTuples();
+    const bool sorted1 = isSortedBy(retrieved, fields1);
+    const bool sorted2 = supplRelation->isSortedBy(fields2);
+    if ((sorted1 && sorted2) || std::min(n1, n2) > HASHJOIN_MAX_BUILD_ROWS) {
+        //Merge join. Only the inputs that are not yet in the order of the
+        //join are sorted
+        TupleTable *sortedBindings1 = sorted1 ? retrieved :
+                                      retrieved->sortBy(fields1);
+        TupleTable *sortedBindings2 = supplRelation->sortBy(fields2);
+        RuleExecutor::join(sortedBindings1, sortedBindings2, j, nj, output);
+        if (!sorted1) {
+            delete sortedBindings1;
+        }
+        delete sortedBindings2;
+    } else {
+        RuleExecutor::hashJoin(retrieved, supplRelation, j, nj, output);
+    }
+}
+
+static size_t hashJoinKey(const uint64_t *row, const uint8_t *keys,
+                          const uint8_t nkeys) {
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (uint8_t i = 0; i < nkeys; ++i) {
+        h ^= row[keys[i]] * 0xff51afd7ed558ccdull;
+        h = (h << 29) | (h >> 35);
+    }
+    h ^= h >> 32;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 29;
+    return (size_t) h;
+}
+
+void RuleExecutor::hashJoin(TupleTable *r1, BindingsTable *r2,
+                            std::pair<uint8_t, uint8_t> *j, uint8_t nj,
+                            BindingsTable *output) {
+    const size_t n1 = r1->getNRows();
+    const size_t n2 = r2->getNTuples();
+    const uint8_t sizeRow1 = r1->getSizeRow();
+    const uint8_t sizeRow2 = (uint8_t) r2->getSizeTuples();
+    uint8_t keys1[SIZETUPLE];
+    uint8_t keys2[SIZETUPLE];
+    for (uint8_t i = 0; i < nj; ++i) {
+        keys1[i] = j[i].first;
+        keys2[i] = j[i].second;
+    }
+
+    //Build the table on the smaller input and probe it with the other one
+    const bool buildOn1 = n1 <= n2;
+    const size_t nBuild = buildOn1 ? n1 : n2;
+    const size_t nProbe = buildOn1 ? n2 : n1;
+    const uint8_t *buildKeys = buildOn1 ? keys1 : keys2;
+    const uint8_t *probeKeys = buildOn1 ? keys2 : keys1;
+#if TERM_IS_UINT64
+    auto row2 = [&](size_t i) -> const uint64_t* {
+        return r2->getTuple(i);
+    };
+#else
+    //The rows of r2 are narrower than the ones of r1: widen them once
+    std::vector<uint64_t> rows2(n2 * sizeRow2);
+    for (size_t i = 0; i < n2; ++i) {
+        const Term_t *t = r2->getTuple(i);
+        for (uint8_t k = 0; k < sizeRow2; ++k) {
+            rows2[i * sizeRow2 + k] = t[k];
+        }
+    }
+    auto row2 = [&](size_t i) -> const uint64_t* {
+        return rows2.data() + i * sizeRow2;
+    };
+#endif
+    auto buildRow = [&](size_t i) -> const uint64_t* {
+        return buildOn1 ? r1->getRow(i) : row2(i);
+    };
+    auto probeRow = [&](size_t i) -> const uint64_t* {
+        return buildOn1 ? row2(i) : r1->getRow(i);
+    };
+
+    //Chained buckets stored in flat arrays
+    size_t capacity = 16;
+    while (capacity < nBuild * 2) {
+        capacity *= 2;
+    }
+    const size_t mask = capacity - 1;
+    const size_t NONE = (size_t) - 1;
+    std::vector<size_t> heads(capacity, NONE);
+    std::vector<size_t> next(nBuild);
+    std::vector<size_t> hashes(nBuild);
+    for (size_t i = 0; i < nBuild; ++i) {
+        const size_t h = hashJoinKey(buildRow(i), buildKeys, nj);
+        hashes[i] = h;
+        next[i] = heads[h & mask];
+        heads[h & mask] = i;
+    }
+
+    for (size_t i = 0; i < nProbe; ++i) {
+        const uint64_t *row = probeRow(i);
+        const size_t h = hashJoinKey(row, probeKeys, nj);
+        for (size_t b = heads[h & mask]; b != NONE; b = next[b]) {
+            if (hashes[b] != h) {
+                continue;
+            }
+            const uint64_t *other = buildRow(b);
+            bool equal = true;
+            for (uint8_t k = 0; k < nj && equal; ++k) {
+                equal = row[probeKeys[k]] == other[buildKeys[k]];
+            }
+            if (!equal) {
+                continue;
+            }
+            if (buildOn1) {
+                output->addTuple(other, sizeRow1, row, sizeRow2);
+            } else {
+                output->addTuple(row, sizeRow1, other, sizeRow2);
+            }
+        }
+    }
+}
+
 void RuleExecutor::join(TupleTable * r1, TupleTable * r2,
                         std::pair<uint8_t, uint8_t> *j, uint8_t nj, BindingsTable * output) {
     //Perform a merge join and copy the data into a row to be copied in the output
@@ -0,0 +1,230 @@
+#include <vlog/answercache.h>
+#include <trident/model/table.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+
+std::vector<std::pair<uint8_t, Term_t>> AnswerCache::getConstants(
+        const Literal &query) {
+    std::vector<std::pair<uint8_t, Term_t>> consts;
+    for (uint8_t i = 0; i < query.getTupleSize(); ++i) {
+        VTerm t = query.getTermAtPos(i);
+        if (!t.isVariable()) {
+            consts.push_back(std::make_pair(i, (Term_t) t.getValue()));
+        }
+    }
+    return consts;
+}
+
+void AnswerCache::setCapacity(const size_t maxTerms) {
+    boost::mutex::scoped_lock lock(mutex);
+    this->maxTerms = maxTerms;
+    while (nTerms > maxTerms) {
+        evict();
+    }
+}
+
+void AnswerCache::evict() {
+    std::vector<Entry> *oldestList = NULL;
+    size_t oldest = 0;
+    for (auto &p : entries) {
+        for (size_t i = 0; i < p.second.size(); ++i) {
+            if (oldestList == NULL ||
+                    p.second[i].lastUsed < (*oldestList)[oldest].lastUsed) {
+                oldestList = &p.second;
+                oldest = i;
+            }
+        }
+    }
+    if (oldestList == NULL) {
+        nTerms = 0;
+        return;
+    }
+    nTerms -= (*oldestList)[oldest].rows->size();
+    oldestList->erase(oldestList->begin() + oldest);
+}
+
+TupleTable *AnswerCache::get(const Program *program, const Literal &query,
+                             std::vector<uint8_t> *posJoins,
+                             std::vector<Term_t> *possibleValuesJoins,
+                             const bool onlyVars) {
+    const std::vector<uint8_t> posVars = query.getPosVars();
+    if (!isEnabled() || (onlyVars && posVars.empty())) {
+        return NULL;
+    }
+
+    //Take the smallest entry that subsumes the query
+    const PredId_t predid = query.getPredicate().getId();
+    const uint8_t arity = query.getTupleSize();
+    std::shared_ptr<const std::vector<Term_t>> rows;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        auto p = entries.find(predid);
+        if (p != entries.end()) {
+            Entry *best = NULL;
+            for (auto &e : p->second) {
+                if (e.program != program->getId() || e.arity != arity) {
+                    continue;
+                }
+                bool subsumes = true;
+                for (const auto &c : e.consts) {
+                    VTerm t = query.getTermAtPos(c.first);
+                    if (t.isVariable() || (Term_t) t.getValue() != c.second) {
+                        subsumes = false;
+                        break;
+                    }
+                }
+                if (subsumes && (best == NULL ||
+                                 e.rows->size() < best->rows->size())) {
+                    best = &e;
+                }
+            }
+            if (best != NULL) {
+                best->lastUsed = ++clock;
+                rows = best->rows;
+            }
+        }
+    }
+    if (rows == NULL) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+
+    //Constants and repeated variables of the query
+    const std::vector<std::pair<uint8_t, Term_t>> consts = getConstants(query);
+    std::vector<std::pair<uint8_t, uint8_t>> repeatedVars;
+    for (uint8_t i = 0; i < posVars.size(); ++i) {
+        for (uint8_t j = 0; j < i; ++j) {
+            if (query.getTermAtPos(posVars[j]).getId() ==
+                    query.getTermAtPos(posVars[i]).getId()) {
+                repeatedVars.push_back(std::make_pair(posVars[j], posVars[i]));
+                break;
+            }
+        }
+    }
+
+    //The bindings are on the positions of the variables
+    std::vector<uint8_t> posBindings;
+    std::vector<std::vector<Term_t>> bindings;
+    if (posJoins != NULL) {
+        for (const auto p : *posJoins) {
+            posBindings.push_back(posVars[p]);
+        }
+        for (size_t i = 0; i < possibleValuesJoins->size();
+                i += posBindings.size()) {
+            bindings.push_back(std::vector<Term_t>(
+                                   possibleValuesJoins->begin() + i,
+                                   possibleValuesJoins->begin() + i +
+                                   posBindings.size()));
+        }
+        std::sort(bindings.begin(), bindings.end());
+    }
+
+    TupleTable *output = new TupleTable(onlyVars ? posVars.size() : arity);
+    std::vector<Term_t> key(posBindings.size());
+    uint64_t row[SIZETUPLE];
+    const size_t nrows = rows->size() / arity;
+    for (size_t i = 0; i < nrows; ++i) {
+        const Term_t *r = rows->data() + i * arity;
+        bool ok = true;
+        for (size_t j = 0; j < consts.size() && ok; ++j) {
+            ok = r[consts[j].first] == consts[j].second;
+        }
+        for (size_t j = 0; j < repeatedVars.size() && ok; ++j) {
+            ok = r[repeatedVars[j].first] == r[repeatedVars[j].second];
+        }
+        if (ok && !posBindings.empty()) {
+            for (size_t j = 0; j < posBindings.size(); ++j) {
+                key[j] = r[posBindings[j]];
+            }
+            ok = std::binary_search(bindings.begin(), bindings.end(), key);
+        }
+        if (!ok) {
+            continue;
+        }
+        if (onlyVars) {
+            for (size_t j = 0; j < posVars.size(); ++j) {
+                output->addValue(r[posVars[j]]);
+            }
+        } else {
+            for (uint8_t j = 0; j < arity; ++j) {
+                row[j] = r[j];
+            }
+            output->addRow(row);
+        }
+    }
+    return output;
+}
+
+void AnswerCache::add(const Program *program, const Literal &query,
+                      TupleTable *answers, const bool onlyVars) {
+    const std::vector<uint8_t> posVars = query.getPosVars();
+    if (!isEnabled() || query.getNUniqueVars() != posVars.size() ||
+            (onlyVars && posVars.empty())) {
+        return;
+    }
+    const uint8_t arity = query.getTupleSize();
+    const size_t size = answers->getNRows() * arity;
+    if (size > maxTerms) {
+        return;
+    }
+
+    //Store the whole tuples
+    Entry e;
+    e.program = program->getId();
+    e.consts = getConstants(query);
+    e.arity = arity;
+    std::shared_ptr<std::vector<Term_t>> rows(new std::vector<Term_t>());
+    rows->reserve(size);
+    Term_t row[SIZETUPLE];
+    for (const auto &c : e.consts) {
+        row[c.first] = c.second;
+    }
+    for (size_t i = 0; i < answers->getNRows(); ++i) {
+        const uint64_t *r = answers->getRow(i);
+        if (onlyVars) {
+            for (size_t j = 0; j < posVars.size(); ++j) {
+                row[posVars[j]] = (Term_t) r[j];
+            }
+        } else {
+            for (uint8_t j = 0; j < arity; ++j) {
+                row[j] = (Term_t) r[j];
+            }
+        }
+        rows->insert(rows->end(), row, row + arity);
+    }
+    e.rows = rows;
+
+    const PredId_t predid = query.getPredicate().getId();
+    boost::mutex::scoped_lock lock(mutex);
+    //Replace the previous answers of the same query
+    auto p = entries.find(predid);
+    if (p != entries.end()) {
+        for (auto itr = p->second.begin(); itr != p->second.end(); ++itr) {
+            if (itr->program == e.program && itr->consts == e.consts) {
+                nTerms -= itr->rows->size();
+                p->second.erase(itr);
+                break;
+            }
+        }
+    }
+    while (nTerms + size > maxTerms) {
+        evict();
+    }
+    e.lastUsed = ++clock;
+    entries[predid].push_back(e);
+    nTerms += size;
+}
+
+void AnswerCache::invalidate() {
+    boost::mutex::scoped_lock lock(mutex);
+    entries.clear();
+    nTerms = 0;
+}
+
+AnswerCache::~AnswerCache() {
+    BOOST_LOG_TRIVIAL(debug) << "Answer cache: " << hits << " hits, " <<
+                             misses << " misses";
+}
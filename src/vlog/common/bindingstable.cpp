@@ -2,7 +2,6 @@
 #include <trident/model/table.h>
 
 Term_t const * const EMPTY_TUPLE = {0};
-BindingsRow EMPTY_ROW(0, EMPTY_TUPLE);
 
 bool BindingsRow::operator==(const BindingsRow &other) const {
     if (size == other.size) {
@@ -19,7 +18,9 @@ bool BindingsRow::operator==(const BindingsRow &other) const {
 }
 
 BindingsTable::BindingsTable(uint8_t sizeAdornment, uint8_t adornment) {
-    uniqueElements.max_load_factor(0.75);
+    nUniqueRows = 0;
+    nSortedFields = SIZETUPLE;
+    counter = NULL;
     //Mark positions to copy
     std::vector<int> pc;
     for (int i = 0; i < sizeAdornment; ++i) {
@@ -46,7 +47,9 @@ BindingsTable::BindingsTable(uint8_t sizeAdornment, uint8_t adornment) {
 }
 
 BindingsTable::BindingsTable(size_t sizeTuple) {
-    uniqueElements.max_load_factor(0.75);
+    nUniqueRows = 0;
+    nSortedFields = SIZETUPLE;
+    counter = NULL;
     nPosToCopy = sizeTuple;
     if (nPosToCopy > 0) {
         rawBindings = new RawBindings((uint8_t) sizeTuple);
@@ -59,7 +62,9 @@ BindingsTable::BindingsTable(size_t sizeTuple) {
 }
 
 BindingsTable::BindingsTable(uint8_t npc, std::vector<int> pc) {
-    uniqueElements.max_load_factor(0.75);
+    nUniqueRows = 0;
+    nSortedFields = SIZETUPLE;
+    counter = NULL;
     this->nPosToCopy = npc;
     if (nPosToCopy > 0) {
         this->posToCopy = new size_t[nPosToCopy];
@@ -75,24 +80,83 @@ BindingsTable::BindingsTable(uint8_t npc, std::vector<int> pc) {
     }
 }
 
+void BindingsTable::resizeIndex(const size_t capacity) {
+    HashSlot free;
+    free.row = (size_t) - 1;
+    free.hash = 0;
+    std::vector<HashSlot> newSlots(capacity, free);
+    const size_t mask = capacity - 1;
+    for (auto &slot : slots) {
+        if (slot.row != (size_t) - 1) {
+            size_t i = slot.hash & mask;
+            while (newSlots[i].row != (size_t) - 1) {
+                i = (i + 1) & mask;
+            }
+            newSlots[i] = slot;
+        }
+    }
+    slots.swap(newSlots);
+}
+
+void BindingsTable::reserve(const size_t n) {
+    Lock lock(mutex.get());
+    //Keep the load factor below 0.75
+    const size_t needed = (nUniqueRows + n) / 3 * 4 + 4;
+    if (needed > slots.size()) {
+        size_t capacity = slots.empty() ? 16 : slots.size();
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        resizeIndex(capacity);
+    }
+}
+
 void BindingsTable::insertIfNotExists(Term_t const * const cr) {
     if (cr == EMPTY_TUPLE) {
-        uniqueElements.insert(EMPTY_ROW);
+        if (nUniqueRows == 0 && counter != NULL)
+            (*counter)++;
+        nUniqueRows = 1;
         return;
     }
-    BindingsRow row((uint8_t) nPosToCopy, cr);
-    /*
-    std::unordered_set<BindingsRow, hash_BindingsRow>::iterator itr = uniqueElements.find(row);
-    if (itr == uniqueElements.end()) {
-        uniqueElements.insert(row);
-    */
-    std::pair<std::unordered_set<BindingsRow, hash_BindingsRow>::iterator, bool> result = uniqueElements.insert(row);
-    if (result.second) {
-        currentRow = rawBindings->newRow();
+    if ((nUniqueRows + 1) * 4 > slots.size() * 3) {
+        resizeIndex(slots.empty() ? 16 : slots.size() * 2);
+    }
+    const size_t hash = hashRow(cr, nPosToCopy);
+    const size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].row != (size_t) - 1) {
+        if (slots[i].hash == hash) {
+            Term_t const *existing = rawBindings->getOffset(slots[i].row *
+                                     nPosToCopy);
+            if (std::equal(existing, existing + nPosToCopy, cr)) {
+                return;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+    if (nUniqueRows > 0) {
+        //The rows stay sorted on the leading fields as long as they are
+        //added in order
+        Term_t const *prev = rawBindings->getOffset((nUniqueRows - 1) *
+                             nPosToCopy);
+        for (size_t f = 0; f < nSortedFields && f < nPosToCopy; ++f) {
+            if (cr[f] != prev[f]) {
+                if (cr[f] < prev[f]) {
+                    nSortedFields = f;
+                }
+                break;
+            }
+        }
     }
+    slots[i].row = nUniqueRows++;
+    slots[i].hash = hash;
+    currentRow = rawBindings->newRow();
+    if (counter != NULL)
+        (*counter)++;
 }
 
 void BindingsTable::addTuple(const Literal *t) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -105,6 +169,7 @@ void BindingsTable::addTuple(const Literal *t) {
 
 #if ! TERM_IS_UINT64
 void BindingsTable::addTuple(const uint64_t *t) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -117,6 +182,7 @@ void BindingsTable::addTuple(const uint64_t *t) {
 #endif
 
 void BindingsTable::addTuple(const Term_t *t) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -129,6 +195,7 @@ void BindingsTable::addTuple(const Term_t *t) {
 
 void BindingsTable::addTuple(const uint64_t *t1, const uint8_t sizeT1,
                              const uint64_t *t2, const uint8_t sizeT2) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -144,6 +211,7 @@ void BindingsTable::addTuple(const uint64_t *t1, const uint8_t sizeT1,
 }
 
 void BindingsTable::addTuple(const uint64_t *t, const uint8_t *positions) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -155,6 +223,7 @@ void BindingsTable::addTuple(const uint64_t *t, const uint8_t *positions) {
 }
 
 void BindingsTable::addRawTuple(Term_t *r) {
+    Lock lock(mutex.get());
     if (nPosToCopy == 0) {
         insertIfNotExists(EMPTY_TUPLE);
     } else {
@@ -166,21 +235,45 @@ void BindingsTable::addRawTuple(Term_t *r) {
 }
 
 void BindingsTable::clear() {
-    uniqueElements.clear();
+    Lock lock(mutex.get());
+    HashSlot free;
+    free.row = (size_t) - 1;
+    free.hash = 0;
+    std::fill(slots.begin(), slots.end(), free);
+    nUniqueRows = 0;
+    nSortedFields = SIZETUPLE;
     if (nPosToCopy > 0) {
         rawBindings->clear();
         currentRow = rawBindings->newRow();
     }
 }
 
+bool BindingsTable::isSortedBy(const std::vector<uint8_t> &fields) {
+    Lock lock(mutex.get());
+    if (fields.size() > nSortedFields) {
+        return false;
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (fields[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
 TupleTable *BindingsTable::sortBy(std::vector<uint8_t> &fields) {
+    const bool sorted = isSortedBy(fields);
+    Lock lock(mutex.get());
     std::vector<BindingsRow> rowsToSort;
-    for (size_t i = 0; i < uniqueElements.size(); ++i) {
+    rowsToSort.reserve(nUniqueRows);
+    for (size_t i = 0; i < nUniqueRows; ++i) {
         BindingsRow row((uint8_t) nPosToCopy, rawBindings->getOffset(i * nPosToCopy));
         rowsToSort.push_back(row);
     }
-    FieldsSorter sorter(fields);
-    std::sort(rowsToSort.begin(), rowsToSort.end(), std::ref(sorter));
+    if (!sorted) {
+        FieldsSorter sorter(fields);
+        std::sort(rowsToSort.begin(), rowsToSort.end(), std::ref(sorter));
+    }
 
     //Create a TupleTable and return it
     TupleTable *outputTable = new TupleTable(nPosToCopy);
@@ -193,6 +286,7 @@ TupleTable *BindingsTable::sortBy(std::vector<uint8_t> &fields) {
 
 TupleTable *BindingsTable::projectAndFilter(const Literal &l, const std::vector<uint8_t> *posToFilter,
         const std::vector<Term_t> *valuesToFilter) {
+    Lock lock(mutex.get());
     uint8_t vars[SIZETUPLE];
     uint8_t consts[SIZETUPLE];
     uint8_t nconsts = 0;
@@ -210,7 +304,7 @@ TupleTable *BindingsTable::projectAndFilter(const Literal &l, const std::vector<
 #if DEBUG
     bool warn_done = false;
 #endif
-    for (size_t i = 0; i < uniqueElements.size(); ++i) {
+    for (size_t i = 0; i < nUniqueRows; ++i) {
         Term_t *row = rawBindings->getOffset(i * nPosToCopy);
         bool ok = true;
         for (uint8_t j = 0; j < nconsts; ++j) {
@@ -263,6 +357,7 @@ TupleTable *BindingsTable::projectAndFilter(const Literal &l, const std::vector<
 
 TupleTable *BindingsTable::filter(const Literal &l, const std::vector<uint8_t> *posToFilter,
                                   const std::vector<Term_t> *valuesToFilter) {
+    Lock lock(mutex.get());
 
     Term_t consts[SIZETUPLE];
     uint8_t posConsts[SIZETUPLE];
@@ -287,7 +382,7 @@ TupleTable *BindingsTable::filter(const Literal &l, const std::vector<uint8_t> *
 #if DEBUG
     bool warn_done = false;
 #endif
-    for (size_t i = 0; i < uniqueElements.size(); ++i) {
+    for (size_t i = 0; i < nUniqueRows; ++i) {
         Term_t *row = rawBindings->getOffset(i * nPosToCopy);
 
         bool ok = true;
@@ -344,7 +439,8 @@ TupleTable *BindingsTable::filter(const Literal &l, const std::vector<uint8_t> *
 }
 
 std::vector<Term_t> BindingsTable::getProjection(std::vector<uint8_t> pos) {
-    size_t size = uniqueElements.size();
+    Lock lock(mutex.get());
+    size_t size = nUniqueRows;
     std::vector<Term_t> outputVector;
     for (int i = 0; i < size; ++i) {
         Term_t *startTuple = rawBindings->getOffset(i * nPosToCopy);
@@ -358,7 +454,8 @@ std::vector<Term_t> BindingsTable::getProjection(std::vector<uint8_t> pos) {
 }
 
 std::vector<Term_t> BindingsTable::getUniqueSortedProjection(std::vector<uint8_t> pos) {
-    size_t size = uniqueElements.size();
+    Lock lock(mutex.get());
+    size_t size = nUniqueRows;
     std::vector<Term_t> outputVector;
 
     if (pos.size() == 1) {
@@ -403,6 +500,7 @@ std::vector<Term_t> BindingsTable::getUniqueSortedProjection(std::vector<uint8_t
 }
 
 const Term_t *BindingsTable::getTuple(size_t idx) {
+    Lock lock(mutex.get());
     if (rawBindings == NULL)
         return EMPTY_TUPLE;
     else
@@ -410,11 +508,13 @@ const Term_t *BindingsTable::getTuple(size_t idx) {
 }
 
 size_t BindingsTable::getNTuples() {
-    return uniqueElements.size();
+    Lock lock(mutex.get());
+    return nUniqueRows;
 }
 
 void BindingsTable::print() {
-    size_t size = uniqueElements.size();
+    Lock lock(mutex.get());
+    size_t size = nUniqueRows;
     for (int i = 0; i < size; ++i) {
         Term_t *startTuple = rawBindings->getOffset(i * nPosToCopy);
         for (int j = 0; j < nPosToCopy; ++j)
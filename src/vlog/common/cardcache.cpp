@@ -0,0 +1,69 @@
+#include <vlog/cardcache.h>
+
+#include <boost/log/trivial.hpp>
+
+std::string CardinalityCache::key(const Literal &query, const int kind) {
+    std::string k;
+    k.reserve(2 + query.getTupleSize() * (1 + sizeof(Term_t)));
+    k.push_back((char) kind);
+    uint8_t vars[SIZETUPLE];
+    uint8_t nvars = 0;
+    for (uint8_t i = 0; i < query.getTupleSize(); ++i) {
+        VTerm t = query.getTermAtPos(i);
+        if (t.isVariable()) {
+            uint8_t j = 0;
+            while (j < nvars && vars[j] != t.getId()) {
+                j++;
+            }
+            if (j == nvars) {
+                vars[nvars++] = t.getId();
+            }
+            k.push_back('v');
+            k.push_back((char) j);
+        } else {
+            const Term_t v = t.getValue();
+            k.push_back('c');
+            k.append((const char *) &v, sizeof(Term_t));
+        }
+    }
+    return k;
+}
+
+bool CardinalityCache::get(const Literal &query, const int kind,
+                           size_t &card) {
+    const PredId_t predid = query.getPredicate().getId();
+    const std::string k = key(query, kind);
+    Shard &s = getShard(predid);
+    boost::mutex::scoped_lock lock(s.mutex);
+    auto p = s.values.find(predid);
+    if (p != s.values.end()) {
+        auto itr = p->second.find(k);
+        if (itr != p->second.end()) {
+            card = itr->second;
+            hits++;
+            return true;
+        }
+    }
+    misses++;
+    return false;
+}
+
+void CardinalityCache::add(const Literal &query, const int kind,
+                           const size_t card) {
+    const PredId_t predid = query.getPredicate().getId();
+    const std::string k = key(query, kind);
+    Shard &s = getShard(predid);
+    boost::mutex::scoped_lock lock(s.mutex);
+    s.values[predid][k] = card;
+}
+
+void CardinalityCache::invalidate(const PredId_t predid) {
+    Shard &s = getShard(predid);
+    boost::mutex::scoped_lock lock(s.mutex);
+    s.values.erase(predid);
+}
+
+CardinalityCache::~CardinalityCache() {
+    BOOST_LOG_TRIVIAL(debug) << "Cardinality cache: " << hits << " hits, " <<
+                             misses << " misses";
+}
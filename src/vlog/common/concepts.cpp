@@ -597,11 +597,14 @@ std::string Rule::toprettystring(Program * program, EDBLayer *db) const {
 }
 
 
+std::atomic<uint64_t> Program::nextId(0);
+
 Program::Program(const uint64_t assignedIds,
                  EDBLayer *kb) : assignedIds(assignedIds),
     kb(kb),
     dictPredicates(kb->getPredDictionary()),
-    additionalConstants(assignedIds) {
+    additionalConstants(assignedIds),
+    id(++nextId) {
 }
 
 void Program::readFromFile(std::string pathFile) {
@@ -783,14 +786,61 @@ void Program::cleanAllRules() {
     for (int i = 0; i < MAX_NPREDS; ++i) {
         rules[i].clear();
     }
+    rulesChanged();
 }
 
 void Program::addAllRules(std::vector<Rule> &r) {
+    rulesChanged();
     for (int i = 0; i < r.size(); ++i) {
         rules[r[i].getHead().getPredicate().getId()].push_back(r[i]);
     }
 }
 
+int Program::sliceForPredicates(const std::vector<std::string> &targets) {
+    //Visit the dependency graph backwards, starting from the targets
+    std::vector<bool> needed(MAX_NPREDS);
+    std::vector<PredId_t> queue;
+    for (const auto &name : targets) {
+        SimpleHashmap::iterator itr = dictPredicates.getMap().find(name);
+        if (itr == dictPredicates.getMap().end()) {
+            BOOST_LOG_TRIVIAL(error) << "Predicate " << name <<
+                                     " does not appear in the program";
+            throw 10;
+        }
+        const PredId_t id = (PredId_t) itr->second;
+        if (!needed[id]) {
+            needed[id] = true;
+            queue.push_back(id);
+        }
+    }
+    while (!queue.empty()) {
+        const PredId_t id = queue.back();
+        queue.pop_back();
+        for (const auto &rule : rules[id]) {
+            for (const auto &literal : rule.getBody()) {
+                const PredId_t bodyId = literal.getPredicate().getId();
+                if (!needed[bodyId]) {
+                    needed[bodyId] = true;
+                    queue.push_back(bodyId);
+                }
+            }
+        }
+    }
+
+    //Remove the rules of all other predicates
+    int removed = 0;
+    for (int i = 0; i < MAX_NPREDS; ++i) {
+        if (!needed[i]) {
+            removed += rules[i].size();
+            rules[i].clear();
+        }
+    }
+    if (removed > 0) {
+        rulesChanged();
+    }
+    return removed;
+}
+
 bool Program::isPredicateIDB(const PredId_t id) {
     return !Predicate::isEDB(getPredicateName(id));
 }
@@ -845,6 +895,7 @@ void Program::parseRule(std::string rule) {
 
         //Add the rule
         rules[lHead.getPredicate().getId()].push_back(Rule(lHead, lBody));
+        rulesChanged();
 
     } catch (int e) {
         BOOST_LOG_TRIVIAL(error) << "Failed in parsing rule " << rule;
@@ -0,0 +1,54 @@
+#include <vlog/dictcache.h>
+
+#include <boost/log/trivial.hpp>
+
+bool DictCache::getText(const uint64_t id, std::string &text) {
+    boost::mutex::scoped_lock lock(mutex);
+    auto itr = byId.find(id);
+    if (itr == byId.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, itr->second);
+    text = itr->second->text;
+    return true;
+}
+
+bool DictCache::getNumber(const std::string &text, uint64_t &id) {
+    boost::mutex::scoped_lock lock(mutex);
+    auto itr = byText.find(text);
+    if (itr == byText.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, itr->second);
+    id = itr->second->id;
+    return true;
+}
+
+void DictCache::add(const uint64_t id, const std::string &text) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (byId.count(id)) {
+        return;
+    }
+    if (entries.size() >= capacity) {
+        //Evict the least recently used term
+        const Entry &last = entries.back();
+        byId.erase(last.id);
+        byText.erase(last.text);
+        entries.pop_back();
+    }
+    Entry e;
+    e.id = id;
+    e.text = text;
+    entries.push_front(e);
+    byId[id] = entries.begin();
+    byText[text] = entries.begin();
+}
+
+DictCache::~DictCache() {
+    BOOST_LOG_TRIVIAL(debug) << "Dictionary cache: " << hits << " hits, " <<
+                             misses << " misses";
+}
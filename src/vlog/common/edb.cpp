@@ -2,8 +2,11 @@
 #include <vlog/concepts.h>
 #include <vlog/idxtupletable.h>
 #include <vlog/column.h>
+#include <vlog/prefetchiterator.h>
 
 #include <vlog/trident/tridenttable.h>
+#include <vlog/inmemory/inmemorytable.h>
+#include <vlog/inmemory/mmaptable.h>
 #ifdef MYSQL
 #include <vlog/mysql/mysqltable.h>
 #endif
@@ -19,10 +22,21 @@
 
 #include <unordered_map>
 #include <climits>
+#include <cstring>
+
+void EDBLayer::checkDictionary(const string &predname, const string &dict) {
+    if (dbPredicates.empty()) {
+        dictionary = dict;
+    } else if (dictionary != dict) {
+        BOOST_LOG_TRIVIAL(error) << "The table " << predname << " uses a different dictionary than the previous tables, so their terms would not be comparable. Check the edb.conf file.";
+        throw 10;
+    }
+}
 
 void EDBLayer::addTridentTable(const EDBConf::Table &tableConf, bool multithreaded) {
     EDBInfoTable infot;
     const string pn = tableConf.predname;
+    checkDictionary(pn, "");
     const string kbpath = tableConf.params[0];
     if (!boost::filesystem::exists(kbpath) || !boost::filesystem::exists(kbpath + "/p0")) {
         BOOST_LOG_TRIVIAL(error) << "The KB at " << kbpath << " does not exist. Check the edb.conf file.";
@@ -36,16 +50,69 @@ void EDBLayer::addTridentTable(const EDBConf::Table &tableConf, bool multithread
     BOOST_LOG_TRIVIAL(debug) << "Inserted " << pn << " with number " << infot.id;
 }
 
+void EDBLayer::addInmemoryTable(const EDBConf::Table &tableConf) {
+    EDBInfoTable infot;
+    const string pn = tableConf.predname;
+    if (tableConf.params.size() < 1) {
+        BOOST_LOG_TRIVIAL(error) << "The in-memory table " << pn << " requires the path of the file. Check the edb.conf file.";
+        throw 10;
+    }
+    checkDictionary(pn, "INMEMORY");
+    if (inmemoryDict == NULL) {
+        inmemoryDict = std::shared_ptr<Dictionary>(new Dictionary());
+    }
+    infot.id = (PredId_t) predDictionary.getOrAdd(pn);
+    const string separator = tableConf.params.size() > 1 ? tableConf.params[1] : "";
+    InmemoryTable *table = new InmemoryTable(infot.id, tableConf.params[0],
+            separator, inmemoryDict);
+    infot.arity = table->getArity();
+    infot.type = tableConf.type;
+    infot.manager = std::shared_ptr<EDBTable>(table);
+    dbPredicates.insert(make_pair(infot.id, infot));
+    BOOST_LOG_TRIVIAL(debug) << "Inserted " << pn << " with number " << infot.id;
+}
+
+void EDBLayer::addMmapTable(const EDBConf::Table &tableConf) {
+    EDBInfoTable infot;
+    const string pn = tableConf.predname;
+    if (tableConf.params.size() < 1) {
+        BOOST_LOG_TRIVIAL(error) << "The mmap table " << pn << " requires the directory created by convert. Check the edb.conf file.";
+        throw 10;
+    }
+    const string dir = tableConf.params[0];
+    if (!boost::filesystem::exists(dir + "/dict.bin")) {
+        BOOST_LOG_TRIVIAL(error) << "The directory " << dir << " was not created by convert. Check the edb.conf file.";
+        throw 10;
+    }
+    //Every directory has its own dictionary
+    checkDictionary(pn, "MMAP:" + boost::filesystem::canonical(dir).string());
+    if (!mmapDicts.count(dir)) {
+        mmapDicts[dir] = std::shared_ptr<MmapDictionary>(
+                             new MmapDictionary(dir + "/dict.bin"));
+    }
+    infot.id = (PredId_t) predDictionary.getOrAdd(pn);
+    const string relname = tableConf.params.size() > 1 ? tableConf.params[1] : pn;
+    MmapTable *table = new MmapTable(infot.id, dir + "/" + relname + ".rel",
+                                     mmapDicts[dir]);
+    infot.arity = table->getArity();
+    infot.type = tableConf.type;
+    infot.manager = std::shared_ptr<EDBTable>(table);
+    dbPredicates.insert(make_pair(infot.id, infot));
+    BOOST_LOG_TRIVIAL(debug) << "Inserted " << pn << " with number " << infot.id;
+}
+
 #ifdef MYSQL
 void EDBLayer::addMySQLTable(const EDBConf::Table &tableConf) {
     EDBInfoTable infot;
     const string pn = tableConf.predname;
+    checkDictionary(pn, "");
     infot.id = (PredId_t) predDictionary.getOrAdd(pn);
     infot.arity = 3;
     infot.type = tableConf.type;
     infot.manager = std::shared_ptr<EDBTable>(new MySQLTable(tableConf.params[0],
                 tableConf.params[1], tableConf.params[2], tableConf.params[3],
-                tableConf.params[4], tableConf.params[5]));
+                tableConf.params[4], tableConf.params[5],
+                tableConf.params.size() > 6 ? tableConf.params[6] : ""));
     dbPredicates.insert(make_pair(infot.id, infot));
 }
 #endif
@@ -54,12 +121,14 @@ void EDBLayer::addMySQLTable(const EDBConf::Table &tableConf) {
 void EDBLayer::addODBCTable(const EDBConf::Table &tableConf) {
     EDBInfoTable infot;
     const string pn = tableConf.predname;
+    checkDictionary(pn, "");
     infot.id = (PredId_t) predDictionary.getOrAdd(pn);
     infot.arity = 3;
     infot.type = tableConf.type;
     infot.manager = std::shared_ptr<EDBTable>(new ODBCTable(tableConf.params[0],
                 tableConf.params[1], tableConf.params[2], tableConf.params[3],
-                tableConf.params[4]));
+                tableConf.params[4],
+                tableConf.params.size() > 5 ? tableConf.params[5] : ""));
     dbPredicates.insert(make_pair(infot.id, infot));
 }
 #endif
@@ -68,12 +137,14 @@ void EDBLayer::addODBCTable(const EDBConf::Table &tableConf) {
 void EDBLayer::addMAPITable(const EDBConf::Table &tableConf) {
     EDBInfoTable infot;
     const string pn = tableConf.predname;
+    checkDictionary(pn, "");
     infot.id = (PredId_t) predDictionary.getOrAdd(pn);
     infot.arity = 3;
     infot.type = tableConf.type;
     infot.manager = std::shared_ptr<EDBTable>(new MAPITable(tableConf.params[0],
                 (int) strtol(tableConf.params[1].c_str(), NULL, 10), tableConf.params[2], tableConf.params[3],
-                tableConf.params[4], tableConf.params[5], tableConf.params[6]));
+                tableConf.params[4], tableConf.params[5], tableConf.params[6],
+                tableConf.params.size() > 7 ? tableConf.params[7] : ""));
     dbPredicates.insert(make_pair(infot.id, infot));
 }
 #endif
@@ -91,226 +162,24 @@ void EDBLayer::query(QSQQuery *query, TupleTable *outputTable,
         el->second.manager->query(query, outputTable, posToFilter, valuesToFilter);
     } else {
         IndexedTupleTable *rel = tmpRelations[predid];
-        uint8_t size = rel->getSizeTuple();
-
-	/*
-	BOOST_LOG_TRIVIAL(debug) << "Query = " << query->tostring();
-	if (posToFilter != NULL) {
-	    BOOST_LOG_TRIVIAL(debug) << "posToFilter.size() = " << posToFilter->size();
-	}
-	*/
-        switch (size) {
-        case 1: {
-            uint64_t row[1];
-            if (posToFilter != NULL) {
-                assert(posToFilter->size() == 1 &&
-                       posToFilter->at(0) == (uint8_t) 0);
-                for (std::vector<Term_t>::iterator
-                        itr = valuesToFilter->begin();
-                        itr != valuesToFilter->end(); ++itr) {
-                    if (rel->exists(*itr)) {
-                        row[0] = *itr;
-                        outputTable->addRow(row);
-                    }
-                }
-            } else {
-                //Copy all values
-                for (std::vector <Term_t>::iterator itr = rel->getSingleColumn()->begin();
-                        itr != rel->getSingleColumn()->end(); ++itr) {
-                    row[0] = *itr;
-                    outputTable->addRow(row);
-                }
-            }
-            break;
-        }
-        case 2: {
-            const uint8_t nRepeatedVars = query->getNRepeatedVars();
-            uint64_t row[2];
-            if (posToFilter == NULL || posToFilter->size() == 0) {
-                for (std::vector<std::pair<Term_t, Term_t>>::iterator
-                        itr = rel->getTwoColumn1()->begin();
-                        itr != rel->getTwoColumn1()->end(); ++itr) {
-                    bool valid = true;
-		    row[0] = itr->first;
-		    row[1] = itr->second;
-                    if (nRepeatedVars > 0) {
-                        for (uint8_t i = 0; i < nRepeatedVars; ++i) {
-                            std::pair<uint8_t, uint8_t> rp = query->getRepeatedVar(i);
-                            if (row[rp.first] != row[rp.second]) {
-                                valid = false;
-                                break;
-                            }
-                        }
-                    }
-                    if (valid) {
-                        outputTable->addRow(row);
-                    }
-                }
-            } else if (posToFilter->size() == 1) {
-		std::vector<Term_t> filterValues;
-		std::vector<Term_t>::iterator itr2 = valuesToFilter->begin();
-		bool sorted = true;
-		if (itr2 < valuesToFilter->end()) {
-		    Term_t prev = (Term_t) *itr2;
-		    filterValues.push_back(prev);
-		    itr2++;
-		    while (itr2 != valuesToFilter->end()) {
-			if (*itr2 < prev) {
-			    sorted = false;
-			    filterValues.push_back(*itr2);
-			} else if (*itr2 > prev) {
-			    filterValues.push_back(*itr2);
-			}
-			prev = *itr2;
-			itr2++;
-		    }
-		}
-		if (! sorted) {
-		    std::sort(filterValues.begin(), filterValues.end());
-		}
-                std::vector<std::pair<Term_t, Term_t>> *pairs;
-                bool inverted = posToFilter->at(0) != 0;
-                if (!inverted) {
-                    pairs = rel->getTwoColumn1();
-                    std::vector<std::pair<Term_t, Term_t>>::iterator itr1 = pairs->begin();
-                    std::vector<Term_t>::iterator itr2 = filterValues.begin();
-                    while (itr1 != pairs->end() && itr2 != filterValues.end()) {
-                        while (itr1 != pairs->end() && itr1->first < *itr2) {
-                            itr1++;
-                        }
-                        if (itr1 == pairs->end())
-                            continue;
-
-                        while (itr2 != filterValues.end() && itr1->first > *itr2) {
-                            itr2++;
-                        }
-                        if (itr1 != pairs->end() && itr2 != filterValues.end()) {
-			    if (itr1->first == *itr2) {
-				bool valid = true;
-				row[0] = itr1->first;
-				row[1] = itr1->second;
-				if (nRepeatedVars > 0) {
-				    for (uint8_t i = 0; i < nRepeatedVars; ++i) {
-					std::pair<uint8_t, uint8_t> rp = query->getRepeatedVar(i);
-					if (row[rp.first] != row[rp.second]) {
-					    valid = false;
-					    break;
-					}
-				    }
-				}
-
-				if (valid) {
-				    outputTable->addRow(row);
-				}
-			    }
-			    itr1++;
-                        }
-                    }
-                } else {
-                    pairs = rel->getTwoColumn2();
-                    std::vector<std::pair<Term_t, Term_t>>::iterator itr1 = pairs->begin();
-                    std::vector<Term_t>::iterator itr2 = filterValues.begin();
-                    while (itr1 != pairs->end() && itr2 != filterValues.end()) {
-                        while (itr1 != pairs->end() && itr1->second < *itr2) {
-                            itr1++;
-                        }
-                        if (itr1 == pairs->end())
-                            continue;
-
-                        while (itr2 != filterValues.end() && itr1->second > *itr2) {
-                            itr2++;
-                        }
-                        if (itr1 != pairs->end() && itr2 != filterValues.end()) {
-			    if (itr1->second == *itr2) {
-				bool valid = true;
-				row[0] = itr1->first;
-				row[1] = itr1->second;
-				if (nRepeatedVars > 0) {
-				    for (uint8_t i = 0; i < nRepeatedVars; ++i) {
-					std::pair<uint8_t, uint8_t> rp = query->getRepeatedVar(i);
-					if (row[rp.first] != row[rp.second]) {
-					    valid = false;
-					    break;
-					}
-				    }
-				}
-
-				if (valid) {
-				    outputTable->addRow(row);
-				}
-			    }
-			    itr1++;
-                        }
-                    }
-                }
-            } else {
-                //posToFilter==2
-		std::vector<std::pair<Term_t, Term_t>> filterValues;
-		std::vector<Term_t>::iterator itr2 = valuesToFilter->begin();
-		bool sorted = true;
-		if (itr2 < valuesToFilter->end()) {
-		    Term_t prev1 = *itr2;
-		    itr2++;
-		    Term_t prev2 = *itr2;
-		    itr2++;
-		    filterValues.push_back(std::make_pair(prev1, prev2));
-		    while (itr2 != valuesToFilter->end()) {
-			Term_t v1 = *itr2;
-			itr2++;
-			Term_t v2 = *itr2;
-			itr2++;
-			filterValues.push_back(std::make_pair(v1, v2));
-			if (sorted && (v1 < prev1 || (v1 == prev1 && v2 < prev2))) {
-			    sorted = false;
-			} else {
-			    prev1 = v1;
-			    prev2 = v2;
-			}
-		    }
-		}
-		if (! sorted) {
-		    std::sort(filterValues.begin(), filterValues.end());
-		}
-                std::vector<std::pair<Term_t, Term_t>> *pairs;
-                bool inverted = posToFilter->at(0) != 0;
-                if (!inverted) {
-                    pairs = rel->getTwoColumn1();
-                } else {
-                    pairs = rel->getTwoColumn2();
-                }
+        rel->query(*query->getLiteral(), posToFilter, valuesToFilter,
+                   outputTable);
+    }
+    // BOOST_LOG_TRIVIAL(debug) << "result size = " << outputTable->getNRows();
+}
 
-                for (std::vector<std::pair<Term_t, Term_t>>::iterator itr = filterValues.begin();
-                        itr != filterValues.end(); itr++) {
-                    //Binary search
-                    if (std::binary_search(pairs->begin(), pairs->end(),
-                                           *itr)) {
-                        bool valid = true;
-			row[0] = itr->first;
-			row[1] = itr->second;
-                        if (nRepeatedVars > 0) {
-                            for (uint8_t i = 0; i < nRepeatedVars; ++i) {
-                                std::pair<uint8_t, uint8_t> rp = query->getRepeatedVar(i);
-                                if (row[rp.first] != row[rp.second]) {
-                                    valid = false;
-                                    break;
-                                }
-                            }
-                        }
-
-                        if (valid) {
-                            outputTable->addRow(row);
-                        }
-                    }
-                }
-            }
-            break;
-        }
-        default:
-            BOOST_LOG_TRIVIAL(error) << "This should not happen";
-            throw 10;
+EDBIterator *EDBLayer::getTableIterator(const Literal &query,
+        const EDBInfoTable &info, const std::vector<uint8_t> *fields) {
+    if (prefetch) {
+        EDBIterator *itr = info.manager->getPrefetchingIterator(query, fields);
+        if (itr != NULL) {
+            return itr;
         }
     }
-    // BOOST_LOG_TRIVIAL(debug) << "result size = " << outputTable->getNRows();
+    if (fields == NULL) {
+        return info.manager->getIterator(query);
+    }
+    return info.manager->getSortedIterator(query, *fields);
 }
 
 EDBIterator *EDBLayer::getIterator(const Literal &query) {
@@ -319,7 +188,7 @@ EDBIterator *EDBLayer::getIterator(const Literal &query) {
 
     if (dbPredicates.count(predid)) {
         auto p = dbPredicates.find(predid);
-        return p->second.manager->getIterator(query);
+        return getTableIterator(query, p->second, NULL);
     } else {
         bool equalFields = query.hasRepeatedVars();
         IndexedTupleTable *rel = tmpRelations[predid];
@@ -342,8 +211,16 @@ EDBIterator *EDBLayer::getIterator(const Literal &query) {
             return itr;
         case 2:
             itr = memItrFactory.get();
-            itr->init2(predid, c1, rel->getTwoColumn1(), c1, vc1, c2, vc2, equalFields);
+            //A constant only on the second position needs the copy sorted
+            //on that position
+            if (!c1 && c2) {
+                itr->init2(predid, false, rel->getTwoColumn2(), c1, vc1, c2, vc2, equalFields);
+            } else {
+                itr->init2(predid, true, rel->getTwoColumn1(), c1, vc1, c2, vc2, equalFields);
+            }
             return itr;
+        default:
+            return rel->getIterator(query, std::vector<uint8_t>());
         }
     }
     throw 10;
@@ -356,9 +233,12 @@ EDBIterator *EDBLayer::getSortedIterator(const Literal &query,
 
     if (dbPredicates.count(predid)) {
         auto p = dbPredicates.find(predid);
-        return p->second.manager->getSortedIterator(query, fields);
+        return getTableIterator(query, p->second, &fields);
     } else {
-        assert(literal->getTupleSize() <= 2);
+        IndexedTupleTable *rel = tmpRelations[predid];
+        if (rel->getSizeTuple() > 2) {
+            return rel->getIterator(query, fields);
+        }
         bool equalFields = false;
         if (query.hasRepeatedVars()) {
             equalFields = true;
@@ -371,7 +251,6 @@ EDBIterator *EDBLayer::getSortedIterator(const Literal &query,
         if (c2)
             vc2 = literal->getTermAtPos(1).getValue();
 
-        IndexedTupleTable *rel = tmpRelations[predid];
         uint8_t size = rel->getSizeTuple();
 	// BOOST_LOG_TRIVIAL(debug) << "getSortedIterator, equalFields = " << equalFields << ", c1 = " << c1 << ", c2 = " << c2 << ", size = " << (int) size << ", fields.size() = " << fields.size();
 	for (int i = 0; i < fields.size(); i++) {
@@ -407,6 +286,34 @@ EDBIterator *EDBLayer::getSortedIterator(const Literal &query,
 
 size_t EDBLayer::getCardinalityColumn(const Literal &query,
                                       uint8_t posColumn) {
+    size_t card;
+    if (!cardCache.get(query, posColumn, card)) {
+        card = computeCardinalityColumn(query, posColumn);
+        cardCache.add(query, posColumn, card);
+    }
+    return card;
+}
+
+size_t EDBLayer::getCardinality(const Literal &query) {
+    size_t card;
+    if (!cardCache.get(query, CardinalityCache::EXACT, card)) {
+        card = computeCardinality(query);
+        cardCache.add(query, CardinalityCache::EXACT, card);
+    }
+    return card;
+}
+
+size_t EDBLayer::estimateCardinality(const Literal &query) {
+    size_t card;
+    if (!cardCache.get(query, CardinalityCache::ESTIMATE, card)) {
+        card = computeEstimate(query);
+        cardCache.add(query, CardinalityCache::ESTIMATE, card);
+    }
+    return card;
+}
+
+size_t EDBLayer::computeCardinalityColumn(const Literal &query,
+        uint8_t posColumn) {
     const Literal *literal = &query;
     PredId_t predid = literal->getPredicate().getId();
     if (dbPredicates.count(predid)) {
@@ -419,7 +326,7 @@ size_t EDBLayer::getCardinalityColumn(const Literal &query,
     }
 }
 
-size_t EDBLayer::getCardinality(const Literal &query) {
+size_t EDBLayer::computeCardinality(const Literal &query) {
     const Literal *literal = &query;
     PredId_t predid = literal->getPredicate().getId();
     if (dbPredicates.count(predid)) {
@@ -430,47 +337,11 @@ size_t EDBLayer::getCardinality(const Literal &query) {
         if (literal->getNVars() == literal->getTupleSize()) {
 	    return rel->getNTuples();
 	}
-	// TODO: Can we optimize this?
-        bool equalFields = false;
-        if (query.hasRepeatedVars()) {
-            equalFields = true;
-        }
-        uint8_t size = rel->getSizeTuple();
-
-        bool c1 = !literal->getTermAtPos(0).isVariable();
-        bool c2 = literal->getTupleSize() == 2 && !literal->getTermAtPos(1).isVariable();
-        Term_t vc1, vc2 = 0;
-        if (c1)
-            vc1 = literal->getTermAtPos(0).getValue();
-        if (c2)
-            vc2 = literal->getTermAtPos(1).getValue();
-
-        EDBMemIterator *itr = NULL;
-        switch (size) {
-        case 1:
-            itr = memItrFactory.get();
-            itr->init1(predid, rel->getSingleColumn(), c1, vc1);
-            break;
-        case 2:
-            itr = memItrFactory.get();
-	    if (c1 || ! c2) {
-		itr->init2(predid, c1, rel->getTwoColumn1(), c1, vc1, c2, vc2, equalFields);
-	    } else {
-		itr->init2(predid, c1, rel->getTwoColumn2(), c1, vc1, c2, vc2, equalFields);
-	    }
-            break;
-        }
-	size_t count = 0;
-	while (itr->hasNext()) {
-	    count++;
-	    itr->next();
-	}
-        memItrFactory.release(itr);
-	return count;
+        return rel->count(query);
     }
 }
 
-size_t EDBLayer::estimateCardinality(const Literal &query) {
+size_t EDBLayer::computeEstimate(const Literal &query) {
     const Literal *literal = &query;
     PredId_t predid = literal->getPredicate().getId();
     if (dbPredicates.count(predid)) {
@@ -494,81 +365,31 @@ bool EDBLayer::isEmpty(const Literal &query, std::vector<uint8_t> *posToFilter,
         return p->second.manager->isEmpty(query, posToFilter, valuesToFilter);
     } else {
         IndexedTupleTable *rel = tmpRelations[predid];
-        assert(literal->getTupleSize() <= 2);
-	/*
-	if (posToFilter != NULL) {
-	    BOOST_LOG_TRIVIAL(debug) << "isEmpty literal = " << literal->tostring()
-		<< ", posToFilter->size() = " << posToFilter->size() 
-		<< ", valuesToFilter->size() = " << valuesToFilter->size();
-	}
-	*/
-
-        std::unique_ptr<Literal> rewrittenLiteral;
-        if (posToFilter != NULL) {
-            //Create a new literal where the var are replaced by the constants
-            VTuple t = literal->getTuple();
-	    //TODO: this cannot be right, since valuesToFilter may contain a list of multiple
-	    //patterns. --Ceriel
-            for (int i = 0; i < posToFilter->size(); ++i) {
-                uint8_t pos = posToFilter->at(i);
-                Term_t value = valuesToFilter->at(i);
-                t.set(VTerm(0, value), pos);
-                rewrittenLiteral = std::unique_ptr<Literal>(new Literal(literal->getPredicate(), t));
-                literal = rewrittenLiteral.get();
-            }
+        if (posToFilter == NULL || posToFilter->empty()) {
+            return rel->isEmpty(query);
         }
 
-        int diff = literal->getNUniqueVars() - literal->getTupleSize();
-        if (diff == 0) {
-            return rel->getNTuples() == 0;
-        } else if (diff == -1) {
-            //The difference could be a duplicated variable or a constant
-            bool foundConstant = false;
-            uint8_t idxVar = 0;
-            Term_t valConst = 0;
-            for (uint8_t i = 0; i < literal->getTupleSize(); ++i) {
-                if (!literal->getTermAtPos(i).isVariable()) {
-                    idxVar = i;
-                    valConst = literal->getTermAtPos(i).getValue();
-                    foundConstant = true;
-                }
-            }
-            if (foundConstant) {
-                return !rel->exists(idxVar, valConst);
-            } else {
-                //Check all rows where two columns are equal
-                assert(literal->getTupleSize() == 2);
-                for (std::vector<std::pair<Term_t, Term_t>>::iterator itr =
-                            rel->getTwoColumn1()->begin(); itr != rel->getTwoColumn1()->end();
-                        ++itr) {
-                    if (itr->first == itr->second) {
-                        return false;
-                    }
-                }
-                return true;
+        //Replace the variables by the constants of each tuple to filter
+        const size_t nfields = posToFilter->size();
+        for (size_t i = 0; i < valuesToFilter->size(); i += nfields) {
+            VTuple t = literal->getTuple();
+            for (size_t j = 0; j < nfields; ++j) {
+                t.set(VTerm(0, valuesToFilter->at(i + j)), posToFilter->at(j));
             }
-        } else {
-            if (literal->getNUniqueVars() == 0) {
-                //Need to check whether a particular row exists
-                assert(literal->getTupleSize() == 2);
-                if (std::binary_search(rel->getTwoColumn1()->begin(),
-                                       rel->getTwoColumn1()->end(),
-                                       std::make_pair((Term_t) literal->getTermAtPos(0).getValue(),
-                                                      (Term_t) literal->getTermAtPos(1).getValue())))
-                    return false;
-                else
-                    return  true;
-            } else {
-                BOOST_LOG_TRIVIAL(error) << "Not supported";
-                throw 10;
+            if (!rel->isEmpty(Literal(literal->getPredicate(), t))) {
+                return false;
             }
         }
+        return true;
     }
 }
 
 // Only used in prematerialization
 void EDBLayer::addTmpRelation(Predicate & pred, IndexedTupleTable * table) {
     tmpRelations[pred.getId()] = table;
+    cardCache.invalidate(pred.getId());
+    //Any answer may depend on the relation
+    answerCache.invalidate();
 }
 
 // Only used in prematerialization
@@ -584,7 +405,14 @@ bool EDBLayer::checkValueInTmpRelation(const uint8_t relId, const uint8_t posInR
 void EDBLayer::releaseIterator(EDBIterator * itr) {
     if (dbPredicates.count(itr->getPredicateID())) {
         auto p = dbPredicates.find(itr->getPredicateID());
+        PrefetchingEDBIterator *pitr = dynamic_cast<PrefetchingEDBIterator*>(itr);
+        if (pitr != NULL) {
+            itr = pitr->release();
+            delete pitr;
+        }
         return p->second.manager->releaseIterator(itr);
+    } else if (dynamic_cast<IndexedTupleTableItr*>(itr) != NULL) {
+        delete itr;
     } else {
         memItrFactory.release((EDBMemIterator*)itr);
     }
@@ -636,6 +464,18 @@ std::shared_ptr<Column> EDBLayer::checkIn(
 
 bool EDBLayer::getDictNumber(const char *text, const size_t sizeText, uint64_t &id) {
     if (dbPredicates.size() > 0) {
+        if (dictCache) {
+            const string t(text, sizeText);
+            if (dictCache->getNumber(t, id)) {
+                return true;
+            }
+            if (dbPredicates.begin()->second.manager->
+                    getDictNumber(text, sizeText, id)) {
+                dictCache->add(id, t);
+                return true;
+            }
+            return false;
+        }
         //Get the number from the first edb table
         return dbPredicates.begin()->second.manager->
                getDictNumber(text, sizeText, id);
@@ -645,12 +485,62 @@ bool EDBLayer::getDictNumber(const char *text, const size_t sizeText, uint64_t &
 
 bool EDBLayer::getDictText(const uint64_t id, char *text) {
     if (dbPredicates.size() > 0) {
+        if (dictCache) {
+            string t;
+            if (dictCache->getText(id, t)) {
+                memcpy(text, t.c_str(), t.size() + 1);
+                return true;
+            }
+            if (dbPredicates.begin()->second.manager->getDictText(id, text)) {
+                dictCache->add(id, string(text));
+                return true;
+            }
+            return false;
+        }
         //Get the number from the first edb table
         return dbPredicates.begin()->second.manager->getDictText(id, text);
     }
     return false;
 }
 
+void EDBLayer::getDictTexts(const std::vector<uint64_t> &ids,
+                            std::vector<std::string> &texts,
+                            std::vector<bool> &found) {
+    texts.resize(ids.size());
+    found.assign(ids.size(), false);
+    if (dbPredicates.empty()) {
+        return;
+    }
+    std::shared_ptr<EDBTable> table = dbPredicates.begin()->second.manager;
+    if (!dictCache) {
+        table->getDictTexts(ids, texts, found);
+        return;
+    }
+    //Only ask the table for the terms that are not cached
+    std::vector<uint64_t> missing;
+    std::vector<size_t> posMissing;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (dictCache->getText(ids[i], texts[i])) {
+            found[i] = true;
+        } else {
+            missing.push_back(ids[i]);
+            posMissing.push_back(i);
+        }
+    }
+    if (!missing.empty()) {
+        std::vector<std::string> missingTexts;
+        std::vector<bool> missingFound;
+        table->getDictTexts(missing, missingTexts, missingFound);
+        for (size_t i = 0; i < missing.size(); ++i) {
+            if (missingFound[i]) {
+                texts[posMissing[i]] = missingTexts[i];
+                found[posMissing[i]] = true;
+                dictCache->add(missing[i], missingTexts[i]);
+            }
+        }
+    }
+}
+
 uint64_t EDBLayer::getNTerms() {
     if (dbPredicates.size() > 0) {
         //Get the number from the first edb table
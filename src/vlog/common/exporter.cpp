@@ -19,6 +19,7 @@
 #include <inttypes.h>
 #include <vector>
 #include <fstream>
+#include <algorithm>
 
 namespace fs = boost::filesystem;
 namespace bip = boost::interprocess;
@@ -421,8 +422,10 @@ void Exporter::generateNTTriples(string outputdir, bool decompress) {
     ofstream ntFile;
     boost::iostreams::filtering_stream<boost::iostreams::output> out;
 
-    char supportBuffer[MAX_TERM_SIZE];
     size_t idx = 0;
+    std::vector<uint64_t> ids;
+    std::vector<std::string> texts;
+    std::vector<bool> found;
     for (int i = 0; i < all_s.size(); ++i) {
         if (i % 10000000 == 0) {
             if (i > 0) {
@@ -439,27 +442,31 @@ void Exporter::generateNTTriples(string outputdir, bool decompress) {
             out.push(ntFile);
         }
         if (decompress) {
-            if (edb.getDictText(all_s[i], supportBuffer)) {
-                out << supportBuffer << " ";
-            } else {
-                std::string t = sn->getProgram()->getFromAdditional(all_s[i]);
-                if (t == std::string("")) t = std::to_string(all_s[i]);
-                out << t << " ";
-            }
-            if (edb.getDictText(all_p[i], supportBuffer)) {
-                out << supportBuffer << " ";
-            } else {
-                std::string t = sn->getProgram()->getFromAdditional(all_p[i]);
-                if (t == std::string("")) t = std::to_string(all_p[i]);
-                out << t << " ";
+            //Resolve the terms of the next triples at once
+            const size_t posBatch = i % EXPORT_DICT_BATCH;
+            if (posBatch == 0) {
+                const size_t end = std::min(all_s.size(),
+                                            (size_t) i + EXPORT_DICT_BATCH);
+                ids.clear();
+                for (size_t j = i; j < end; ++j) {
+                    ids.push_back(all_s[j]);
+                    ids.push_back(all_p[j]);
+                    ids.push_back(all_o[j]);
+                }
+                edb.getDictTexts(ids, texts, found);
             }
-            if (edb.getDictText(all_o[i], supportBuffer)) {
-                out << supportBuffer << " ." << endl;
-            } else {
-                std::string t = sn->getProgram()->getFromAdditional(all_o[i]);
-                if (t == std::string("")) t = std::to_string(all_o[i]);
-                out << t << " ." << endl;
+            for (int j = 0; j < 3; ++j) {
+                const size_t pos = posBatch * 3 + j;
+                if (found[pos]) {
+                    out << texts[pos];
+                } else {
+                    std::string t = sn->getProgram()->getFromAdditional(ids[pos]);
+                    if (t == std::string("")) t = std::to_string(ids[pos]);
+                    out << t;
+                }
+                out << (j < 2 ? " " : " .");
             }
+            out << endl;
         } else {
             out << all_s[i];
             out << " ";
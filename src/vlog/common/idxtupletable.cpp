@@ -2,7 +2,8 @@
 
 #include <trident/model/table.h>
 
-IndexedTupleTable::IndexedTupleTable(TupleTable *table) : sizeTuple((uint8_t) table->getSizeRow()) {
+IndexedTupleTable::IndexedTupleTable(TupleTable *table) : sizeTuple((uint8_t) table->getSizeRow()),
+    nrows(table->getNRows()), distinctValues(table->getSizeRow(), (size_t) - 1) {
 
     singleColumn = NULL;
     twoColumn1 = NULL;
@@ -10,12 +11,6 @@ IndexedTupleTable::IndexedTupleTable(TupleTable *table) : sizeTuple((uint8_t) ta
 
     //idx1 = idx2 = NULL;
     //values1 = values2 = NULL;
-    spo = pos = osp = NULL;
-
-    if (sizeTuple == 0 || sizeTuple > 3) {
-        BOOST_LOG_TRIVIAL(error) << "Not supported";
-        throw 10;
-    }
 
     if (sizeTuple == 1) {
         singleColumn = new std::vector<Term_t>();
@@ -37,25 +32,348 @@ IndexedTupleTable::IndexedTupleTable(TupleTable *table) : sizeTuple((uint8_t) ta
         std::sort(twoColumn2->begin(), twoColumn2->end(), [](const std::pair<uint64_t, uint64_t>& lhs, const std::pair<uint64_t, uint64_t>& rhs) {
             return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
         });
-    } else if (sizeTuple == 3) {
-        std::vector<uint8_t> fields;
-        fields.push_back(0);
-        fields.push_back(1);
-        fields.push_back(2);
-        spo = table->sortBy(fields);
+    } else {
+        //The table is deleted after the loading, so the rows must be
+        //copied now
+        std::unique_ptr<Permutation> perm(new Permutation());
+        for (uint8_t i = 0; i < sizeTuple; ++i) {
+            perm->order.push_back(i);
+        }
+        perm->rows.reserve(nrows * sizeTuple);
+        for (size_t i = 0; i < nrows; ++i) {
+            const uint64_t *row = table->getRow(i);
+            perm->rows.insert(perm->rows.end(), row, row + sizeTuple);
+        }
+        std::vector<size_t> idx(nrows);
+        for (size_t i = 0; i < nrows; ++i) {
+            idx[i] = i;
+        }
+        const Term_t *rows = perm->rows.data();
+        const uint8_t s = sizeTuple;
+        std::sort(idx.begin(), idx.end(), [rows, s](const size_t a, const size_t b) {
+            return std::lexicographical_compare(rows + a * s, rows + (a + 1) * s,
+                                                rows + b * s, rows + (b + 1) * s);
+        });
+        std::vector<Term_t> sorted;
+        sorted.reserve(perm->rows.size());
+        for (size_t i = 0; i < nrows; ++i) {
+            sorted.insert(sorted.end(), rows + idx[i] * s, rows + (idx[i] + 1) * s);
+        }
+        perm->rows.swap(sorted);
+        permutations[perm->order] = std::move(perm);
+    }
+}
+
+std::vector<uint8_t> IndexedTupleTable::completeOrder(
+    const std::vector<uint8_t> &order) const {
+    std::vector<uint8_t> out = order;
+    for (uint8_t i = 0; i < sizeTuple; ++i) {
+        if (std::find(order.begin(), order.end(), i) == order.end()) {
+            out.push_back(i);
+        }
+    }
+    return out;
+}
+
+const IndexedTupleTable::Permutation *IndexedTupleTable::getPermutation(
+    const std::vector<uint8_t> &order) {
+    boost::mutex::scoped_lock lock(mutex);
+    auto itr = permutations.find(order);
+    if (itr != permutations.end()) {
+        return itr->second.get();
+    }
+
+    //Copy the rows in the natural order
+    std::vector<Term_t> natural;
+    natural.reserve(nrows * sizeTuple);
+    if (sizeTuple == 1) {
+        natural = *singleColumn;
+    } else if (sizeTuple == 2) {
+        for (auto &pair : *twoColumn1) {
+            natural.push_back(pair.first);
+            natural.push_back(pair.second);
+        }
+    } else {
+        std::vector<uint8_t> identity = completeOrder(std::vector<uint8_t>());
+        natural = permutations[identity]->rows;
+    }
+
+    std::vector<size_t> idx(nrows);
+    for (size_t i = 0; i < nrows; ++i) {
+        idx[i] = i;
+    }
+    const Term_t *rows = natural.data();
+    const uint8_t s = sizeTuple;
+    std::sort(idx.begin(), idx.end(), [rows, s, &order](const size_t a,
+    const size_t b) {
+        for (auto col : order) {
+            if (rows[a * s + col] != rows[b * s + col]) {
+                return rows[a * s + col] < rows[b * s + col];
+            }
+        }
+        return false;
+    });
 
-        fields.clear();
-        fields.push_back(1);
-        fields.push_back(2);
-        fields.push_back(0);
-        pos = table->sortBy(fields);
+    std::unique_ptr<Permutation> perm(new Permutation());
+    perm->order = order;
+    perm->rows.reserve(natural.size());
+    for (size_t i = 0; i < nrows; ++i) {
+        perm->rows.insert(perm->rows.end(), rows + idx[i] * s,
+                          rows + (idx[i] + 1) * s);
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Built a permutation of " << nrows << " rows";
+    const Permutation *out = perm.get();
+    permutations[order] = std::move(perm);
+    return out;
+}
+
+uint64_t IndexedTupleTable::hashKey(const Term_t *row, const uint8_t *cols,
+                                    const uint8_t ncols) {
+    //Every term is mixed, so that keys that differ in several columns do
+    //not collide
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (uint8_t i = 0; i < ncols; ++i) {
+        Term_t v = cols != NULL ? row[cols[i]] : row[i];
+        h ^= (uint64_t) v * 0xff51afd7ed558ccdull;
+        h = (h << 29) | (h >> 35);
+    }
+    h ^= h >> 32;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 29;
+    return h;
+}
+
+const IndexedTupleTable::KeyIndex *IndexedTupleTable::getKeyIndex(
+    const Permutation *perm, const uint8_t nkeys) {
+    boost::mutex::scoped_lock lock(mutex);
+    auto key = std::make_pair(perm->order, nkeys);
+    auto itr = indexes.find(key);
+    if (itr != indexes.end()) {
+        return itr->second.get();
+    }
+
+    std::unique_ptr<KeyIndex> index(new KeyIndex());
+    const Term_t *rows = perm->rows.data();
+    const uint8_t *cols = perm->order.data();
+    size_t start = 0;
+    while (start < nrows) {
+        //Find the end of the group
+        const Term_t *first = rows + start * sizeTuple;
+        size_t end = start + 1;
+        while (end < nrows) {
+            const Term_t *r = rows + end * sizeTuple;
+            bool same = true;
+            for (uint8_t i = 0; i < nkeys; ++i) {
+                if (r[cols[i]] != first[cols[i]]) {
+                    same = false;
+                    break;
+                }
+            }
+            if (!same) {
+                break;
+            }
+            end++;
+        }
+        uint64_t hash = hashKey(first, cols, nkeys);
+        auto res = index->ranges.insert(std::make_pair(hash,
+                                        std::make_pair(start, end)));
+        if (!res.second) {
+            //Collision
+            res.first->second = std::make_pair((size_t) 0, (size_t) 0);
+        }
+        start = end;
+    }
+    const KeyIndex *out = index.get();
+    indexes[key] = std::move(index);
+    return out;
+}
 
-        fields.clear();
-        fields.push_back(2);
-        fields.push_back(0);
-        fields.push_back(1);
-        osp = table->sortBy(fields);
+int IndexedTupleTable::compareKey(const Permutation *perm, const size_t row,
+                                  const uint8_t nkeys, const Term_t *key) {
+    const uint8_t s = (uint8_t) perm->order.size();
+    const Term_t *r = perm->rows.data() + row * s;
+    for (uint8_t i = 0; i < nkeys; ++i) {
+        Term_t v = r[perm->order[i]];
+        if (v < key[i]) {
+            return -1;
+        } else if (v > key[i]) {
+            return 1;
+        }
     }
+    return 0;
+}
+
+std::pair<size_t, size_t> IndexedTupleTable::lookup(
+    const std::vector<uint8_t> &order, const uint8_t nkeys, const Term_t *key,
+    const Term_t *&rows) {
+    const Permutation *perm = getPermutation(completeOrder(order));
+    rows = perm->rows.data();
+    if (nkeys == 0 || nrows == 0) {
+        return std::make_pair((size_t) 0, nrows);
+    }
+
+    const KeyIndex *index = getKeyIndex(perm, nkeys);
+    auto itr = index->ranges.find(hashKey(key, NULL, nkeys));
+    if (itr == index->ranges.end()) {
+        return std::make_pair((size_t) 0, (size_t) 0);
+    }
+    if (itr->second.first < itr->second.second) {
+        if (compareKey(perm, itr->second.first, nkeys, key) == 0) {
+            return itr->second;
+        }
+        return std::make_pair((size_t) 0, (size_t) 0);
+    }
+
+    //Shared hash. Binary search
+    size_t low = 0, high = nrows;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (compareKey(perm, mid, nkeys, key) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    size_t start = low;
+    high = nrows;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (compareKey(perm, mid, nkeys, key) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return std::make_pair(start, low);
+}
+
+EDBIterator *IndexedTupleTable::getIterator(const Literal &query,
+        const std::vector<uint8_t> &fields) {
+    std::vector<uint8_t> order;
+    std::vector<Term_t> key;
+    for (uint8_t i = 0; i < query.getTupleSize(); ++i) {
+        if (!query.getTermAtPos(i).isVariable()) {
+            order.push_back(i);
+            key.push_back(query.getTermAtPos(i).getValue());
+        }
+    }
+    std::vector<uint8_t> posVars = query.getPosVars();
+    for (auto f : fields) {
+        order.push_back(posVars[f]);
+    }
+    int posFirstVar = -1;
+    if (!fields.empty()) {
+        posFirstVar = posVars[fields[0]];
+    } else if (!posVars.empty()) {
+        posFirstVar = posVars[0];
+    }
+
+    const Term_t *rows;
+    std::pair<size_t, size_t> range = lookup(order, (uint8_t) key.size(),
+                                       key.data(), rows);
+    return new IndexedTupleTableItr(query.getPredicate().getId(), rows,
+                                    sizeTuple, range.first, range.second,
+                                    query, posFirstVar);
+}
+
+void IndexedTupleTable::query(const Literal &query,
+                              std::vector<uint8_t> *posToFilter,
+                              std::vector<Term_t> *valuesToFilter,
+                              TupleTable *outputTable) {
+    std::vector<uint8_t> order;
+    std::vector<Term_t> key;
+    for (uint8_t i = 0; i < query.getTupleSize(); ++i) {
+        if (!query.getTermAtPos(i).isVariable()) {
+            order.push_back(i);
+            key.push_back(query.getTermAtPos(i).getValue());
+        }
+    }
+    const uint8_t nconstants = (uint8_t) order.size();
+    const std::vector<std::pair<uint8_t, uint8_t>> repeatedVars =
+        query.getRepeatedVars();
+
+    //Distinct tuples to look up
+    std::vector<std::vector<Term_t>> filters;
+    if (posToFilter != NULL && !posToFilter->empty()) {
+        const size_t nfields = posToFilter->size();
+        for (size_t i = 0; i < valuesToFilter->size(); i += nfields) {
+            filters.push_back(std::vector<Term_t>(
+                                  valuesToFilter->begin() + i,
+                                  valuesToFilter->begin() + i + nfields));
+        }
+        std::sort(filters.begin(), filters.end());
+        filters.erase(std::unique(filters.begin(), filters.end()),
+                      filters.end());
+        order.insert(order.end(), posToFilter->begin(), posToFilter->end());
+    } else {
+        filters.push_back(std::vector<Term_t>());
+    }
+
+    for (auto &filter : filters) {
+        key.resize(nconstants);
+        key.insert(key.end(), filter.begin(), filter.end());
+        const Term_t *rows;
+        std::pair<size_t, size_t> range = lookup(order, (uint8_t) key.size(),
+                                           key.data(), rows);
+        for (size_t i = range.first; i < range.second; ++i) {
+            const Term_t *row = rows + i * sizeTuple;
+            bool valid = true;
+            for (auto &rp : repeatedVars) {
+                if (row[rp.first] != row[rp.second]) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid) {
+                outputTable->addRow(row);
+            }
+        }
+    }
+}
+
+size_t IndexedTupleTable::count(const Literal &query) {
+    std::vector<uint8_t> fields;
+    EDBIterator *itr = getIterator(query, fields);
+    size_t count = 0;
+    if (!query.hasRepeatedVars()) {
+        count = ((IndexedTupleTableItr*)itr)->getNRows();
+    } else {
+        while (itr->hasNext()) {
+            itr->next();
+            count++;
+        }
+    }
+    delete itr;
+    return count;
+}
+
+bool IndexedTupleTable::isEmpty(const Literal &query) {
+    std::vector<uint8_t> fields;
+    EDBIterator *itr = getIterator(query, fields);
+    bool empty = !itr->hasNext();
+    delete itr;
+    return empty;
+}
+
+size_t IndexedTupleTable::distinct(const uint8_t colid) {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if (distinctValues[colid] != (size_t) - 1) {
+            return distinctValues[colid];
+        }
+    }
+    const Permutation *perm = getPermutation(completeOrder(
+                                  std::vector<uint8_t>(1, colid)));
+    size_t n = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        if (i == 0 || perm->rows[i * sizeTuple + colid] !=
+                perm->rows[(i - 1) * sizeTuple + colid]) {
+            n++;
+        }
+    }
+    boost::mutex::scoped_lock lock(mutex);
+    distinctValues[colid] = n;
+    return n;
 }
 
 /*void IndexedTupleTable::query(QSQQuery *query, std::vector<uint8_t> *posToFilter,
@@ -91,14 +409,44 @@ IndexedTupleTable::~IndexedTupleTable() {
     if (twoColumn2 != NULL) {
         delete twoColumn2;
     }
-    if (spo != NULL) {
-        delete spo;
+}
+
+IndexedTupleTableItr::IndexedTupleTableItr(PredId_t predid,
+        const Term_t *rows, const uint8_t sizeTuple, const size_t start,
+        const size_t end, const Literal &query, const int posFirstVar) :
+    predid(predid), rows(rows), sizeTuple(sizeTuple), current(start),
+    nextRow(start), end(end), repeatedVars(query.getRepeatedVars()),
+    posFirstVar(posFirstVar), skipDuplicatedFirst(false), isFirst(true) {
+}
+
+bool IndexedTupleTableItr::matches(const size_t row) const {
+    const Term_t *r = rows + row * sizeTuple;
+    for (auto &rp : repeatedVars) {
+        if (r[rp.first] != r[rp.second]) {
+            return false;
+        }
+    }
+    if (skipDuplicatedFirst && !isFirst) {
+        return r[posFirstVar] != rows[current * sizeTuple + posFirstVar];
     }
-    if (pos != NULL) {
-        delete pos;
+    return true;
+}
+
+bool IndexedTupleTableItr::hasNext() {
+    while (nextRow < end && !matches(nextRow)) {
+        nextRow++;
     }
-    if (osp != NULL) {
-        delete osp;
+    return nextRow < end;
+}
+
+void IndexedTupleTableItr::next() {
+    current = nextRow++;
+    isFirst = false;
+}
+
+void IndexedTupleTableItr::skipDuplicatedFirstColumn() {
+    if (posFirstVar != -1) {
+        skipDuplicatedFirst = true;
     }
 }
 
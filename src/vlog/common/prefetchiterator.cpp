@@ -0,0 +1,176 @@
+#include <vlog/prefetchiterator.h>
+
+#include <boost/log/trivial.hpp>
+
+PrefetchingEDBIterator::PrefetchingEDBIterator(EDBIterator *itr,
+        const PredId_t predid, const uint8_t arity) : itr(itr),
+    predid(predid), arity(arity), head(0), count(0), done(false),
+    stopped(false), started(false), tail(0), holdsBatch(false), nextRow(0),
+    currentRow(0), hasNextChecked(false), hasNextValue(false) {
+}
+
+void PrefetchingEDBIterator::start() {
+    for (int i = 0; i < PREFETCH_NBATCHES; ++i) {
+        ring[i].values.resize((size_t) arity * PREFETCH_BATCH_ROWS);
+        ring[i].nrows = 0;
+    }
+    started = true;
+    thread = boost::thread(&PrefetchingEDBIterator::prefetch, this);
+}
+
+void PrefetchingEDBIterator::prefetch() {
+    while (true) {
+        size_t slot;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (count == PREFETCH_NBATCHES && !stopped) {
+                cond.wait(lock);
+            }
+            if (stopped) {
+                return;
+            }
+            slot = head;
+        }
+
+        //The slot is free, so the consumer does not read it
+        Batch &b = ring[slot];
+        b.nrows = 0;
+        std::exception_ptr e;
+        try {
+            while (b.nrows < PREFETCH_BATCH_ROWS && itr->hasNext()) {
+                itr->next();
+                for (uint8_t i = 0; i < arity; ++i) {
+                    b.values[i * PREFETCH_BATCH_ROWS + b.nrows] = itr->getElementAt(i);
+                }
+                b.nrows++;
+            }
+        } catch (...) {
+            //An exception must not leave the thread
+            e = std::current_exception();
+        }
+
+        boost::mutex::scoped_lock lock(mutex);
+        if (e) {
+            //The rows of the failed batch are not complete
+            error = e;
+            done = true;
+            cond.notify_all();
+            return;
+        }
+        if (b.nrows > 0) {
+            head = (head + 1) % PREFETCH_NBATCHES;
+            count++;
+        }
+        if (b.nrows < PREFETCH_BATCH_ROWS) {
+            done = true;
+        }
+        cond.notify_all();
+        if (done) {
+            return;
+        }
+    }
+}
+
+bool PrefetchingEDBIterator::hasNext() {
+    if (hasNextChecked) {
+        return hasNextValue;
+    }
+    if (!started) {
+        start();
+    }
+    if (holdsBatch && nextRow < ring[tail].nrows) {
+        hasNextValue = true;
+    } else {
+        boost::mutex::scoped_lock lock(mutex);
+        if (holdsBatch) {
+            //Give the batch back to the producer
+            tail = (tail + 1) % PREFETCH_NBATCHES;
+            count--;
+            holdsBatch = false;
+            cond.notify_all();
+        }
+        while (count == 0 && !done) {
+            cond.wait(lock);
+        }
+        if (count == 0 && error) {
+            BOOST_LOG_TRIVIAL(error) << "The prefetching of predicate " << predid << " failed";
+            std::rethrow_exception(error);
+        }
+        if (count > 0) {
+            holdsBatch = true;
+            nextRow = 0;
+        }
+        hasNextValue = holdsBatch;
+    }
+    hasNextChecked = true;
+    return hasNextValue;
+}
+
+void PrefetchingEDBIterator::next() {
+    if (!hasNextChecked || !hasNextValue) {
+        BOOST_LOG_TRIVIAL(error) << "PrefetchingEDBIterator::next called without hasNext check";
+        throw 10;
+    }
+    currentRow = nextRow++;
+    hasNextChecked = false;
+}
+
+Term_t PrefetchingEDBIterator::getElementAt(const uint8_t p) {
+    return ring[tail].values[p * PREFETCH_BATCH_ROWS + currentRow];
+}
+
+void PrefetchingEDBIterator::moveTo(const uint8_t field, const Term_t t) {
+    if (started) {
+        BOOST_LOG_TRIVIAL(error) << "moveTo is not supported once the prefetching has started";
+        throw 10;
+    }
+    itr->moveTo(field, t);
+}
+
+void PrefetchingEDBIterator::skipDuplicatedFirstColumn() {
+    if (started) {
+        BOOST_LOG_TRIVIAL(error) << "skipDuplicatedFirstColumn must be called before the prefetching starts";
+        throw 10;
+    }
+    itr->skipDuplicatedFirstColumn();
+}
+
+const char *PrefetchingEDBIterator::getUnderlyingArray(uint8_t column) {
+    if (started) {
+        return NULL;
+    }
+    return itr->getUnderlyingArray(column);
+}
+
+std::pair<uint8_t, std::pair<uint8_t, uint8_t>>
+PrefetchingEDBIterator::getSizeElemUnderlyingArray(uint8_t column) {
+    if (started) {
+        return std::make_pair(0, std::make_pair(0, 0));
+    }
+    return itr->getSizeElemUnderlyingArray(column);
+}
+
+void PrefetchingEDBIterator::stop() {
+    if (started) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            stopped = true;
+            cond.notify_all();
+        }
+        thread.join();
+    }
+}
+
+void PrefetchingEDBIterator::clear() {
+    stop();
+    itr->clear();
+}
+
+EDBIterator *PrefetchingEDBIterator::release() {
+    stop();
+    return itr;
+}
+
+PrefetchingEDBIterator::~PrefetchingEDBIterator() {
+    stop();
+}
@@ -0,0 +1,149 @@
+#include <vlog/sqlpartitioned.h>
+
+#include <boost/log/trivial.hpp>
+
+PartitionedSQLIterator::PartitionedSQLIterator(const PredId_t predid,
+        const uint8_t arity, const int posFirstVar,
+        std::vector<std::function<EDBIterator*()>> queries) :
+    predid(predid), arity(arity), posFirstVar(posFirstVar),
+    currentPartition(0), nextRow(0), currentRow(arity), hasNextChecked(false),
+    hasNextValue(false), isFirst(true), skipDuplicatedFirst(false) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+        partitions.push_back(std::unique_ptr<Partition>(new Partition()));
+    }
+    //Start the threads once all the partitions exist
+    for (size_t i = 0; i < queries.size(); ++i) {
+        threads.push_back(boost::thread(&PartitionedSQLIterator::scan, this,
+                                        partitions[i].get(), queries[i]));
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Scanning predicate " << predid << " in " << queries.size() << " partitions";
+}
+
+void PartitionedSQLIterator::scan(Partition *p,
+                                  std::function<EDBIterator*()> open) {
+    std::vector<Term_t> rows;
+    std::exception_ptr error;
+    EDBIterator *itr = NULL;
+    try {
+        itr = open();
+        bool stopped = false;
+        while (!stopped && itr->hasNext()) {
+            itr->next();
+            for (uint8_t i = 0; i < arity; ++i) {
+                rows.push_back(itr->getElementAt(i));
+            }
+            if (rows.size() >= SQL_PARTITION_CHUNK_ROWS * arity) {
+                boost::mutex::scoped_lock lock(p->mutex);
+                while (p->chunks.size() >= SQL_PARTITION_MAX_CHUNKS &&
+                        !p->stopped) {
+                    p->cond.wait(lock);
+                }
+                stopped = p->stopped;
+                p->chunks.push_back(std::move(rows));
+                rows.clear();
+                p->cond.notify_all();
+            }
+        }
+        itr->clear();
+    } catch (...) {
+        //An exception must not leave the thread
+        error = std::current_exception();
+    }
+    if (itr != NULL) {
+        delete itr;
+    }
+
+    boost::mutex::scoped_lock lock(p->mutex);
+    if (error) {
+        p->error = error;
+    } else if (!rows.empty()) {
+        p->chunks.push_back(std::move(rows));
+    }
+    p->done = true;
+    p->cond.notify_all();
+}
+
+bool PartitionedSQLIterator::loadNextRow() {
+    while (nextRow * arity >= chunk.size()) {
+        if (currentPartition >= partitions.size()) {
+            return false;
+        }
+        Partition *p = partitions[currentPartition].get();
+        boost::mutex::scoped_lock lock(p->mutex);
+        while (p->chunks.empty() && !p->done) {
+            p->cond.wait(lock);
+        }
+        if (p->error) {
+            //The rows read before the error are not complete
+            BOOST_LOG_TRIVIAL(error) << "The scan of partition " << currentPartition << " of predicate " << predid << " failed";
+            std::rethrow_exception(p->error);
+        }
+        if (!p->chunks.empty()) {
+            chunk = std::move(p->chunks.front());
+            p->chunks.pop_front();
+            nextRow = 0;
+            p->cond.notify_all();
+        } else {
+            currentPartition++;
+        }
+    }
+    return true;
+}
+
+bool PartitionedSQLIterator::hasNext() {
+    if (hasNextChecked) {
+        return hasNextValue;
+    }
+    hasNextValue = loadNextRow();
+    if (skipDuplicatedFirst && !isFirst) {
+        while (hasNextValue && chunk[nextRow * arity + posFirstVar] ==
+                currentRow[posFirstVar]) {
+            nextRow++;
+            hasNextValue = loadNextRow();
+        }
+    }
+    hasNextChecked = true;
+    return hasNextValue;
+}
+
+void PartitionedSQLIterator::next() {
+    if (!hasNextChecked) {
+        BOOST_LOG_TRIVIAL(error) << "PartitionedSQLIterator::next called without hasNext check";
+        throw 10;
+    }
+    if (!hasNextValue) {
+        throw 10;
+    }
+    std::copy(chunk.begin() + nextRow * arity,
+              chunk.begin() + (nextRow + 1) * arity, currentRow.begin());
+    nextRow++;
+    isFirst = false;
+    hasNextChecked = false;
+}
+
+Term_t PartitionedSQLIterator::getElementAt(const uint8_t p) {
+    return currentRow[p];
+}
+
+void PartitionedSQLIterator::skipDuplicatedFirstColumn() {
+    if (posFirstVar != -1) {
+        skipDuplicatedFirst = true;
+    }
+}
+
+void PartitionedSQLIterator::clear() {
+    //Stop the threads that are still reading
+    for (auto &p : partitions) {
+        boost::mutex::scoped_lock lock(p->mutex);
+        p->stopped = true;
+        p->cond.notify_all();
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
+
+PartitionedSQLIterator::~PartitionedSQLIterator() {
+    clear();
+}
@@ -0,0 +1,99 @@
+#include <vlog/sqlstats.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+double SQLColumnStats::estimateRows(const Term_t v) const {
+    if (upper.empty() || v < min || v > upper.back()) {
+        return 0;
+    }
+    const size_t b = std::lower_bound(upper.begin(), upper.end(), v) -
+                     upper.begin();
+    //Values are uniformly distributed within a bucket
+    return (double) rows[b] / std::max((uint64_t) 1, distinct[b]);
+}
+
+bool SQLStats::isEmpty(const Literal &query) const {
+    if (nrows == 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < query.getTupleSize() && i < columns.size(); ++i) {
+        VTerm t = query.getTermAtPos(i);
+        if (!t.isVariable() && columns[i].estimateRows(t.getValue()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SQLStats::estimateCardinality(const Literal &query) const {
+    if (isEmpty(query)) {
+        return 0;
+    }
+    double card = nrows;
+    for (uint8_t i = 0; i < query.getTupleSize() && i < columns.size(); ++i) {
+        VTerm t = query.getTermAtPos(i);
+        if (!t.isVariable()) {
+            card *= columns[i].estimateRows(t.getValue()) / nrows;
+        }
+    }
+    for (const auto &r : query.getRepeatedVars()) {
+        card /= std::max((uint64_t) 1, std::max(columns[r.first].ndv,
+                         columns[r.second].ndv));
+    }
+    return std::max((size_t) 1, (size_t) std::ceil(card));
+}
+
+size_t SQLStats::estimateCardinalityColumn(const Literal &query,
+        const uint8_t posColumn) const {
+    if (!query.getTermAtPos(posColumn).isVariable()) {
+        return isEmpty(query) ? 0 : 1;
+    }
+    const size_t card = estimateCardinality(query);
+    return std::min(card, (size_t) std::max((uint64_t) 1, columns[posColumn].ndv));
+}
+
+bool SQLStats::load(std::string path, const size_t ncolumns) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    size_t n;
+    in >> nrows >> n;
+    if (!in || n != ncolumns) {
+        BOOST_LOG_TRIVIAL(warning) << "The statistics in " << path << " do not match the table. Collecting them again.";
+        return false;
+    }
+    columns.resize(n);
+    for (auto &c : columns) {
+        size_t nbuckets;
+        in >> c.ndv >> c.min >> nbuckets;
+        c.upper.resize(nbuckets);
+        c.rows.resize(nbuckets);
+        c.distinct.resize(nbuckets);
+        for (size_t b = 0; b < nbuckets; ++b) {
+            in >> c.upper[b] >> c.rows[b] >> c.distinct[b];
+        }
+    }
+    if (!in) {
+        BOOST_LOG_TRIVIAL(warning) << "The statistics in " << path << " are truncated. Collecting them again.";
+        columns.clear();
+        return false;
+    }
+    return true;
+}
+
+void SQLStats::save(std::string path) const {
+    std::ofstream out(path);
+    out << nrows << " " << columns.size() << std::endl;
+    for (const auto &c : columns) {
+        out << c.ndv << " " << c.min << " " << c.upper.size() << std::endl;
+        for (size_t b = 0; b < c.upper.size(); ++b) {
+            out << c.upper[b] << " " << c.rows[b] << " " << c.distinct[b] <<
+                std::endl;
+        }
+    }
+}
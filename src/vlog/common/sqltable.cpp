@@ -1,103 +1,256 @@
 #include <sstream>
 #include <string>
+#include <algorithm>
 
 #include <vlog/sqltable.h>
+#include <vlog/sqlpartitioned.h>
 
 
+//Tuples of a semi-join sent in one IN list
+#define SEMIJOIN_BATCH_SIZE 1000
+//Above this number of tuples the semi-join uses a temporary table
+#define SEMIJOIN_TEMP_TABLE_THRESHOLD 10000
+
+string SQLTable::selectFields(const std::vector<string> &fields) {
+    string out = "";
+    for (int i = 0; i < fields.size(); i++) {
+        if (i != 0) {
+            out += ", ";
+        }
+        out += fields[i];
+    }
+    return out;
+}
+
+string SQLTable::existsSubQuery(const Literal &l,
+                                const std::vector<uint8_t> &fields,
+                                const std::vector<string> &outerFields,
+                                const bool exists) {
+    std::vector<string> innerFields;
+    for (const auto &f : fieldTables) {
+        innerFields.push_back("b." + f);
+    }
+    string sqlQuery = string(exists ? "" : "NOT ") + "EXISTS (SELECT * FROM " +
+                      tablename + " b WHERE ";
+    string cond = literalConstraintsToSQLQuery(l, innerFields);
+    string cond1 = repeatedToSQLQuery(l, innerFields);
+    if (cond1 != "") {
+        cond += (cond != "" ? " AND " : "") + cond1;
+    }
+    for (int i = 0; i < fields.size(); i++) {
+        if (cond != "") {
+            cond += " AND ";
+        }
+        cond += innerFields[fields[i]] + " = " + outerFields[i];
+    }
+    return sqlQuery + cond + ")";
+}
+
+void SQLTable::semiJoin(const Literal &l, const std::vector<uint8_t> &fields,
+                        std::vector<Term_t> &candidates, const bool exists,
+                        std::vector<std::shared_ptr<ColumnWriter>> &output) {
+    const int sz = fields.size();
+    const size_t nrows = candidates.size() / sz;
+
+    //Sort the candidates and remove the duplicates
+    std::vector<size_t> idx(nrows);
+    for (size_t i = 0; i < nrows; i++) {
+        idx[i] = i;
+    }
+    auto less = [&](const size_t r1, const size_t r2) {
+        for (int j = 0; j < sz; j++) {
+            if (candidates[r1 * sz + j] != candidates[r2 * sz + j]) {
+                return candidates[r1 * sz + j] < candidates[r2 * sz + j];
+            }
+        }
+        return false;
+    };
+    std::sort(idx.begin(), idx.end(), less);
+    std::vector<Term_t> rows;
+    for (size_t i = 0; i < nrows; i++) {
+        if (i == 0 || less(idx[i - 1], idx[i])) {
+            for (int j = 0; j < sz; j++) {
+                rows.push_back(candidates[idx[i] * sz + j]);
+            }
+        }
+    }
+    const size_t nunique = rows.size() / sz;
+    if (nunique == 0) {
+        return;
+    }
+
+    if (nunique > SEMIJOIN_TEMP_TABLE_THRESHOLD) {
+        //Ship the candidates once and let the database do the (anti-)join
+        std::vector<string> tempFields;
+        string createTable = "CREATE TEMPORARY TABLE vlog_semijoin (";
+        for (int j = 0; j < sz; j++) {
+            tempFields.push_back("vlog_semijoin.x" + to_string(j));
+            createTable += "x" + to_string(j) + " BIGINT, ";
+        }
+        createTable += "PRIMARY KEY (";
+        for (int j = 0; j < sz; j++) {
+            createTable += (j > 0 ? ", x" : "x") + to_string(j);
+        }
+        createTable += "))";
+        executeUpdate(createTable);
+        executeUpdate("START TRANSACTION");
+        for (size_t start = 0; start < nunique; start += SEMIJOIN_BATCH_SIZE) {
+            const size_t end = std::min(nunique, start + SEMIJOIN_BATCH_SIZE);
+            string insert = "INSERT INTO vlog_semijoin VALUES ";
+            for (size_t i = start; i < end; i++) {
+                insert += i > start ? ", (" : "(";
+                for (int j = 0; j < sz; j++) {
+                    insert += (j > 0 ? ", " : "") + to_string(rows[i * sz + j]);
+                }
+                insert += ")";
+            }
+            executeUpdate(insert);
+        }
+        executeUpdate("COMMIT");
+
+        string sqlQuery = "SELECT " + selectFields(tempFields) +
+                          " FROM vlog_semijoin WHERE " +
+                          existsSubQuery(l, fields, tempFields, exists) +
+                          " ORDER BY " + selectFields(tempFields);
+        EDBIterator *iter = executeQuery(sqlQuery, l, sz);
+        while (iter->hasNext()) {
+            iter->next();
+            for (int j = 0; j < sz; j++) {
+                output[j]->add(iter->getElementAt(j));
+            }
+        }
+        iter->clear();
+        delete iter;
+        executeUpdate("DROP TABLE vlog_semijoin");
+        return;
+    }
+
+    //Ask which candidates occur, in batches, and merge with the candidates
+    std::vector<string> keyFields;
+    for (int j = 0; j < sz; j++) {
+        keyFields.push_back(fieldTables[fields[j]]);
+    }
+    string prefix = "SELECT DISTINCT " + selectFields(keyFields) + " FROM " +
+                    tablename + " WHERE ";
+    string cond = literalConstraintsToSQLQuery(l, fieldTables);
+    string cond1 = repeatedToSQLQuery(l, fieldTables);
+    if (cond1 != "") {
+        cond += (cond != "" ? " AND " : "") + cond1;
+    }
+    if (cond != "") {
+        prefix += cond + " AND ";
+    }
+    std::vector<Term_t> found(sz);
+    for (size_t start = 0; start < nunique; start += SEMIJOIN_BATCH_SIZE) {
+        const size_t end = std::min(nunique, start + SEMIJOIN_BATCH_SIZE);
+        string sqlQuery = prefix;
+        if (sz == 1) {
+            sqlQuery += keyFields[0] + " IN (";
+            for (size_t i = start; i < end; i++) {
+                sqlQuery += (i > start ? ", " : "") + to_string(rows[i]);
+            }
+            sqlQuery += ")";
+        } else {
+            sqlQuery += "(";
+            for (size_t i = start; i < end; i++) {
+                sqlQuery += i > start ? " OR (" : "(";
+                for (int j = 0; j < sz; j++) {
+                    sqlQuery += (j > 0 ? " AND " : "") + keyFields[j] + " = " +
+                                to_string(rows[i * sz + j]);
+                }
+                sqlQuery += ")";
+            }
+            sqlQuery += ")";
+        }
+        sqlQuery += " ORDER BY " + selectFields(keyFields);
+
+        EDBIterator *iter = executeQuery(sqlQuery, l, sz);
+        bool hasFound = iter->hasNext();
+        if (hasFound) {
+            iter->next();
+            for (int j = 0; j < sz; j++) {
+                found[j] = iter->getElementAt(j);
+            }
+        }
+        for (size_t i = start; i < end; i++) {
+            const Term_t *row = &rows[i * sz];
+            //Skip the found tuples smaller than the candidate
+            while (hasFound && std::lexicographical_compare(found.begin(),
+                    found.end(), row, row + sz)) {
+                hasFound = iter->hasNext();
+                if (hasFound) {
+                    iter->next();
+                    for (int j = 0; j < sz; j++) {
+                        found[j] = iter->getElementAt(j);
+                    }
+                }
+            }
+            const bool match = hasFound && std::equal(found.begin(),
+                               found.end(), row);
+            if (match == exists) {
+                for (int j = 0; j < sz; j++) {
+                    output[j]->add(row[j]);
+                }
+            }
+        }
+        iter->clear();
+        delete iter;
+    }
+}
+
 std::vector<std::shared_ptr<Column>> SQLTable::checkNewIn(const Literal &l1,
                                   std::vector<uint8_t> &posInL1,
                                   const Literal &l2,
 std::vector<uint8_t> &posInL2) {
 
     BOOST_LOG_TRIVIAL(debug) << "checkNewIn version 1";
+    //Both literals are in this table: the anti-join runs in the database
     std::vector<uint8_t> posVars1 = l1.getPosVars();
-    std::vector<uint8_t> fieldsToSort1;
+    std::vector<uint8_t> posVars2 = l2.getPosVars();
+    std::vector<uint8_t> fields2;
+    for (int i = 0; i < posInL2.size(); i++) {
+	fields2.push_back(posVars2[posInL2[i]]);
+    }
+    std::vector<string> outerFields;
+    std::vector<string> aliased;
+    for (const auto &f : fieldTables) {
+	aliased.push_back("a." + f);
+    }
     for (int i = 0; i < posInL1.size(); i++) {
-	fieldsToSort1.push_back(posVars1[posInL1[i]]);
+	outerFields.push_back(aliased[posVars1[posInL1[i]]]);
     }
-    EDBIterator *iter1 = getSortedIterator(l1, fieldsToSort1);
 
-    std::vector<uint8_t> posVars2 = l2.getPosVars();
-    std::vector<uint8_t> fieldsToSort2;
-    for (int i = 0; i < posInL2.size(); i++) {
-	fieldsToSort2.push_back(posVars2[posInL2[i]]);
+    string sqlQuery = "SELECT DISTINCT " + selectFields(outerFields) + " FROM " +
+	tablename + " a WHERE ";
+    string cond = literalConstraintsToSQLQuery(l1, aliased);
+    string cond1 = repeatedToSQLQuery(l1, aliased);
+    if (cond1 != "") {
+	cond += (cond != "" ? " AND " : "") + cond1;
+    }
+    if (cond != "") {
+	sqlQuery += cond + " AND ";
     }
-    EDBIterator *iter2 = getSortedIterator(l2, fieldsToSort2);
+    sqlQuery += existsSubQuery(l2, fields2, outerFields, false) +
+	" ORDER BY " + selectFields(outerFields);
 
     std::vector<std::shared_ptr<ColumnWriter>> cols;
-    for (int i = 0; i < fieldsToSort1.size(); i++) {
+    for (int i = 0; i < posInL1.size(); i++) {
 	cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
     }
-
-    bool more = false;
-    if (iter1->hasNext() && iter2->hasNext()) {
-	iter1->next();
-	iter2->next();
-	while (true) {
-	    bool equal = true;
-	    bool lt = false;
-	    for (int i = 0; i < fieldsToSort1.size(); i++) {
-		if (iter1->getElementAt(fieldsToSort1[i]) != iter2->getElementAt(fieldsToSort2[i])) {
-		    equal = false;
-		    lt = iter1->getElementAt(fieldsToSort1[i]) != iter2->getElementAt(fieldsToSort2[i]);
-		    break;
-		}
-	    }
-	    if (equal) {
-		if (iter1->hasNext()) {
-		    iter1->next();
-		    if (iter2->hasNext()) {
-			iter2->next();
-		    } else {
-			more = true;
-			break;
-		    }
-		} else {
-		    break;
-		}
-	    } else if (lt) {
-		for (int i = 0; i < fieldsToSort1.size(); i++) {
-		    cols[i]->add(iter1->getElementAt(fieldsToSort1[i]));
-		}
-		if (iter1->hasNext()) {
-		    iter1->next();
-		} else {
-		    break;
-		}
-	    } else {
-		if (iter2->hasNext()) {
-		    iter2->next();
-		} else {
-		    more = true;
-		    break;
-		}
-	    }
-	}
-    } else {
-	more = iter1->hasNext();
-    }
-
-    if (more) {
-	for (int i = 0; i < fieldsToSort1.size(); i++) {
-	    cols[i]->add(iter1->getElementAt(fieldsToSort1[i]));
-	}
-	while (iter1->hasNext()) {
-	    iter1->next();
-	    for (int i = 0; i < fieldsToSort1.size(); i++) {
-		cols[i]->add(iter1->getElementAt(fieldsToSort1[i]));
-	    }
+    EDBIterator *iter = executeQuery(sqlQuery, l1, outerFields.size());
+    while (iter->hasNext()) {
+	iter->next();
+	for (int i = 0; i < cols.size(); i++) {
+	    cols[i]->add(iter->getElementAt(i));
 	}
     }
+    iter->clear();
+    delete iter;
 
     std::vector<std::shared_ptr<Column>> output;
     for (auto &writer : cols) {
 	output.push_back(writer->getColumn());
     }
-
-    iter1->clear();
-    iter2->clear();
-    delete iter1;
-    delete iter2;
     return output;
 }
 
@@ -110,148 +263,38 @@ std::vector<uint8_t> &posInL) {
     BOOST_LOG_TRIVIAL(debug) << "checkNewIn version 2";
 
     std::vector<uint8_t> posVars = l.getPosVars();
-    std::vector<uint8_t> fieldsToSort;
+    std::vector<uint8_t> fields;
     for (int i = 0; i < posInL.size(); i++) {
-	fieldsToSort.push_back(posVars[posInL[i]]);
-    }
-
-    EDBIterator *iter = getSortedIterator(l, fieldsToSort);
-
-    int sz = checkValues.size();
-
-    std::vector<std::shared_ptr<ColumnWriter>> cols;
-    for (int i = 0; i < fieldsToSort.size(); i++) {
-	cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+	fields.push_back(posVars[posInL[i]]);
     }
 
-    std::vector<std::unique_ptr<ColumnReader>> valuesToChReader;
-
-    for (int i = 0; i < checkValues.size(); i++) {
-	std::shared_ptr<Column> valuesToCh = checkValues[i];
-	valuesToChReader.push_back(valuesToCh->getReader());
-    }
-
-    std::vector<Term_t> prevcv;
-    std::vector<Term_t> cv;
-    std::vector<Term_t> vi;
-
+    //Only the values to check are sent to the database
+    const int sz = checkValues.size();
+    std::vector<std::unique_ptr<ColumnReader>> readers;
     for (int i = 0; i < sz; i++) {
-	prevcv.push_back((Term_t) -1);
-	cv.push_back((Term_t) -1);
-	vi.push_back((Term_t) -1);
+	readers.push_back(checkValues[i]->getReader());
     }
-
-    if (iter->hasNext()) {
-	iter->next();
+    std::vector<Term_t> candidates;
+    while (sz > 0 && readers[0]->hasNext()) {
 	for (int i = 0; i < sz; i++) {
-	    if (! valuesToChReader[i]->hasNext()) {
+	    if (!readers[i]->hasNext()) {
 		throw 10;
 	    }
-	    cv[i] = valuesToChReader[i]->next();
+	    candidates.push_back(readers[i]->next());
 	}
+    }
 
-	bool equal;
-
-	while (true) {
-	    for (int i = 0; i < sz; i++) {
-		vi[i] = iter->getElementAt(fieldsToSort[i]);
-	    }
-	    equal = true;
-	    bool lt = false;
-	    for (int i = 0; i < sz; i++) {
-		if (vi[i] == cv[i]) {
-		} else {
-		    if (vi[i] < cv[i]) {
-			lt = true;
-		    }
-		    equal = false;
-		    break;
-		}
-	    }
-	    if (equal) {
-		for (int i = 0; i < sz; i++) {
-		    prevcv[i] = cv[i];
-		}
-		if (iter->hasNext()) {
-		    iter->next();
-		    for (int i = 0; i < sz; i++) {
-                        if (!valuesToChReader[i]->hasNext()) {
-                            cv[0] = (Term_t) - 1;
-                            break;
-                        } else {
-                            cv[i] = valuesToChReader[i]->next();
-                        }
-                    }
-		    if (cv[0] == (Term_t) -1) {
-			break;
-		    }
-		} else {
-		    break;
-		}
-	    } else if (lt) {
-		if (iter->hasNext()) {
-		    iter->next();
-		} else {
-		    break;
-		}
-	    } else {
-		equal = true;
-		for (int i = 0; i < sz; i++) {
-		    if (cv[i] != prevcv[i]) {
-			equal = false;
-			break;
-		    }
-		}
-		if (! equal) {
-		    for (int i = 0; i < sz; i++) {
-			cols[i]->add(cv[i]);
-                        prevcv[i] = cv[i];
-                    }
-		}
-		for (int i = 0; i < sz; i++) {
-		    if (!valuesToChReader[i]->hasNext()) {
-			cv[0] = (Term_t) - 1;
-			break;
-		    } else {
-			cv[i] = valuesToChReader[i]->next();
-		    }
-		}
-		if (cv[0] == (Term_t) -1) {
-		    break;
-		}
-            }
-        }
-
-        while (cv[0] != (Term_t) - 1) {
-	    equal = true;
-	    for (int i = 0; i < sz; i++) {
-		if (cv[i] != prevcv[i]) {
-		    equal = false;
-		    break;
-		}
-	    }
-	    if (! equal) {
-		for (int i = 0; i < sz; i++) {
-		    cols[i]->add(cv[i]);
-		    prevcv[i] = cv[i];
-		}
-	    }
-	    for (int i = 0; i < sz; i++) {
-		if (!valuesToChReader[i]->hasNext()) {
-		    cv[0] = (Term_t) - 1;
-		    break;
-		} else {
-		    cv[i] = valuesToChReader[i]->next();
-		}
-	    }
-	}
+    std::vector<std::shared_ptr<ColumnWriter>> cols;
+    for (int i = 0; i < sz; i++) {
+	cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+    }
+    if (sz > 0) {
+	semiJoin(l, fields, candidates, false, cols);
     }
 
     std::vector<std::shared_ptr<Column>> output;
     for (auto &el : cols)
         output.push_back(el->getColumn());
-    iter->clear();
-    delete iter;
     return output;
 }
 
@@ -267,36 +310,14 @@ std::shared_ptr<Column> SQLTable::checkIn(
     }
 
     std::vector<uint8_t> posVars = l.getPosVars();
-    std::vector<uint8_t> fieldsToSort;
-    fieldsToSort.push_back(posVars[posInL]);
-    EDBIterator *iter = getSortedIterator(l, fieldsToSort);
-
-    //Output
-    std::unique_ptr<ColumnWriter> col(new ColumnWriter());
-    size_t idx1 = 0;
-    const uint8_t varIndex = posVars[posInL];
-    sizeOutput = 0;
-    while (iter->hasNext()) {
-	iter->next();
-	const Term_t v2 = iter->getElementAt(varIndex);
-	while (values[idx1] < v2) {
-	    idx1++;
-	    if (idx1 == values.size()) {
-		break;
-	    }
-	}
-	if (values[idx1] == v2) {
-	    col->add(v2);
-	    sizeOutput++;
-	    idx1++;
-	    if (idx1 == values.size()) {
-		break;
-	    }
-	}
-    }
-    iter->clear();
-    delete iter;
-    return col->getColumn();
+    std::vector<uint8_t> fields;
+    fields.push_back(posVars[posInL]);
+
+    std::vector<std::shared_ptr<ColumnWriter>> cols;
+    cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+    semiJoin(l, fields, values, true, cols);
+    sizeOutput = cols[0]->size();
+    return cols[0]->getColumn();
 }
 
 string SQLTable::literalConstraintsToSQLQuery(const Literal &q,
@@ -329,11 +350,266 @@ string SQLTable::repeatedToSQLQuery(const Literal &q,
     return cond;
 }
 
+//Terms resolved with one query of getDictTexts
+#define DICT_BATCH_SIZE 1000
+
+string SQLTable::dictTextsQuery(const std::vector<uint64_t> &ids,
+                                const size_t start, size_t &end) {
+    end = std::min(ids.size(), start + DICT_BATCH_SIZE);
+    string query = "SELECT id, value from dict where id IN (";
+    for (size_t i = start; i < end; i++) {
+        if (i != start) {
+            query += ",";
+        }
+        query += to_string(ids[i]);
+    }
+    return query + ")";
+}
+
+void SQLTable::initStatistics(string param) {
+    useStats = param != "exact";
+    statsFile = useStats ? param : "";
+}
+
+SQLStats *SQLTable::getStats(const Literal &query) {
+    if (!useStats) {
+        return NULL;
+    }
+    boost::mutex::scoped_lock lock(statsMutex);
+    if (stats) {
+        return stats.get();
+    }
+    stats = std::unique_ptr<SQLStats>(new SQLStats());
+    if (statsFile != "" && stats->load(statsFile, fieldTables.size())) {
+        BOOST_LOG_TRIVIAL(debug) << "Loaded the statistics of " << tablename << " from " << statsFile;
+        return stats.get();
+    }
+
+    //Two aggregate queries per column: the totals, then one group per
+    //bucket of the histogram
+    BOOST_LOG_TRIVIAL(info) << "Collecting the statistics of " << tablename << " ...";
+    stats = std::unique_ptr<SQLStats>(new SQLStats());
+    uint64_t nrows = 0;
+    for (int i = 0; i < fieldTables.size(); i++) {
+        const string f = fieldTables[i];
+        SQLColumnStats c;
+        uint64_t total = 0;
+        Term_t max = 0;
+        string sqlQuery = "SELECT COUNT(*), COUNT(DISTINCT " + f + "), MIN(" +
+            f + "), MAX(" + f + ") FROM " + tablename;
+        EDBIterator *iter = executeQuery(sqlQuery, query, 4);
+        if (iter->hasNext()) {
+            iter->next();
+            total = iter->getElementAt(0);
+            c.ndv = iter->getElementAt(1);
+            if (total > 0) {
+                c.min = iter->getElementAt(2);
+                max = iter->getElementAt(3);
+            }
+        }
+        iter->clear();
+        delete iter;
+        if (i == 0) {
+            nrows = total;
+        }
+
+        if (total > 0) {
+            const uint64_t width = (max - c.min) / SQLSTATS_NBUCKETS + 1;
+            const string bucket = "FLOOR((" + f + " - " + to_string(c.min) +
+                ") / " + to_string(width) + ")";
+            sqlQuery = "SELECT MAX(" + f + "), COUNT(*), COUNT(DISTINCT " + f +
+                ") FROM " + tablename + " GROUP BY " + bucket +
+                " ORDER BY MAX(" + f + ")";
+            iter = executeQuery(sqlQuery, query, 3);
+            while (iter->hasNext()) {
+                iter->next();
+                c.upper.push_back(iter->getElementAt(0));
+                c.rows.push_back(iter->getElementAt(1));
+                c.distinct.push_back(iter->getElementAt(2));
+            }
+            iter->clear();
+            delete iter;
+        }
+        stats->addColumn(c);
+    }
+    stats->setNRows(nrows);
+    if (statsFile != "") {
+        stats->save(statsFile);
+    }
+    return stats.get();
+}
+
+string SQLTable::countKey(const Literal &query, const int posColumn) {
+    string key = to_string(posColumn);
+    for (int i = 0; i < query.getTupleSize(); i++) {
+        VTerm t = query.getTermAtPos(i);
+        key += t.isVariable() ? " v" + to_string(t.getId()) :
+            " c" + to_string(t.getValue());
+    }
+    return key;
+}
+
+size_t SQLTable::getCardinality(const Literal &query) {
+    SQLStats *s = getStats(query);
+    if (s != NULL) {
+        if (s->isEmpty(query)) {
+            return 0;
+        }
+        if (query.getNVars() == query.getTupleSize() &&
+                query.getRepeatedVars().empty()) {
+            return s->getNRows();
+        }
+    }
+    const string key = countKey(query, -1);
+    {
+        boost::mutex::scoped_lock lock(statsMutex);
+        auto itr = exactCounts.find(key);
+        if (itr != exactCounts.end()) {
+            return itr->second;
+        }
+    }
+    const size_t card = exactCardinality(query);
+    boost::mutex::scoped_lock lock(statsMutex);
+    exactCounts[key] = card;
+    return card;
+}
+
+size_t SQLTable::getCardinalityColumn(const Literal &query, uint8_t posColumn) {
+    SQLStats *s = getStats(query);
+    if (s != NULL) {
+        if (s->isEmpty(query)) {
+            return 0;
+        }
+        //The statistics have the exact number of distinct values
+        if (query.getNVars() == query.getTupleSize() &&
+                query.getRepeatedVars().empty()) {
+            return s->estimateCardinalityColumn(query, posColumn);
+        }
+    }
+    const string key = countKey(query, posColumn);
+    {
+        boost::mutex::scoped_lock lock(statsMutex);
+        auto itr = exactCounts.find(key);
+        if (itr != exactCounts.end()) {
+            return itr->second;
+        }
+    }
+    const size_t card = exactCardinalityColumn(query, posColumn);
+    boost::mutex::scoped_lock lock(statsMutex);
+    exactCounts[key] = card;
+    return card;
+}
+
 size_t SQLTable::estimateCardinality(const Literal &query) {
-    //TODO: This should be improved
+    SQLStats *s = getStats(query);
+    if (s != NULL) {
+        return s->estimateCardinality(query);
+    }
     return getCardinality(query);
 }
 
+EDBIterator *SQLTable::getPrefetchingIterator(const Literal &query,
+        const std::vector<uint8_t> *fields) {
+    if (query.getNVars() == 0) {
+        return NULL;
+    }
+    return partitionedScan(query, fields, true);
+}
+
+EDBIterator *SQLTable::partitionedScan(const Literal &query,
+        const std::vector<uint8_t> *sortingFieldsIdx, const bool prefetch) {
+    if (query.getNVars() == 0 || (!prefetch &&
+            estimateCardinality(query) < SQL_PARALLEL_SCAN_THRESHOLD)) {
+        return NULL;
+    }
+
+    //Positions of the variables in the table
+    std::vector<int> posVars;
+    for (int i = 0; i < query.getTupleSize(); ++i) {
+        if (query.getTermAtPos(i).isVariable()) {
+            posVars.push_back(i);
+        }
+    }
+    string order = "";
+    int posFirstVar = posVars[0];
+    if (sortingFieldsIdx != NULL && sortingFieldsIdx->size() > 0) {
+        posFirstVar = posVars[sortingFieldsIdx->at(0)];
+        for (int i = 0; i < sortingFieldsIdx->size(); ++i) {
+            if (i != 0) {
+                order += ",";
+            }
+            order += fieldTables[posVars[sortingFieldsIdx->at(i)]];
+        }
+    }
+    const string column = fieldTables[posFirstVar];
+
+    string cond = literalConstraintsToSQLQuery(query, fieldTables);
+    string cond1 = repeatedToSQLQuery(query, fieldTables);
+    if (cond1 != "") {
+        cond += (cond != "" ? " AND " : "") + cond1;
+    }
+
+    //Bounds of the partitioning column. They are NULL if no row matches
+    string sqlQuery = "SELECT COUNT(*), MIN(" + column + "), MAX(" + column +
+        ") FROM " + tablename + (cond != "" ? " WHERE " + cond : "");
+    EDBIterator *iter = executeQuery(sqlQuery, query, 3);
+    uint64_t count = 0;
+    Term_t min = 0, max = 0;
+    if (iter->hasNext()) {
+        iter->next();
+        count = iter->getElementAt(0);
+        if (count > 0) {
+            min = iter->getElementAt(1);
+            max = iter->getElementAt(2);
+        }
+    }
+    iter->clear();
+    delete iter;
+    if (!prefetch && (count == 0 || min >= max)) {
+        return NULL;
+    }
+
+    //Ranges of (almost) the same width. The data might be skewed, but the
+    //partitions are only read ahead of the consumer. A small scan is read
+    //in a single partition
+    std::vector<Term_t> bounds;
+    const bool small = count < SQL_PARALLEL_SCAN_THRESHOLD || min >= max;
+    for (int i = 1; i < SQL_SCAN_PARTITIONS && !small; ++i) {
+        bounds.push_back(min + (Term_t) ((double) (max - min) * i /
+                                         SQL_SCAN_PARTITIONS));
+    }
+    std::vector<std::function<EDBIterator*()>> queries;
+    const uint8_t arity = query.getTupleSize();
+    for (int i = 0; i <= bounds.size(); ++i) {
+        string range = "";
+        if (i > 0) {
+            range = column + " >= " + to_string(bounds[i - 1]);
+        }
+        if (i < bounds.size()) {
+            range += (range != "" ? " AND " : "") + column + " < " +
+                to_string(bounds[i]);
+        }
+        if (cond != "") {
+            range += (range != "" ? " AND " : "") + cond;
+        }
+        string q = "SELECT * FROM " + tablename;
+        if (range != "") {
+            q += " WHERE " + range;
+        }
+        if (order != "") {
+            q += " ORDER BY " + order;
+        }
+        queries.push_back([this, q, query, arity]() {
+            return executePooledQuery(q, query, arity);
+        });
+    }
+    if (posVars.size() <= 1) {
+        posFirstVar = -1;
+    }
+    return new PartitionedSQLIterator(query.getPredicate().getId(), arity,
+                                      posFirstVar, queries);
+}
+
 void SQLTable::releaseIterator(EDBIterator *itr) {
     delete itr;
 }
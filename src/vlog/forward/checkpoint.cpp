@@ -0,0 +1,222 @@
+#include <vlog/seminaiver.h>
+#include <vlog/fctable.h>
+#include <vlog/fcinttable.h>
+#include <vlog/columnio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <fstream>
+#include <cstring>
+
+/*** Checkpoints of a running materialization.
+ * The file contains the iteration counter, the last execution of every
+ * rule, the statistics and all the derived blocks. The content of the blocks
+ * is stored with ColumnIO. Blocks that are views over the EDB layer are not
+ * stored: they are recreated from the EDB layer when the checkpoint is loaded.
+ ***/
+
+#define CHECKPOINT_MAGIC "VLOGCKP1"
+
+template<typename T>
+static void writeValue(std::ostream &out, const T &value) {
+    out.write((const char*) &value, sizeof(T));
+}
+
+template<typename T>
+static T readValue(std::istream &in) {
+    T value;
+    in.read((char*) &value, sizeof(T));
+    if (!in) {
+        BOOST_LOG_TRIVIAL(error) << "The checkpoint is truncated";
+        throw 10;
+    }
+    return value;
+}
+
+void SemiNaiver::setCheckpoint(std::string path, const long intervalSeconds) {
+    checkpointPath = path;
+    checkpointInterval = intervalSeconds;
+}
+
+void SemiNaiver::checkpointIfNeeded() {
+    if (checkpointPath == "" || checkpointInterval <= 0) {
+        return;
+    }
+    boost::chrono::duration<double> sec = boost::chrono::system_clock::now()
+                                          - lastCheckpoint;
+    if (sec.count() < checkpointInterval) {
+        return;
+    }
+    if (checkpointThread.joinable()) {
+        if (!checkpointThread.try_join_for(boost::chrono::milliseconds(0))) {
+            //The previous checkpoint is still being written
+            return;
+        }
+    }
+
+    //The tables inside the blocks are immutable. Copying the pointers is
+    //enough to get a consistent snapshot
+    std::shared_ptr<Checkpoint> checkpoint(new Checkpoint());
+    checkpoint->iteration = iteration;
+    for (const auto &rule : ruleset) {
+        checkpoint->lastExecutions.push_back(std::make_pair(rule.ruleid,
+                                             rule.lastExecution));
+    }
+    checkpoint->stats = statsRuleExecution;
+    for (PredId_t i = 0; i < MAX_NPREDS; ++i) {
+        FCTable *table = predicatesTables[i];
+        if (table == NULL) {
+            continue;
+        }
+        FCIterator itr = table->read(0);
+        while (!itr.isEmpty()) {
+            std::shared_ptr<const FCInternalTable> t = itr.getCurrentTable();
+            if (!t->isEDB()) {
+                checkpoint->blocks.push_back(CheckpointBlock(i,
+                                             *itr.getCurrentBlock()));
+            }
+            itr.moveNextCount();
+        }
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Writing checkpoint at iteration " << iteration;
+    lastCheckpoint = boost::chrono::system_clock::now();
+    checkpointThread = boost::thread(&SemiNaiver::writeCheckpoint, checkpoint,
+                                     checkpointPath);
+}
+
+void SemiNaiver::writeCheckpoint(std::shared_ptr<Checkpoint> checkpoint,
+                                 std::string path) {
+    boost::chrono::system_clock::time_point start =
+        boost::chrono::system_clock::now();
+    //Write on a temporary file first, so that a crash while writing does not
+    //destroy the previous checkpoint
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios_base::binary);
+        out.write(CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC));
+        writeValue(out, (uint64_t) checkpoint->iteration);
+
+        writeValue(out, (uint64_t) checkpoint->lastExecutions.size());
+        for (const auto &el : checkpoint->lastExecutions) {
+            writeValue(out, (uint64_t) el.first);
+            writeValue(out, el.second);
+        }
+
+        writeValue(out, (uint64_t) checkpoint->stats.size());
+        for (const auto &el : checkpoint->stats) {
+            writeValue(out, el);
+        }
+
+        writeValue(out, (uint64_t) checkpoint->blocks.size());
+        for (const auto &block : checkpoint->blocks) {
+            writeValue(out, block.pred);
+            writeValue(out, (uint64_t) block.firstIteration);
+            writeValue(out, (uint64_t) block.iteration);
+            writeValue(out, block.ruleid);
+            writeValue(out, block.ruleExecOrder);
+            writeValue(out, block.isCompleted);
+            writeValue(out, block.query.getPredicate().getAdorment());
+            const uint8_t size = (uint8_t) block.query.getTupleSize();
+            writeValue(out, size);
+            for (uint8_t i = 0; i < size; ++i) {
+                VTerm t = block.query.getTermAtPos(i);
+                writeValue(out, t.getId());
+                writeValue(out, t.getValue());
+            }
+            writeValue(out, block.table->getRowSize());
+            ColumnIO::write(out, block.table.get());
+        }
+        if (!out) {
+            BOOST_LOG_TRIVIAL(error) << "Failed writing the checkpoint " << tmpPath;
+            return;
+        }
+    }
+    boost::filesystem::rename(tmpPath, path);
+
+    boost::chrono::duration<double> sec = boost::chrono::system_clock::now()
+                                          - start;
+    BOOST_LOG_TRIVIAL(info) << "Checkpoint of iteration " <<
+                            checkpoint->iteration << " written in " <<
+                            sec.count() * 1000 << "ms";
+}
+
+const RuleExecutionDetails *SemiNaiver::getRuleDetails(const int ruleid) const {
+    for (const auto &rule : ruleset) {
+        if (rule.ruleid == ruleid)
+            return &rule;
+    }
+    for (const auto &rule : edbRuleset) {
+        if (rule.ruleid == ruleid)
+            return &rule;
+    }
+    return NULL;
+}
+
+size_t SemiNaiver::loadCheckpoint(std::string path) {
+    std::ifstream in(path, std::ios_base::binary);
+    char magic[8];
+    in.read(magic, sizeof(magic));
+    if (!in || strncmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+        BOOST_LOG_TRIVIAL(error) << "File " << path << " is not a checkpoint";
+        throw 10;
+    }
+    const size_t it = readValue<uint64_t>(in);
+
+    resumedLastExecutions.clear();
+    const uint64_t nrules = readValue<uint64_t>(in);
+    for (uint64_t i = 0; i < nrules; ++i) {
+        const size_t ruleid = readValue<uint64_t>(in);
+        resumedLastExecutions[ruleid] = readValue<uint32_t>(in);
+    }
+
+    statsRuleExecution.clear();
+    const uint64_t nstats = readValue<uint64_t>(in);
+    for (uint64_t i = 0; i < nstats; ++i) {
+        statsRuleExecution.push_back(readValue<StatsRule>(in));
+    }
+
+    const uint64_t nblocks = readValue<uint64_t>(in);
+    for (uint64_t i = 0; i < nblocks; ++i) {
+        const PredId_t pred = readValue<PredId_t>(in);
+        const size_t firstIteration = readValue<uint64_t>(in);
+        const size_t blockIteration = readValue<uint64_t>(in);
+        const int ruleid = readValue<int>(in);
+        const uint8_t ruleExecOrder = readValue<uint8_t>(in);
+        const bool isCompleted = readValue<bool>(in);
+        const uint8_t adornment = readValue<uint8_t>(in);
+        const uint8_t size = readValue<uint8_t>(in);
+        VTuple tuple(size);
+        for (uint8_t j = 0; j < size; ++j) {
+            const uint8_t id = readValue<uint8_t>(in);
+            const uint64_t value = readValue<uint64_t>(in);
+            tuple.set(VTerm(id, value), j);
+        }
+        Literal query(Predicate(program->getPredicate(pred), adornment), tuple);
+        const uint8_t rowSize = readValue<uint8_t>(in);
+        std::shared_ptr<const Segment> seg = ColumnIO::read(in);
+
+        FCTable *table = predicatesTables[pred];
+        if (table == NULL) {
+            if (query.getPredicate().getType() == EDB && blockIteration > 0) {
+                //Recreate the view over the EDB layer
+                getTableFromEDBLayer(getGenericLiteral(pred));
+                table = predicatesTables[pred];
+            } else {
+                table = getTable(pred, query.getTupleSize());
+            }
+        }
+        std::shared_ptr<const FCInternalTable> t(
+            new InmemoryFCInternalTable(rowSize, blockIteration, true, seg));
+        FCBlock block(blockIteration, t, query, getRuleDetails(ruleid),
+                      ruleExecOrder, isCompleted);
+        block.firstIteration = firstIteration;
+        table->addBlock(block);
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Loaded checkpoint " << path << ": iteration="
+                            << it << " blocks=" << nblocks;
+    resumed = true;
+    return it;
+}
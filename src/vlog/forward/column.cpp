@@ -2,6 +2,7 @@
 #include <vlog/segment.h>
 #include <vlog/qsqquery.h>
 #include <vlog/trident/tridentiterator.h>
+#include <vlog/prefetchiterator.h>
 #include <kognac/utils.h>
 
 #include <boost/log/trivial.hpp>
@@ -406,7 +407,10 @@ std::vector<Term_t> EDBColumnReader::load(const Literal &l,
                 = itr->getSizeElemUnderlyingArray(posInItr);
         const int totalsize = sizeelements.first + sizeelements.second.first + sizeelements.second.second;
 
-        size_t nrows = ((TridentIterator *) itr)->getCardinality();
+        //The raw arrays only come from Trident, maybe behind a prefetcher
+        PrefetchingEDBIterator *pitr = dynamic_cast<PrefetchingEDBIterator*>(itr);
+        EDBIterator *base = pitr != NULL ? pitr->getUnderlyingIterator() : itr;
+        size_t nrows = ((TridentIterator *) base)->getCardinality();
 
         values.reserve(nrows);
 
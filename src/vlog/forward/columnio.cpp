@@ -0,0 +1,86 @@
+#include <vlog/columnio.h>
+#include <vlog/column.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <lz4.h>
+
+#include <memory>
+
+void ColumnIO::writeColumn(std::ostream &out,
+                           const std::vector<Term_t> &column) {
+    std::unique_ptr<char[]> buffer(new char[LZ4_compressBound(
+                                       COLUMNIO_CHUNK * sizeof(Term_t))]);
+    for (size_t begin = 0; begin < column.size(); begin += COLUMNIO_CHUNK) {
+        const size_t n = std::min((size_t) COLUMNIO_CHUNK, column.size() - begin);
+        const int size = (int) (n * sizeof(Term_t));
+        const int csize = LZ4_compress_default((const char*) &column[begin],
+                                               buffer.get(), size,
+                                               LZ4_compressBound(size));
+        if (csize <= 0) {
+            BOOST_LOG_TRIVIAL(error) << "LZ4 compression failed";
+            throw 10;
+        }
+        out.write((const char*) &csize, sizeof(csize));
+        out.write(buffer.get(), csize);
+    }
+}
+
+void ColumnIO::readColumn(std::istream &in, const size_t nrows,
+                          std::vector<Term_t> &column) {
+    column.resize(nrows);
+    std::unique_ptr<char[]> buffer(new char[LZ4_compressBound(
+                                       COLUMNIO_CHUNK * sizeof(Term_t))]);
+    for (size_t begin = 0; begin < nrows; begin += COLUMNIO_CHUNK) {
+        const size_t n = std::min((size_t) COLUMNIO_CHUNK, nrows - begin);
+        int csize;
+        in.read((char*) &csize, sizeof(csize));
+        in.read(buffer.get(), csize);
+        const int size = LZ4_decompress_safe(buffer.get(),
+                                             (char*) &column[begin], csize,
+                                             (int) (n * sizeof(Term_t)));
+        if (!in || size != (int) (n * sizeof(Term_t))) {
+            BOOST_LOG_TRIVIAL(error) << "Corrupted column";
+            throw 10;
+        }
+    }
+}
+
+void ColumnIO::write(std::ostream &out,
+                     const std::vector<const std::vector<Term_t> *> &columns,
+                     const size_t nrows) {
+    const uint8_t ncolumns = (uint8_t) columns.size();
+    const uint64_t n = nrows;
+    out.write((const char*) &ncolumns, sizeof(ncolumns));
+    out.write((const char*) &n, sizeof(n));
+    for (const auto column : columns) {
+        writeColumn(out, *column);
+    }
+}
+
+void ColumnIO::write(std::ostream &out, const FCInternalTable *table) {
+    FCInternalTableItr *itr = table->getIterator();
+    std::vector<const std::vector<Term_t> *> vectors = itr->getAllVectors();
+    write(out, vectors, table->getNRows());
+    itr->deleteAllVectors(vectors);
+    table->releaseIterator(itr);
+}
+
+std::shared_ptr<const Segment> ColumnIO::read(std::istream &in) {
+    uint8_t ncolumns;
+    uint64_t nrows;
+    in.read((char*) &ncolumns, sizeof(ncolumns));
+    in.read((char*) &nrows, sizeof(nrows));
+    if (!in) {
+        BOOST_LOG_TRIVIAL(error) << "Unexpected end of the stream";
+        throw 10;
+    }
+    std::vector<std::shared_ptr<Column>> columns;
+    for (uint8_t i = 0; i < ncolumns; ++i) {
+        std::vector<Term_t> values;
+        readColumn(in, nrows, values);
+        columns.push_back(std::shared_ptr<Column>(
+                              new InmemoryColumn(values, true)));
+    }
+    return std::shared_ptr<const Segment>(new Segment(ncolumns, columns));
+}
@@ -0,0 +1,91 @@
+#include <vlog/compactor.h>
+#include <vlog/segment.h>
+
+#include <boost/log/trivial.hpp>
+
+Compactor::Compactor() : stop(false) {
+    thread = boost::thread(&Compactor::run, this);
+}
+
+bool Compactor::isBusy(const PredId_t pred) {
+    boost::mutex::scoped_lock lock(mutex);
+    return busy.count(pred);
+}
+
+void Compactor::submit(std::shared_ptr<CompactionJob> job) {
+    boost::mutex::scoped_lock lock(mutex);
+    busy.insert(job->pred);
+    pending.push_back(job);
+    cond.notify_one();
+}
+
+std::vector<std::shared_ptr<CompactionJob>> Compactor::getFinishedJobs() {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<std::shared_ptr<CompactionJob>> out;
+    out.swap(finished);
+    for (const auto &job : out) {
+        busy.erase(job->pred);
+    }
+    return out;
+}
+
+std::shared_ptr<const FCInternalTable> Compactor::compact(
+    const CompactionJob &job) {
+    const uint8_t nfields = job.tables[0]->getRowSize();
+    std::vector<std::shared_ptr<const Segment>> segments;
+    for (const auto &table : job.tables) {
+        FCInternalTableItr *itr = table->getIterator();
+        std::vector<std::shared_ptr<Column>> columns = itr->getAllColumns();
+        table->releaseIterator(itr);
+        std::shared_ptr<const Segment> seg(new Segment(nfields, columns));
+        if (!table->isSorted()) {
+            seg = seg->sortBy(NULL);
+        }
+        segments.push_back(seg);
+    }
+    //The blocks of a predicate are disjoint, but unique also guarantees
+    //that the merged block is a set if they are not
+    std::shared_ptr<const Segment> seg = SegmentInserter::merge(segments);
+    seg = SegmentInserter::unique(seg);
+    return std::shared_ptr<const FCInternalTable>(
+               new InmemoryFCInternalTable(nfields, job.iteration, true, seg));
+}
+
+void Compactor::run() {
+    while (true) {
+        std::shared_ptr<CompactionJob> job;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (!stop && pending.empty()) {
+                cond.wait(lock);
+            }
+            if (stop) {
+                return;
+            }
+            job = pending.front();
+            pending.pop_front();
+        }
+
+        boost::chrono::system_clock::time_point start =
+            boost::chrono::system_clock::now();
+        job->result = compact(*job);
+        boost::chrono::duration<double> sec =
+            boost::chrono::system_clock::now() - start;
+        BOOST_LOG_TRIVIAL(debug) << "Compacted " << job->tables.size() <<
+                                 " blocks of predicate " << job->pred <<
+                                 " into " << job->result->getNRows() <<
+                                 " rows in " << sec.count() * 1000 << "ms";
+
+        boost::mutex::scoped_lock lock(mutex);
+        finished.push_back(job);
+    }
+}
+
+Compactor::~Compactor() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        stop = true;
+        cond.notify_one();
+    }
+    thread.join();
+}
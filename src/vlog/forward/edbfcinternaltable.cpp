@@ -30,6 +30,42 @@ bool EDBFCInternalTable::isEmpty() const {
     return retval;
 }
 
+bool EDBFCInternalTable::containsRow(SegmentIterator &itr) const {
+    const Literal l = *query.getLiteral();
+    VTuple t = l.getTuple();
+    for (uint8_t i = 0; i < nfields; ++i) {
+        t.set(VTerm(0, itr.get(i)), posFields[i]);
+    }
+    return !layer->isEmpty(Literal(l.getPredicate(), t), NULL, NULL);
+}
+
+bool EDBFCInternalTable::containsAny(std::shared_ptr<const Segment> rows) const {
+    std::unique_ptr<SegmentIterator> itr = rows->iterator();
+    while (itr->hasNext()) {
+        itr->next();
+        if (containsRow(*itr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<const Segment> EDBFCInternalTable::getContained(
+    std::shared_ptr<const Segment> rows) const {
+    SegmentInserter inserter(nfields);
+    Term_t row[MAX_ROWSIZE];
+    std::unique_ptr<SegmentIterator> itr = rows->iterator();
+    while (itr->hasNext()) {
+        itr->next();
+        if (containsRow(*itr)) {
+            for (uint8_t i = 0; i < nfields; ++i) {
+                row[i] = itr->get(i);
+            }
+            inserter.addRow(row);
+        }
+    }
+    return inserter.getSegment();
+}
 
 uint8_t EDBFCInternalTable::getRowSize() const {
     return nfields;
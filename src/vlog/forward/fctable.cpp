@@ -2,13 +2,14 @@
 #include <vlog/fctable.h>
 #include <vlog/joinprocessor.h>
 #include <vlog/concepts.h>
+#include <vlog/spilledtable.h>
 
 #include <trident/model/table.h>
 
 // Note: When running multithreaded, mutex != NULL.
 
 FCTable::FCTable(boost::shared_mutex *mutex, const uint8_t sizeRow) :
-    sizeRow(sizeRow), mutex(mutex) {
+    sizeRow(sizeRow), sealedBlocks(0), mutex(mutex) {
 }
 
 /*boost::shared_mutex *FCTable::getMutex() const {
@@ -109,11 +110,10 @@ std::shared_ptr<const FCTable> FCTable::filter(const Literal &literal, const siz
         std::string signature = getSignature(literal);
         BOOST_LOG_TRIVIAL(trace) << "FCTable::filter: literal = " << literal.tostring() << ", signature = " << signature;
 
-        if (mutex != NULL) {
-            // We need a separate lock for the cache. We cannot promote the mutex to an exclusive
-            // lock here, since that leads to deadlocks.
-            cache_mutex.lock();
-        }
+        // We need a separate lock for the cache. We cannot promote the mutex to an exclusive
+        // lock here, since that leads to deadlocks. The sequential reasoner
+        // also filters concurrently when it partitions the joins of a rule.
+        cache_mutex.lock();
 
         FCCache::iterator cacheItr = cache.find(signature);
         if (cacheItr != cache.end()) {
@@ -128,9 +128,7 @@ std::shared_ptr<const FCTable> FCTable::filter(const Literal &literal, const siz
                 }
             } else {
                 BOOST_LOG_TRIVIAL(trace) << "returned";
-                if (mutex != NULL) {
-                    cache_mutex.unlock();
-                }
+                cache_mutex.unlock();
                 return output;
             }
         } else {
@@ -216,9 +214,7 @@ std::shared_ptr<const FCTable> FCTable::filter(const Literal &literal, const siz
             b.end = blocks[blocks.size() - 1].iteration;
             cache.insert(std::make_pair(signature, b));
         }
-        if (mutex != NULL) {
-            cache_mutex.unlock();
-        }
+        cache_mutex.unlock();
         return output;
     } else {
         throw 10;
@@ -253,6 +249,10 @@ bool FCTable::isEmpty(size_t count) const {
     return true;
 }
 
+bool FCTable::isOnlyEDB() const {
+    return blocks.size() == 1 && blocks[0].table->isEDB();
+}
+
 std::shared_ptr<const Segment> FCTable::retainFrom(
     std::shared_ptr<const Segment> t,
     const bool dupl,
@@ -342,6 +342,66 @@ bool FCTable::add(std::shared_ptr<const FCInternalTable> t,
     return true;
 }
 
+bool FCTable::remove(std::shared_ptr<const Segment> rows, int nthreads) {
+    std::shared_ptr<const FCInternalTable> toRemove(
+        new InmemoryFCInternalTable(sizeRow, 0, true, rows));
+    bool removed = false;
+    std::vector<FCBlock> newblocks;
+    for (std::vector<FCBlock>::const_iterator itr = blocks.cbegin();
+            itr != blocks.cend(); ++itr) {
+        //Only the blocks that contain some of the rows are copied. The EDB
+        //blocks are probed row by row instead of being read
+        bool affected;
+        if (itr->table->isEDB()) {
+            affected = ((const EDBFCInternalTable*) itr->table.get())->
+                       containsAny(rows);
+        } else {
+            //retain replaces the segment it receives
+            std::shared_ptr<const Segment> notInBlock = rows;
+            affected = SegmentInserter::retain(notInBlock, itr->table, false,
+                                               nthreads)->getNRows() <
+                       rows->getNRows();
+        }
+        if (!affected) {
+            newblocks.push_back(*itr);
+            continue;
+        }
+
+        FCInternalTableItr *titr = itr->table->getIterator();
+        std::vector<std::shared_ptr<Column>> columns = titr->getAllColumns();
+        itr->table->releaseIterator(titr);
+        std::shared_ptr<const Segment> seg(new Segment(sizeRow, columns));
+        const size_t nrows = seg->getNRows();
+        if (!itr->table->isSorted()) {
+            seg = seg->sortBy(NULL, nthreads, false);
+        }
+        seg = SegmentInserter::retain(seg, toRemove, false, nthreads);
+        if (seg->getNRows() == nrows) {
+            newblocks.push_back(*itr);
+            continue;
+        }
+        BOOST_LOG_TRIVIAL(debug) << "Removed " << (nrows - seg->getNRows())
+                                 << " rows from block " << itr->iteration;
+        removed = true;
+        if (!seg->isEmpty()) {
+            //EDB blocks become in-memory blocks here
+            std::shared_ptr<const FCInternalTable> newtable(
+                new InmemoryFCInternalTable(sizeRow, itr->iteration, true, seg));
+            newblocks.push_back(FCBlock(itr->iteration, newtable, itr->query,
+                                        itr->rule, itr->ruleExecOrder,
+                                        itr->isCompleted));
+            newblocks.back().firstIteration = itr->firstIteration;
+        }
+    }
+    if (removed) {
+        blocks.swap(newblocks);
+        sealedBlocks = 0;
+        //The filtered tables might contain removed rows
+        cache.clear();
+    }
+    return removed;
+}
+
 void FCTable::addBlock(FCBlock block) {
     assert(blocks.size() == 0 || blocks.back().iteration < block.iteration);
     blocks.push_back(block);
@@ -351,7 +411,40 @@ void FCTable::removeBlock(const size_t iteration) {
     assert(blocks.size() == 0 || blocks.back().iteration <= iteration);
     if (blocks.size() > 0 && blocks.back().iteration == iteration) {
         blocks.pop_back();
+        sealedBlocks = std::min(sealedBlocks, blocks.size());
+    }
+}
+
+std::vector<FCBlock> FCTable::makeSpillable(SpillManager *manager,
+        const size_t minRows) {
+    std::vector<FCBlock> out;
+    for (; sealedBlocks + 1 < blocks.size(); ++sealedBlocks) {
+        FCBlock &block = blocks[sealedBlocks];
+        if (block.table->isEDB() || block.table->getNRows() < minRows ||
+                dynamic_cast<const SpilledFCInternalTable*>(block.table.get())) {
+            continue;
+        }
+        block.table = std::shared_ptr<const FCInternalTable>(
+                          new SpilledFCInternalTable(manager, block.table,
+                                  block.iteration));
+        out.push_back(block);
+    }
+    return out;
+}
+
+size_t FCTable::getResidentMemory() {
+    size_t out = 0;
+    for (const auto &block : blocks) {
+        if (!block.table->isEDB() &&
+                !dynamic_cast<const SpilledFCInternalTable*>(block.table.get())) {
+            out += block.table->getNRows() * sizeRow * sizeof(Term_t);
+        }
     }
+    boost::mutex::scoped_lock lock(cache_mutex);
+    for (auto &el : cache) {
+        out += el.second.table->getResidentMemory();
+    }
+    return out;
 }
 
 size_t FCTable::getNRows(const size_t iteration) const {
@@ -414,3 +507,92 @@ void FCIterator::moveNextCount() {
 size_t FCIterator::getNTables() {
     return ntables;
 }
+
+std::vector<FCBlock> FCTable::getCompactionRun(const size_t maxIteration,
+        const size_t maxRows, const size_t minBlocks) const {
+    std::vector<FCBlock> run, bestRun;
+    //The last block is never compacted
+    for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+        const FCBlock &block = blocks[i];
+        if (block.iteration >= maxIteration) {
+            break;
+        }
+        //The spilled blocks would have to be read back from disk
+        const bool small = block.rule != NULL && !block.table->isEDB() &&
+                           block.table->getNRows() < maxRows &&
+                           !dynamic_cast<const SpilledFCInternalTable*>(
+                               block.table.get());
+        bool compatible = small;
+        if (compatible && !run.empty()) {
+            const FCBlock &prev = run.back();
+            compatible = prev.rule == block.rule &&
+                         prev.ruleExecOrder == block.ruleExecOrder &&
+                         prev.query == block.query;
+        }
+        if (!compatible) {
+            if (run.size() > bestRun.size()) {
+                bestRun.swap(run);
+            }
+            run.clear();
+            if (!small) {
+                continue;
+            }
+        }
+        run.push_back(block);
+    }
+    if (run.size() > bestRun.size()) {
+        bestRun.swap(run);
+    }
+    if (bestRun.size() < minBlocks) {
+        bestRun.clear();
+    }
+    return bestRun;
+}
+
+bool FCTable::replaceBlocks(
+    const std::vector<std::shared_ptr<const FCInternalTable>> &run,
+    std::shared_ptr<const FCInternalTable> merged) {
+    size_t start = 0;
+    while (start < blocks.size() && blocks[start].table != run[0]) {
+        start++;
+    }
+    if (start + run.size() > blocks.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < run.size(); ++i) {
+        if (blocks[start + i].table != run[i]) {
+            return false;
+        }
+    }
+
+    const FCBlock &first = blocks[start];
+    const FCBlock &last = blocks[start + run.size() - 1];
+    std::vector<FCBlock> newblocks;
+    for (size_t i = 0; i < start; ++i) {
+        newblocks.push_back(blocks[i]);
+    }
+    bool isCompleted = true;
+    for (size_t i = 0; i < run.size(); ++i) {
+        isCompleted = isCompleted && blocks[start + i].isCompleted;
+    }
+    newblocks.push_back(FCBlock(last.iteration, merged, last.query, last.rule,
+                                last.ruleExecOrder, isCompleted));
+    newblocks.back().firstIteration = first.firstIteration;
+    const size_t lastIteration = last.iteration;
+    for (size_t i = start + run.size(); i < blocks.size(); ++i) {
+        newblocks.push_back(blocks[i]);
+    }
+    blocks.swap(newblocks);
+    sealedBlocks = 0;
+
+    //The cached tables that do not cover the run would add the merged block
+    //on top of the blocks they already contain
+    for (FCCache::iterator itr = cache.begin(); itr != cache.end();) {
+        if (itr->second.end < lastIteration) {
+            itr = cache.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+    return true;
+}
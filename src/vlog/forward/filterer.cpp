@@ -76,6 +76,10 @@ bool TableFilterer::isEligibleForPartialSubs(
     if (block == NULL || block->rule == NULL) {
         return false;
     }
+    //A compacted block contains the output of several executions
+    if (block->firstIteration != block->iteration) {
+        return false;
+    }
 
     const Rule &rule = block->rule->rule;
     const std::vector<Literal> &bodyLiterals = rule.getBody();
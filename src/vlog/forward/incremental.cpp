@@ -0,0 +1,409 @@
+#include <vlog/seminaiver.h>
+#include <vlog/fctable.h>
+#include <vlog/fcinttable.h>
+#include <vlog/segment.h>
+#include <vlog/ruleexecdetails.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+/*
+ * Incremental maintenance of the materialization. Deletions are processed
+ * with Delete-and-Rederive:
+ * 1) overdelete: all facts with a derivation that uses a deleted fact;
+ * 2) remove the overdeleted facts from the tables;
+ * 3) rederive the overdeleted facts that still have a derivation.
+ * The rederived facts and the additions are then propagated with the normal
+ * semi-naive loop, since they are stored in blocks with a new iteration.
+ *
+ * The rules are evaluated on the deltas by copying them and replacing one
+ * body atom (or the head) with a temporary IDB predicate that contains the
+ * delta. The head is also replaced by a temporary predicate, so that the
+ * derivations are not filtered against the existing content. The temporary
+ * predicates take free ids from the end of the range and are never added
+ * to the program.
+ */
+
+static std::shared_ptr<const Segment> sortAndUnique(
+    std::shared_ptr<const Segment> seg) {
+    if (seg->getNRows() > 1) {
+        seg = seg->sortBy(NULL);
+        seg = SegmentInserter::unique(seg);
+    }
+    return seg;
+}
+
+static std::shared_ptr<const Segment> mergeRows(
+    std::shared_ptr<const Segment> seg1,
+    std::shared_ptr<const Segment> seg2) {
+    if (seg1 == NULL) {
+        return seg2;
+    }
+    std::vector<std::shared_ptr<const Segment>> segments;
+    segments.push_back(seg1);
+    segments.push_back(seg2);
+    return SegmentInserter::unique(SegmentInserter::merge(segments));
+}
+
+//Returns the rows in seg that do not appear in rows
+static std::shared_ptr<const Segment> minusRows(
+    std::shared_ptr<const Segment> seg,
+    std::shared_ptr<const Segment> rows,
+    const int nthreads) {
+    std::shared_ptr<const FCInternalTable> t(
+        new InmemoryFCInternalTable(rows->getNColumns(), 0, true, rows));
+    return SegmentInserter::retain(seg, t, false, nthreads);
+}
+
+//Returns the rows in seg that also appear in table. The EDB blocks are
+//probed row by row, so the EDB relations are never read in full
+static std::shared_ptr<const Segment> intersectRows(
+    std::shared_ptr<const Segment> seg,
+    FCTable *table,
+    const int nthreads) {
+    std::shared_ptr<const Segment> out;
+    FCIterator itr = table->read(0);
+    while (!itr.isEmpty() && !seg->isEmpty()) {
+        std::shared_ptr<const FCInternalTable> t = itr.getCurrentTable();
+        std::shared_ptr<const Segment> found;
+        if (t->isEDB()) {
+            found = ((const EDBFCInternalTable*) t.get())->getContained(seg);
+        } else {
+            std::shared_ptr<const Segment> missing = seg;
+            missing = SegmentInserter::retain(missing, t, false, nthreads);
+            found = minusRows(seg, missing, nthreads);
+        }
+        if (!found->isEmpty()) {
+            out = mergeRows(out, found);
+            seg = minusRows(seg, found, nthreads);
+        }
+        itr.moveNextCount();
+    }
+    if (out == NULL) {
+        return std::shared_ptr<const Segment>(new Segment(seg->getNColumns()));
+    }
+    return out;
+}
+
+static std::shared_ptr<const Segment> getAllRows(FCTable *table,
+        const int nthreads) {
+    std::shared_ptr<const Segment> out;
+    FCIterator itr = table->read(0);
+    while (!itr.isEmpty()) {
+        std::shared_ptr<const FCInternalTable> t = itr.getCurrentTable();
+        FCInternalTableItr *titr = t->getIterator();
+        std::vector<std::shared_ptr<Column>> columns = titr->getAllColumns();
+        t->releaseIterator(titr);
+        std::shared_ptr<const Segment> seg(new Segment(table->getSizeRow(),
+                                           columns));
+        out = mergeRows(out, sortAndUnique(seg));
+        itr.moveNextCount();
+    }
+    return out;
+}
+
+static std::vector<Literal> replaceLiteral(const std::vector<Literal> &body,
+        const int pos, const Literal &literal) {
+    std::vector<Literal> out;
+    for (int i = 0; i < body.size(); ++i) {
+        out.push_back(i == pos ? literal : body[i]);
+    }
+    return out;
+}
+
+Literal SemiNaiver::getGenericLiteral(const PredId_t pred) {
+    Predicate p = program->getPredicate(pred);
+    VTuple t(p.getCardinality());
+    for (uint8_t i = 0; i < t.getSize(); ++i) {
+        t.set(VTerm(i + 1, 0), i);
+    }
+    return Literal(p, t);
+}
+
+Predicate SemiNaiver::newTmpPredicate(const uint8_t card) {
+    for (PredId_t id = MAX_NPREDS - 1; id > 0; --id) {
+        if (predicatesTables[id] == NULL && !tmpPredicates.count(id) &&
+                program->getPredicateName(id) == "") {
+            tmpPredicates.insert(id);
+            return Predicate(id, 0, IDB, card);
+        }
+    }
+    BOOST_LOG_TRIVIAL(error) << "No free predicate for the incremental update";
+    throw OUT_OF_PREDICATES;
+}
+
+Literal SemiNaiver::setTmpTable(const Literal &literal,
+                                std::shared_ptr<const Segment> rows) {
+    Predicate pred = newTmpPredicate(literal.getPredicate().getCardinality());
+    Literal tmpLiteral(pred, literal.getTuple());
+    FCTable *table = getTable(pred.getId(), rows->getNColumns());
+    std::shared_ptr<const FCInternalTable> t(
+        new InmemoryFCInternalTable(rows->getNColumns(), 0, true, rows));
+    table->add(t, tmpLiteral, NULL, 0, 0, true, nthreads);
+    return tmpLiteral;
+}
+
+void SemiNaiver::removeTmpTable(const PredId_t pred) {
+    if (predicatesTables[pred] != NULL) {
+        delete predicatesTables[pred];
+        predicatesTables[pred] = NULL;
+    }
+    tmpPredicates.erase(pred);
+}
+
+std::shared_ptr<const Segment> SemiNaiver::evaluateTmpRule(
+    const Literal &head,
+    const std::vector<Literal> &body) {
+    Predicate outPred = newTmpPredicate(head.getPredicate().getCardinality());
+    const PredId_t outId = outPred.getId();
+    Literal tmpHead(outPred, head.getTuple());
+    RuleExecutionDetails details(Rule(tmpHead, body), (size_t) - 1);
+    for (const auto &literal : body) {
+        if (literal.getPredicate().getType() == IDB)
+            details.nIDBs++;
+    }
+    details.createExecutionPlans();
+    details.calculateNVarsInHeadFromEDB();
+    //lastExecution is 0, so the rule is evaluated on the entire tables
+    const size_t nderivations = listDerivations.size();
+    executeRule(details, iteration, NULL);
+    //Temporary tables should not appear in the list of derivations
+    while (listDerivations.size() > nderivations) {
+        listDerivations.pop_back();
+    }
+
+    std::shared_ptr<const Segment> out;
+    if (predicatesTables[outId] != NULL && !predicatesTables[outId]->isEmpty()) {
+        out = getAllRows(predicatesTables[outId], nthreads);
+    }
+    removeTmpTable(outId);
+    return out;
+}
+
+void SemiNaiver::addRows(FCTable *table, const Literal &literal,
+                         std::shared_ptr<const Segment> rows) {
+    std::shared_ptr<const FCInternalTable> t(
+        new InmemoryFCInternalTable(table->getSizeRow(), iteration, true,
+                                    rows));
+    table->add(t, literal, NULL, 0, iteration, true, nthreads);
+}
+
+void SemiNaiver::deleteAndRederive(const EDBUpdate &deletions) {
+    std::vector<const Rule*> rules;
+    for (const auto &details : ruleset)
+        rules.push_back(&details.rule);
+    for (const auto &details : edbRuleset)
+        rules.push_back(&details.rule);
+
+    EDBUpdate deleted;
+    EDBUpdate delta;
+    for (const auto &el : deletions) {
+        getTableFromEDBLayer(getGenericLiteral(el.first));
+        std::shared_ptr<const Segment> rows = intersectRows(
+                sortAndUnique(el.second), predicatesTables[el.first], nthreads);
+        if (!rows->isEmpty()) {
+            delta[el.first] = rows;
+        }
+    }
+
+    //1- Overdelete. The rules are evaluated on the old state
+    while (!delta.empty()) {
+        size_t count = 0;
+        for (const auto &el : delta) {
+            count += el.second->getNRows();
+            auto itr = deleted.find(el.first);
+            deleted[el.first] = mergeRows(itr == deleted.end() ?
+                                          std::shared_ptr<const Segment>() :
+                                          itr->second, el.second);
+        }
+        BOOST_LOG_TRIVIAL(debug) << "Overdeleting " << count << " facts";
+
+        EDBUpdate newDelta;
+        for (const auto rule : rules) {
+            const std::vector<Literal> &body = rule->getBody();
+            for (int i = 0; i < body.size(); ++i) {
+                auto d = delta.find(body[i].getPredicate().getId());
+                if (d == delta.end()) {
+                    continue;
+                }
+                std::vector<Literal> newBody = replaceLiteral(body, i,
+                                               setTmpTable(body[i], d->second));
+                std::shared_ptr<const Segment> derived =
+                    evaluateTmpRule(rule->getHead(), newBody);
+                removeTmpTable(newBody[i].getPredicate().getId());
+
+                PredId_t h = rule->getHead().getPredicate().getId();
+                if (derived == NULL || predicatesTables[h] == NULL) {
+                    continue;
+                }
+                derived = intersectRows(derived, predicatesTables[h], nthreads);
+                auto prev = deleted.find(h);
+                if (prev != deleted.end() && !derived->isEmpty()) {
+                    derived = minusRows(derived, prev->second, nthreads);
+                }
+                if (!derived->isEmpty()) {
+                    auto itr = newDelta.find(h);
+                    newDelta[h] = mergeRows(itr == newDelta.end() ?
+                                            std::shared_ptr<const Segment>() :
+                                            itr->second, derived);
+                }
+            }
+        }
+        delta.swap(newDelta);
+    }
+
+    //2- Remove the overdeleted facts
+    for (const auto &el : deleted) {
+        predicatesTables[el.first]->remove(el.second, nthreads);
+    }
+
+    //3- Rederive the facts that have an alternative derivation
+    for (const auto &el : deleted) {
+        if (program->getPredicate(el.first).getType() != IDB) {
+            continue;
+        }
+        for (const auto rule : rules) {
+            const Literal &head = rule->getHead();
+            if (head.getPredicate().getId() != el.first) {
+                continue;
+            }
+            std::vector<Literal> newBody = rule->getBody();
+            newBody.push_back(setTmpTable(head, el.second));
+            std::shared_ptr<const Segment> derived =
+                evaluateTmpRule(head, newBody);
+            removeTmpTable(newBody.back().getPredicate().getId());
+            if (derived != NULL) {
+                FCTable *table = predicatesTables[el.first];
+                derived = table->retainFrom(derived, false, nthreads);
+                if (!derived->isEmpty()) {
+                    BOOST_LOG_TRIVIAL(debug) << "Rederived " <<
+                                             derived->getNRows() << " facts";
+                    addRows(table, head, derived);
+                }
+            }
+        }
+    }
+    iteration++;
+}
+
+void SemiNaiver::propagateAdditions(const EDBUpdate &additions) {
+    EDBUpdate delta;
+    for (const auto &el : additions) {
+        Literal literal = getGenericLiteral(el.first);
+        getTableFromEDBLayer(literal);
+        FCTable *table = predicatesTables[el.first];
+        std::shared_ptr<const Segment> rows = sortAndUnique(el.second);
+        rows = minusRows(rows, intersectRows(rows, table, nthreads),
+                         nthreads);
+        if (!rows->isEmpty()) {
+            addRows(table, literal, rows);
+            delta[el.first] = rows;
+        }
+    }
+    iteration++;
+
+    //Evaluate the rules with one body atom restricted to the new facts.
+    //The other atoms read the new state, which can only cause duplicates.
+    std::vector<const Rule*> rules;
+    for (const auto &details : ruleset)
+        rules.push_back(&details.rule);
+    for (const auto &details : edbRuleset)
+        rules.push_back(&details.rule);
+    for (const auto rule : rules) {
+        const std::vector<Literal> &body = rule->getBody();
+        for (int i = 0; i < body.size(); ++i) {
+            auto d = delta.find(body[i].getPredicate().getId());
+            if (d == delta.end()) {
+                continue;
+            }
+            std::vector<Literal> newBody = replaceLiteral(body, i,
+                                           setTmpTable(body[i], d->second));
+            std::shared_ptr<const Segment> derived =
+                evaluateTmpRule(rule->getHead(), newBody);
+            removeTmpTable(newBody[i].getPredicate().getId());
+            if (derived != NULL) {
+                const Literal &head = rule->getHead();
+                FCTable *table = getTable(head.getPredicate().getId(),
+                                          head.getPredicate().getCardinality());
+                derived = table->retainFrom(derived, false, nthreads);
+                if (!derived->isEmpty()) {
+                    addRows(table, head, derived);
+                }
+            }
+        }
+    }
+    iteration++;
+}
+
+void SemiNaiver::updateEDB(const EDBUpdate &additions,
+                           const EDBUpdate &deletions) {
+    running = true;
+    startTime = boost::chrono::system_clock::now();
+    BOOST_LOG_TRIVIAL(info) << "Incremental update: " << additions.size() <<
+                            " predicates with additions, " << deletions.size() <<
+                            " predicates with deletions";
+    if (!deletions.empty()) {
+        deleteAndRederive(deletions);
+    }
+    if (!additions.empty()) {
+        propagateAdditions(additions);
+    }
+
+    //Propagate the new and rederived facts
+    std::vector<StatIteration> costRules;
+    if (ruleset.size() > 0) {
+        executeUntilSaturation(costRules);
+    }
+    running = false;
+    boost::chrono::duration<double> sec = boost::chrono::system_clock::now() -
+                                          startTime;
+    BOOST_LOG_TRIVIAL(info) << "Finished incremental update. Iterations=" <<
+                            iteration << ", runtime " << sec.count() * 1000 << "ms";
+}
+
+void SemiNaiver::readUpdate(std::string pathFile, Program *program,
+                            EDBUpdate &additions, EDBUpdate &deletions) {
+    std::ifstream file(pathFile);
+    if (!file.good()) {
+        BOOST_LOG_TRIVIAL(error) << "Cannot read the update " << pathFile;
+        throw 10;
+    }
+    std::map<PredId_t, std::unique_ptr<SegmentInserter>> added, removed;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.size() == 0 || line[0] == '#') {
+            continue;
+        }
+        if (line.size() < 3 || (line[0] != '+' && line[0] != '-') ||
+                line[1] != ' ') {
+            BOOST_LOG_TRIVIAL(error) << "Wrong line in the update: " << line;
+            throw 10;
+        }
+        Literal l = program->parseLiteral(line.substr(2));
+        if (l.getPredicate().getType() != EDB || l.getNVars() > 0) {
+            BOOST_LOG_TRIVIAL(error) << "The update contains only EDB facts: "
+                                     << line;
+            throw 10;
+        }
+        auto &rows = line[0] == '+' ? added : removed;
+        std::unique_ptr<SegmentInserter> &ins = rows[l.getPredicate().getId()];
+        if (ins == NULL) {
+            ins = std::unique_ptr<SegmentInserter>(
+                      new SegmentInserter(l.getTupleSize()));
+        }
+        Term_t row[SIZETUPLE];
+        for (uint8_t i = 0; i < l.getTupleSize(); ++i) {
+            row[i] = l.getTermAtPos(i).getValue();
+        }
+        ins->addRow(row);
+    }
+    for (auto &el : added) {
+        additions[el.first] = el.second->getSortedAndUniqueSegment();
+    }
+    for (auto &el : removed) {
+        deletions[el.first] = el.second->getSortedAndUniqueSegment();
+    }
+}
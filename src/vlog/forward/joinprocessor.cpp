@@ -6,6 +6,7 @@
 
 #include <google/dense_hash_map>
 #include <limits.h>
+#include <cmath>
 #include <vector>
 #include <inttypes.h>
 
@@ -657,40 +658,174 @@ void JoinExecutor::join(SemiNaiver * naiver, const FCInternalTable * t1,
                         const int currentLiteral,
                         const int nthreads) {
 
-    //First I calculate whether the join is verificative or explorative.
-    if (JoinExecutor::isJoinVerificative(t1, plan, currentLiteral)) {
+    switch (chooseAlgorithm(naiver, t1, plan, currentLiteral, joinsCoordinates)) {
+    case VERIFICATIVEJOIN:
         BOOST_LOG_TRIVIAL(debug) << "Executing verificativeJoin. t1->getNRows()=" << t1->getNRows();
         verificativeJoin(naiver, t1, literal, min, max, output, plan,
                          currentLiteral, nthreads);
-    } else if (JoinExecutor::isJoinTwoToOneJoin(plan, currentLiteral)) {
+        break;
+    case TWOTOONEJOIN:
         //Is the join of the like (A),(A,B)=>(A|B). Then we can speed up the merge join
         BOOST_LOG_TRIVIAL(debug) << "Executing joinTwoToOne";
         joinTwoToOne(naiver, t1, literal, min, max, output, plan,
                      currentLiteral, nthreads);
-    } else {
-        //This code is to execute more generic joins. We do hash join if
-        //keys are few and there is no ordering. Otherwise, merge join.
-        if (t1->estimateNRows() <= THRESHOLD_HASHJOIN
-                && joinsCoordinates.size() < 3
-                && (joinsCoordinates.size() > 1 ||
-                    joinsCoordinates[0].first != joinsCoordinates[0].second ||
-                    joinsCoordinates[0].first != 0)) {
-            BOOST_LOG_TRIVIAL(debug) << "Executing hashjoin. t1->getNRows()=" << t1->getNRows();
-            hashjoin(t1, naiver, outputLiteral, literal, min, max, filterValueVars,
-                     joinsCoordinates, output,
-                     lastLiteral, ruleDetails, plan, processedTables, nthreads);
+        break;
+    case INDEXJOIN:
+        BOOST_LOG_TRIVIAL(debug) << "Executing indexjoin. t1->getNRows()=" << t1->getNRows();
+        indexjoin(t1, naiver, literal, joinsCoordinates, output);
+        break;
+    case HASHJOIN:
+        BOOST_LOG_TRIVIAL(debug) << "Executing hashjoin. t1->getNRows()=" << t1->getNRows();
+        hashjoin(t1, naiver, outputLiteral, literal, min, max, filterValueVars,
+                 joinsCoordinates, output,
+                 lastLiteral, ruleDetails, plan, processedTables, nthreads);
 #ifdef DEBUG
-            output->checkSizes();
+        output->checkSizes();
 #endif
-        } else {
-            BOOST_LOG_TRIVIAL(debug) << "Executing mergejoin. t1->getNRows()=" << t1->getNRows();
-            mergejoin(t1, naiver, outputLiteral, literal, min, max,
-                      joinsCoordinates, output, nthreads);
+        break;
+    case MERGEJOIN:
+        BOOST_LOG_TRIVIAL(debug) << "Executing mergejoin. t1->getNRows()=" << t1->getNRows();
+        mergejoin(t1, naiver, outputLiteral, literal, min, max,
+                  joinsCoordinates, output, nthreads);
 #ifdef DEBUG
-            output->checkSizes();
+        output->checkSizes();
 #endif
+        break;
+    }
+}
+
+JoinAlgorithm JoinExecutor::chooseAlgorithm(SemiNaiver *naiver,
+        const FCInternalTable *t1,
+        const RuleExecutionPlan &plan, const int currentLiteral,
+        const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates) {
+    //First I calculate whether the join is verificative or explorative.
+    if (JoinExecutor::isJoinVerificative(t1, plan, currentLiteral)) {
+        return VERIFICATIVEJOIN;
+    } else if (JoinExecutor::isJoinTwoToOneJoin(plan, currentLiteral)) {
+        return TWOTOONEJOIN;
+    } else if (JoinExecutor::isJoinIndexable(naiver, t1,
+               *plan.plan[currentLiteral], joinsCoordinates)) {
+        return INDEXJOIN;
+    } else if (t1->estimateNRows() <= THRESHOLD_HASHJOIN
+               && joinsCoordinates.size() < 3
+               && (joinsCoordinates.size() > 1 ||
+                   joinsCoordinates[0].first != joinsCoordinates[0].second ||
+                   joinsCoordinates[0].first != 0)) {
+        //This code is to execute more generic joins. We do hash join if
+        //keys are few and there is no ordering. Otherwise, merge join.
+        return HASHJOIN;
+    } else {
+        return MERGEJOIN;
+    }
+}
+
+const char *JoinExecutor::getAlgorithmName(const JoinAlgorithm algo) {
+    switch (algo) {
+    case VERIFICATIVEJOIN:
+        return "verificative";
+    case TWOTOONEJOIN:
+        return "twotoone";
+    case INDEXJOIN:
+        return "indexjoin";
+    case HASHJOIN:
+        return "hashjoin";
+    default:
+        return "mergejoin";
+    }
+}
+
+bool JoinExecutor::isJoinIndexable(SemiNaiver * naiver,
+                                   const FCInternalTable * t1,
+                                   const Literal & literal,
+                                   const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates) {
+    if (literal.getPredicate().getType() != EDB || joinsCoordinates.empty()
+            || literal.hasRepeatedVars()) {
+        return false;
+    }
+    //The lookups go to the EDB layer, which does not see the rows added
+    //or removed by an incremental update
+    if (!naiver->isEDBTableUnchanged(literal.getPredicate().getId())) {
+        return false;
+    }
+    //The number of rows is an upper bound of the number of keys
+    const size_t nkeys = t1->estimateNRows();
+    const size_t card = naiver->getEDBLayer().estimateCardinality(literal);
+    return (double) nkeys * (std::log2((double) card + 1) + 1) *
+           INDEXJOIN_RATIO < card;
+}
+
+void JoinExecutor::indexjoin(const FCInternalTable * t1, SemiNaiver * naiver,
+                             const Literal & literal,
+                             const std::vector<std::pair<uint8_t, uint8_t>> &joinsCoordinates,
+                             ResultJoinProcessor * output) {
+    EDBLayer &layer = naiver->getEDBLayer();
+    const uint8_t rowSize = t1->getRowSize();
+    const std::vector<uint8_t> posVars = literal.getPosVars();
+
+    //Positions in the EDB rows of the variables to copy
+    const uint8_t nPosFromFirst = output->getNCopyFromFirst();
+    const std::pair<uint8_t, uint8_t> *posFromFirst = output->getPosFromFirst();
+    const uint8_t nPosFromSecond = output->getNCopyFromSecond();
+    const std::pair<uint8_t, uint8_t> *posFromSecond = output->getPosFromSecond();
+    std::vector<uint8_t> posInEDB;
+    for (uint8_t i = 0; i < nPosFromSecond; ++i) {
+        posInEDB.push_back(posVars[posFromSecond[i].second]);
+    }
+
+    std::vector<uint8_t> fields;
+    for (const auto &c : joinsCoordinates) {
+        fields.push_back(c.first);
+    }
+    FCInternalTableItr *itr = t1->sortBy(fields);
+
+    //Rows of t1 with the current key
+    std::vector<Term_t> group;
+    Term_t *row = output->getRawRow();
+    size_t nlookups = 0;
+    auto lookup = [&]() {
+        VTuple t = literal.getTuple();
+        for (uint8_t j = 0; j < joinsCoordinates.size(); ++j) {
+            t.set(VTerm(0, group[joinsCoordinates[j].first]),
+                  posVars[joinsCoordinates[j].second]);
+        }
+        Literal boundLiteral(literal.getPredicate(), t);
+        EDBIterator *edbItr = layer.getIterator(boundLiteral);
+        while (edbItr->hasNext()) {
+            edbItr->next();
+            for (uint8_t i = 0; i < nPosFromSecond; ++i) {
+                row[posFromSecond[i].first] = edbItr->getElementAt(posInEDB[i]);
+            }
+            for (size_t start = 0; start < group.size(); start += rowSize) {
+                for (uint8_t i = 0; i < nPosFromFirst; ++i) {
+                    row[posFromFirst[i].first] =
+                        group[start + posFromFirst[i].second];
+                }
+                output->processResults(0, false);
+            }
+        }
+        layer.releaseIterator(edbItr);
+        nlookups++;
+    };
+
+    while (itr->hasNext()) {
+        itr->next();
+        bool sameKey = !group.empty();
+        for (uint8_t j = 0; j < fields.size() && sameKey; ++j) {
+            sameKey = group[fields[j]] == itr->getCurrentValue(fields[j]);
         }
+        if (!sameKey && !group.empty()) {
+            lookup();
+            group.clear();
+        }
+        for (uint8_t j = 0; j < rowSize; ++j) {
+            group.push_back(itr->getCurrentValue(j));
+        }
+    }
+    if (!group.empty()) {
+        lookup();
     }
+    t1->releaseIterator(itr);
+    BOOST_LOG_TRIVIAL(debug) << "Indexjoin: " << nlookups << " lookups";
 }
 
 bool JoinExecutor::isJoinSelective(JoinHashMap & map, const Literal & literal,
@@ -0,0 +1,166 @@
+#include <vlog/profiler.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+Profiler::Profiler() : startTime(boost::chrono::system_clock::now()) {
+}
+
+std::string Profiler::escape(const std::string &s) {
+    std::string out;
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if ((unsigned char) c >= 0x20) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+//Executions whose rule is not in ruleNames (e.g. rules without an id) are
+//grouped in one bucket after the known rules, reported with id -1
+static size_t getBucket(const size_t ruleid,
+                        const std::vector<std::string> &ruleNames) {
+    return ruleid < ruleNames.size() ? ruleid : ruleNames.size();
+}
+
+static long getBucketId(const size_t bucket,
+                        const std::vector<std::string> &ruleNames) {
+    return bucket < ruleNames.size() ? (long) bucket : -1;
+}
+
+static std::string getBucketName(const size_t bucket,
+                                 const std::vector<std::string> &ruleNames) {
+    return bucket < ruleNames.size() ? ruleNames[bucket] : "unknown rule";
+}
+
+void Profiler::addOperator(ProfiledRule &rule, const char *name,
+                           const char *algorithm, const int literal,
+                           const double start, const double end,
+                           const size_t rowsIn, const size_t rowsOut) {
+    ProfiledOperator op;
+    op.name = name;
+    op.algorithm = algorithm;
+    op.literal = literal;
+    op.start = start;
+    op.duration = end - start;
+    op.rowsIn = rowsIn;
+    op.rowsOut = rowsOut;
+    rule.operators.push_back(op);
+}
+
+void Profiler::add(ProfiledRule &rule) {
+    boost::mutex::scoped_lock lock(mutex);
+    boost::thread::id id = boost::this_thread::get_id();
+    if (!threads.count(id)) {
+        const int n = (int) threads.size();
+        threads[id] = n;
+    }
+    rule.thread = threads[id];
+    rules.push_back(rule);
+}
+
+void Profiler::writeJSON(std::string path,
+                         const std::vector<std::string> &ruleNames) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::ofstream out(path);
+    out << std::fixed << std::setprecision(1);
+
+    //Aggregate per rule
+    const size_t nbuckets = ruleNames.size() + 1;
+    std::vector<size_t> nexecs(nbuckets);
+    std::vector<size_t> nproductive(nbuckets);
+    std::vector<double> time(nbuckets);
+    std::vector<size_t> derived(nbuckets);
+    long peakMemMB = 0;
+    for (const auto &r : rules) {
+        const size_t b = getBucket(r.ruleid, ruleNames);
+        nexecs[b]++;
+        if (r.derived > 0)
+            nproductive[b]++;
+        time[b] += r.duration;
+        derived[b] += r.derived;
+        peakMemMB = std::max(peakMemMB, r.peakMemMB);
+    }
+
+    out << "{\n\"peak_mem_mb\": " << peakMemMB << ",\n\"rules\": [";
+    bool first = true;
+    for (size_t i = 0; i < nbuckets; ++i) {
+        if (nexecs[i] == 0)
+            continue;
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"id\": " << getBucketId(i, ruleNames) << ", \"rule\": \""
+            << escape(getBucketName(i, ruleNames))
+            << "\", \"executions\": " << nexecs[i] << ", \"productive\": "
+            << nproductive[i] << ", \"time_ms\": " << time[i] / 1000
+            << ", \"derived\": " << derived[i] << "}";
+    }
+
+    out << "],\n\"executions\": [";
+    first = true;
+    for (const auto &r : rules) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"rule\": " << getBucketId(getBucket(r.ruleid, ruleNames),
+                                           ruleNames)
+            << ", \"iteration\": " << r.iteration
+            << ", \"thread\": " << r.thread << ", \"start_us\": " << r.start
+            << ", \"time_us\": " << r.duration << ", \"derived\": "
+            << r.derived << ", \"peak_mem_mb\": " << r.peakMemMB
+            << ", \"operators\": [";
+        for (size_t j = 0; j < r.operators.size(); ++j) {
+            const ProfiledOperator &op = r.operators[j];
+            if (j > 0)
+                out << ", ";
+            out << "{\"op\": \"" << op.name << "\", \"literal\": "
+                << op.literal << ", \"time_us\": " << op.duration
+                << ", \"rows_in\": " << op.rowsIn << ", \"rows_out\": "
+                << op.rowsOut;
+            if (op.algorithm != NULL)
+                out << ", \"algorithm\": \"" << op.algorithm << "\"";
+            out << "}";
+        }
+        out << "]}";
+    }
+    out << "]\n}\n";
+    BOOST_LOG_TRIVIAL(info) << "Profile of " << rules.size() <<
+                            " rule executions written to " << path;
+}
+
+void Profiler::writeChromeTrace(std::string path,
+                                const std::vector<std::string> &ruleNames) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::ofstream out(path);
+    out << std::fixed << std::setprecision(1);
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (const auto &r : rules) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\": \"" << escape(getBucketName(getBucket(r.ruleid, ruleNames),
+                                             ruleNames))
+            << "\", \"cat\": \"rule\", \"ph\": \"X\", \"ts\": " << r.start
+            << ", \"dur\": " << r.duration << ", \"pid\": 0, \"tid\": "
+            << r.thread << ", \"args\": {\"iteration\": " << r.iteration
+            << ", \"derived\": " << r.derived << "}}";
+        for (const auto &op : r.operators) {
+            out << ",\n{\"name\": \"" << op.name;
+            if (op.algorithm != NULL)
+                out << " (" << op.algorithm << ")";
+            out << "\", \"cat\": \"operator\", \"ph\": \"X\", \"ts\": "
+                << op.start << ", \"dur\": " << op.duration
+                << ", \"pid\": 0, \"tid\": " << r.thread
+                << ", \"args\": {\"literal\": " << op.literal
+                << ", \"rows_in\": " << op.rowsIn << ", \"rows_out\": "
+                << op.rowsOut << "}}";
+        }
+    }
+    out << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+}
@@ -6,6 +6,7 @@
 #include <vlog/filterer.h>
 #include <trident/model/table.h>
 #include <kognac/consts.h>
+#include <kognac/utils.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/log/trivial.hpp>
@@ -16,6 +17,7 @@
 #include <memory>
 #include <sstream>
 #include <unordered_set>
+#include <limits>
 
 void SemiNaiver::createGraphRuleDependency(std::vector<int> &nodes,
         std::vector<std::pair<int, int>> &edges) {
@@ -81,6 +83,10 @@ SemiNaiver::SemiNaiver(std::vector<Rule> ruleset, EDBLayer &layer,
     opt_filtering(opt_filtering),
     multithreaded(multithreaded),
     running(false),
+    costAwareOrder(false),
+    checkpointInterval(0),
+    resumed(false),
+    totalResidentMemory(0),
     layer(layer),
     program(program),
     nthreads(nthreads) {
@@ -97,8 +103,15 @@ SemiNaiver::SemiNaiver(std::vector<Rule> ruleset, EDBLayer &layer,
         std::vector<Literal> bodyLiterals = itr->getBody();
         for (std::vector<Literal>::iterator itr = bodyLiterals.begin();
                 itr != bodyLiterals.end(); ++itr) {
-            if (itr->getPredicate().getType() == IDB)
+            if (itr->getPredicate().getType() == IDB) {
                 d->nIDBs++;
+                const PredId_t id = itr->getPredicate().getId();
+                if (std::find(d->idbBodyPredicates.begin(),
+                              d->idbBodyPredicates.end(), id) ==
+                        d->idbBodyPredicates.end()) {
+                    d->idbBodyPredicates.push_back(id);
+                }
+            }
         }
         if (d->nIDBs != 0)
             this->ruleset.push_back(*d);
@@ -216,7 +229,11 @@ void SemiNaiver::run(size_t lastExecution, size_t it) {
         BOOST_LOG_TRIVIAL(debug) << "Optimizing rule " << itr->rule.tostring(NULL, NULL);
         itr->createExecutionPlans();
         itr->calculateNVarsInHeadFromEDB();
-        itr->lastExecution = lastExecution;
+        if (resumed) {
+            itr->lastExecution = resumedLastExecutions[itr->ruleid];
+        } else {
+            itr->lastExecution = lastExecution;
+        }
 
         for (int i = 0; i < itr->orderExecutions.size(); ++i) {
             string plan = "";
@@ -236,7 +253,8 @@ void SemiNaiver::run(size_t lastExecution, size_t it) {
 
     start = boost::chrono::system_clock::now();
 #endif
-    for (int i = 0; i < edbRuleset.size(); ++i) {
+    //The EDB rules were already executed before the checkpoint
+    for (int i = 0; i < edbRuleset.size() && !resumed; ++i) {
         executeRule(edbRuleset[i], iteration, NULL);
         iteration++;
     }
@@ -250,10 +268,12 @@ void SemiNaiver::run(size_t lastExecution, size_t it) {
     //Used for statistics
     std::vector<StatIteration> costRules;
 
+    lastCheckpoint = boost::chrono::system_clock::now();
     if (ruleset.size() > 0) {
         executeUntilSaturation(costRules);
     }
     running = false;
+    resumed = false;
     BOOST_LOG_TRIVIAL(info) << "Finished process. Iterations=" << iteration;
 
     //DEBUGGING CODE -- needed to see which rules cost the most
@@ -284,49 +304,85 @@ void SemiNaiver::executeUntilSaturation(std::vector<StatIteration> &costRules) {
     size_t nRulesOnePass = 0;
     size_t lastIteration = 0;
 
+    size_t skippedRules = 0;
+
+    //Position in ruleset of the rules in the order of execution
+    std::vector<size_t> ruleOrder;
+    for (size_t i = 0; i < ruleset.size(); ++i) {
+        ruleOrder.push_back(i);
+    }
+    std::vector<int> sccs;
+    if (costAwareOrder) {
+        computeRuleSCCs(sccs);
+    }
+    bool firstPass = true;
+
     boost::chrono::system_clock::time_point round_start = timens::system_clock::now();
     do {
+        if (currentRule == 0 && !firstPass && costAwareOrder &&
+                reorderRulesByCost(sccs, ruleOrder)) {
+            //The rules that were already counted might have moved
+            rulesWithoutDerivation = 0;
+        }
+        firstPass = false;
+
+        //Skip the rule if none of its inputs changed since its last execution
+        if (!isRuleActive(ruleset[ruleOrder[currentRule]])) {
+            skippedRules++;
+            rulesWithoutDerivation++;
+            currentRule = (currentRule + 1) % ruleset.size();
+            continue;
+        }
+
         //BOOST_LOG_TRIVIAL(info) << "Iteration " << iteration;
         boost::chrono::system_clock::time_point start = timens::system_clock::now();
-        bool response = executeRule(ruleset[currentRule],
+        bool response = executeRule(ruleset[ruleOrder[currentRule]],
                                     iteration,
                                     NULL);
         boost::chrono::duration<double> sec = boost::chrono::system_clock::now() - start;
         StatIteration stat;
         stat.iteration = iteration;
-        stat.rule = &ruleset[currentRule].rule;
+        stat.rule = &ruleset[ruleOrder[currentRule]].rule;
         stat.time = sec.count() * 1000;
         stat.derived = response;
         costRules.push_back(stat);
-        ruleset[currentRule].lastExecution = iteration++;
+        updateRuleCost(ruleOrder[currentRule], stat);
+        ruleset[ruleOrder[currentRule]].lastExecution = iteration++;
+        spillIfNeeded(ruleset[ruleOrder[currentRule]].rule);
+        compactIfNeeded(ruleset[ruleOrder[currentRule]].rule.getHead().getPredicate().getId());
+        checkpointIfNeeded();
 
         if (response) {
-            if (ruleset[currentRule].rule.isRecursive()) {
+            if (ruleset[ruleOrder[currentRule]].rule.isRecursive()) {
                 //Is the rule recursive? Go until saturation...
                 int recursiveIterations = 0;
                 do {
                     // BOOST_LOG_TRIVIAL(info) << "Iteration " << iteration;
                     start = timens::system_clock::now();
                     recursiveIterations++;
-                    response = executeRule(ruleset[currentRule],
+                    response = executeRule(ruleset[ruleOrder[currentRule]],
                                            iteration,
                                            NULL);
                     stat.iteration = iteration;
-                    ruleset[currentRule].lastExecution = iteration++;
+                    ruleset[ruleOrder[currentRule]].lastExecution = iteration++;
                     sec = boost::chrono::system_clock::now() - start;
                     ++recursiveIterations;
-                    stat.rule = &ruleset[currentRule].rule;
+                    stat.rule = &ruleset[ruleOrder[currentRule]].rule;
                     stat.time = sec.count() * 1000;
                     stat.derived = response;
                     costRules.push_back(stat);
+                    updateRuleCost(ruleOrder[currentRule], stat);
+                    spillIfNeeded(ruleset[ruleOrder[currentRule]].rule);
+                    compactIfNeeded(ruleset[ruleOrder[currentRule]].rule.getHead().getPredicate().getId());
+                    checkpointIfNeeded();
                     /*if (++recursiveIterations % 10 == 0) {
                         BOOST_LOG_TRIVIAL(info) << "Saturating rule " <<
-                                                ruleset[currentRule].rule.tostring(program, dict) <<
+                                                ruleset[ruleOrder[currentRule]].rule.tostring(program, dict) <<
                                                 " " << recursiveIterations;
                     }*/
                 } while (response);
                 BOOST_LOG_TRIVIAL(debug) << "Rules " <<
-                                         ruleset[currentRule].rule.tostring(program, &layer) <<
+                                         ruleset[ruleOrder[currentRule]].rule.tostring(program, &layer) <<
                                          "  required " << recursiveIterations << " to saturate";
             }
 
@@ -369,13 +425,164 @@ void SemiNaiver::executeUntilSaturation(std::vector<StatIteration> &costRules) {
 #endif
         }
     } while (rulesWithoutDerivation != ruleset.size());
+    BOOST_LOG_TRIVIAL(debug) << "Rule executions skipped because their input did not change: " << skippedRules;
+}
+
+void SemiNaiver::setCostAwareOrder(const bool enabled) {
+    costAwareOrder = enabled;
+}
+
+void SemiNaiver::updateRuleCost(const size_t ruleIdx, const StatIteration &stat) {
+    if (!costAwareOrder) {
+        return;
+    }
+    if (ruleCosts.size() < ruleset.size()) {
+        ruleCosts.resize(ruleset.size());
+    }
+    RuleCost &cost = ruleCosts[ruleIdx];
+    cost.executions++;
+    cost.timems += stat.time;
+    if (stat.derived) {
+        cost.productive++;
+        cost.derived += getNLastDerivationsFromList();
+    }
+}
+
+double SemiNaiver::getRuleScore(const size_t ruleIdx) const {
+    if (ruleIdx >= ruleCosts.size() || ruleCosts[ruleIdx].executions == 0) {
+        //Rules never executed keep the precedence
+        return std::numeric_limits<double>::max();
+    }
+    const RuleCost &cost = ruleCosts[ruleIdx];
+    if (cost.productive == 0) {
+        //Only duplicates so far
+        return 0;
+    }
+    //New facts per ms, weighted by the fraction of productive executions
+    const double yield = (double) cost.productive / cost.executions;
+    return yield * (cost.derived + 1) / (cost.timems + 1);
+}
+
+static void tarjanSCC(const PredId_t pred,
+                      std::unordered_map<PredId_t, std::vector<PredId_t>> &edges,
+                      std::unordered_map<PredId_t, int> &index,
+                      std::unordered_map<PredId_t, int> &lowlink,
+                      std::vector<PredId_t> &stack,
+                      std::unordered_set<PredId_t> &onStack,
+                      std::unordered_map<PredId_t, int> &sccs,
+                      int &counter, int &nsccs) {
+    index[pred] = lowlink[pred] = counter++;
+    stack.push_back(pred);
+    onStack.insert(pred);
+    for (const auto next : edges[pred]) {
+        if (!index.count(next)) {
+            tarjanSCC(next, edges, index, lowlink, stack, onStack, sccs,
+                      counter, nsccs);
+            lowlink[pred] = std::min(lowlink[pred], lowlink[next]);
+        } else if (onStack.count(next)) {
+            lowlink[pred] = std::min(lowlink[pred], index[next]);
+        }
+    }
+    if (lowlink[pred] == index[pred]) {
+        PredId_t p;
+        do {
+            p = stack.back();
+            stack.pop_back();
+            onStack.erase(p);
+            sccs[p] = nsccs;
+        } while (p != pred);
+        nsccs++;
+    }
+}
+
+void SemiNaiver::computeRuleSCCs(std::vector<int> &sccs) {
+    //Dependency graph between the IDB predicates
+    std::unordered_map<PredId_t, std::vector<PredId_t>> edges;
+    for (const auto &details : ruleset) {
+        const PredId_t head = details.rule.getHead().getPredicate().getId();
+        edges[head];
+        for (const auto pred : details.idbBodyPredicates) {
+            edges[pred].push_back(head);
+        }
+    }
+    std::unordered_map<PredId_t, int> index, lowlink, predSCCs;
+    std::vector<PredId_t> stack;
+    std::unordered_set<PredId_t> onStack;
+    int counter = 0;
+    int nsccs = 0;
+    for (const auto &el : edges) {
+        if (!index.count(el.first)) {
+            tarjanSCC(el.first, edges, index, lowlink, stack, onStack,
+                      predSCCs, counter, nsccs);
+        }
+    }
+    sccs.clear();
+    for (const auto &details : ruleset) {
+        sccs.push_back(predSCCs[details.rule.getHead().getPredicate().getId()]);
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Rules are divided in " << nsccs << " SCCs";
+}
+
+struct RuleScoreComparator {
+    const std::vector<double> &scores;
+
+    RuleScoreComparator(const std::vector<double> &scores) : scores(scores) {}
+
+    bool operator()(const size_t r1, const size_t r2) const {
+        return scores[r1] > scores[r2];
+    }
+};
+
+bool SemiNaiver::reorderRulesByCost(const std::vector<int> &sccs,
+                                    std::vector<size_t> &ruleOrder) {
+    std::vector<double> scores;
+    for (size_t i = 0; i < ruleset.size(); ++i) {
+        scores.push_back(getRuleScore(i));
+    }
+
+    //The rules of an SCC are reordered among the positions that the SCC
+    //already occupies, so that the order between different SCCs is kept
+    std::map<int, std::vector<size_t>> positions;
+    for (size_t i = 0; i < ruleOrder.size(); ++i) {
+        positions[sccs[ruleOrder[i]]].push_back(i);
+    }
+    bool changed = false;
+    for (const auto &el : positions) {
+        std::vector<size_t> rules;
+        for (const auto pos : el.second) {
+            rules.push_back(ruleOrder[pos]);
+        }
+        std::stable_sort(rules.begin(), rules.end(),
+                         RuleScoreComparator(scores));
+        for (size_t i = 0; i < rules.size(); ++i) {
+            if (ruleOrder[el.second[i]] != rules[i]) {
+                ruleOrder[el.second[i]] = rules[i];
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+bool SemiNaiver::isRuleActive(const RuleExecutionDetails &ruleDetails) const {
+    if (ruleDetails.lastExecution == 0) {
+        //The rule was never executed
+        return true;
+    }
+    for (const auto pred : ruleDetails.idbBodyPredicates) {
+        const FCTable *table = predicatesTables[pred];
+        if (table != NULL && !table->isEmpty() &&
+                table->getMaxIteration() >= ruleDetails.lastExecution) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void SemiNaiver::storeOnFiles(std::string path, const bool decompress,
                               const int minLevel) {
     //Create a directory if necessary
     boost::filesystem::create_directories(boost::filesystem::path(path));
-    char buffer[MAX_TERM_SIZE];
 
     //I create a new file for every idb predicate
     for (PredId_t i = 0; i < MAX_NPREDS; ++i) {
@@ -385,28 +592,48 @@ void SemiNaiver::storeOnFiles(std::string path, const bool decompress,
             if (!itr.isEmpty()) {
                 std::ofstream streamout(path + "/" + program->getPredicateName(i));
                 const uint8_t sizeRow = table->getSizeRow();
+                //Rows are buffered to resolve their terms at once
+                std::vector<size_t> iterations;
+                std::vector<uint64_t> values;
+                std::vector<std::string> texts;
+                std::vector<bool> found;
                 while (!itr.isEmpty()) {
                     std::shared_ptr<const FCInternalTable> t = itr.getCurrentTable();
                     FCInternalTableItr *iitr = t->getIterator();
-                    while (iitr->hasNext()) {
+                    bool more = iitr->hasNext();
+                    while (more) {
                         iitr->next();
-                        std::string row = to_string(iitr->getCurrentIteration()) + "\t";
+                        iterations.push_back(iitr->getCurrentIteration());
                         for (uint8_t m = 0; m < sizeRow; ++m) {
-                            if (decompress) {
-                                if (layer.getDictText(iitr->getCurrentValue(m), buffer)) {
-                                    row += string(buffer) + "\t";
+                            values.push_back(iitr->getCurrentValue(m));
+                        }
+                        more = iitr->hasNext();
+                        if (iterations.size() < EXPORT_DICT_BATCH && more) {
+                            continue;
+                        }
+                        if (decompress) {
+                            layer.getDictTexts(values, texts, found);
+                        }
+                        for (size_t r = 0; r < iterations.size(); ++r) {
+                            std::string row = to_string(iterations[r]) + "\t";
+                            for (uint8_t m = 0; m < sizeRow; ++m) {
+                                const size_t pos = r * sizeRow + m;
+                                if (!decompress) {
+                                    row += to_string(values[pos]) + "\t";
+                                } else if (found[pos]) {
+                                    row += texts[pos] + "\t";
                                 } else {
-                                    std::string t = program->getFromAdditional(iitr->getCurrentValue(m));
+                                    std::string t = program->getFromAdditional(values[pos]);
                                     if (t == std::string("")) {
-                                        t = std::to_string(iitr->getCurrentValue(m));
+                                        t = std::to_string(values[pos]);
                                     }
                                     row += t + "\t";
                                 }
-                            } else {
-                                row += to_string(iitr->getCurrentValue(m)) + "\t";
                             }
+                            streamout << row << std::endl;
                         }
-                        streamout << row << std::endl;
+                        iterations.clear();
+                        values.clear();
                     }
                     t->releaseIterator(iitr);
                     itr.moveNextCount();
@@ -775,10 +1002,332 @@ void SemiNaiver::saveDerivationIntoDerivationList(FCTable *endTable) {
     }
 }
 
+void SemiNaiver::setMemoryBudget(const size_t budget, std::string dir) {
+    spillManager = std::unique_ptr<SpillManager>(new SpillManager(budget, dir));
+}
+
+static bool lessIteration(const FCBlock &block, const size_t iteration) {
+    return block.iteration < iteration;
+}
+
+void SemiNaiver::updateResidentMemory(const PredId_t pred) {
+    if (predicatesTables[pred] == NULL) {
+        return;
+    }
+    const size_t size = predicatesTables[pred]->getResidentMemory();
+    size_t &old = residentMemory[pred];
+    totalResidentMemory = totalResidentMemory - old + size;
+    old = size;
+}
+
+void SemiNaiver::spillIfNeeded(const Rule &rule) {
+    const PredId_t pred = rule.getHead().getPredicate().getId();
+    if (spillManager == NULL || predicatesTables[pred] == NULL) {
+        return;
+    }
+    //A compaction job refers to the tables of the blocks it merges. They
+    //are wrapped once the job is installed
+    std::vector<FCBlock> spillable;
+    if (compactor == NULL || !compactor->isBusy(pred)) {
+        spillable = predicatesTables[pred]->makeSpillable(spillManager.get(),
+                    SPILL_MIN_ROWS);
+    }
+    //The list of derivations should not keep the old tables in memory
+    for (const auto &block : spillable) {
+        std::vector<FCBlock>::iterator itr = std::lower_bound(
+                listDerivations.begin(), listDerivations.end(),
+                block.iteration, lessIteration);
+        if (itr != listDerivations.end() && itr->iteration == block.iteration) {
+            itr->table = block.table;
+        }
+    }
+    //The rule adds a block to the head and can fill the caches of the
+    //body predicates. Neither can be moved to disk, but they count
+    updateResidentMemory(pred);
+    for (const auto &literal : rule.getBody()) {
+        if (literal.getPredicate().getType() == IDB) {
+            updateResidentMemory(literal.getPredicate().getId());
+        }
+    }
+    spillManager->setPinnedMemory(totalResidentMemory);
+    spillManager->enforceBudget();
+}
+
+void SemiNaiver::enableProfiling() {
+    profiler = std::unique_ptr<Profiler>(new Profiler());
+}
+
+void SemiNaiver::writeProfile(std::string prefix) {
+    if (profiler == NULL) {
+        return;
+    }
+    std::vector<std::string> ruleNames(ruleset.size() + edbRuleset.size());
+    for (const auto &rule : ruleset) {
+        ruleNames[rule.ruleid] = rule.rule.tostring(program, &layer);
+    }
+    for (const auto &rule : edbRuleset) {
+        ruleNames[rule.ruleid] = rule.rule.tostring(program, &layer);
+    }
+    profiler->writeJSON(prefix + ".json", ruleNames);
+    profiler->writeChromeTrace(prefix + ".trace.json", ruleNames);
+}
+
+void SemiNaiver::setCompaction(const bool enabled) {
+    if (enabled) {
+        compactor = std::unique_ptr<Compactor>(new Compactor());
+    } else {
+        compactor.reset();
+    }
+}
+
+void SemiNaiver::compactIfNeeded(const PredId_t pred) {
+    if (compactor == NULL) {
+        return;
+    }
+    for (const auto &job : compactor->getFinishedJobs()) {
+        if (!predicatesTables[job->pred]->replaceBlocks(job->tables,
+                job->result)) {
+            BOOST_LOG_TRIVIAL(debug) << "Blocks changed during the compaction";
+            continue;
+        }
+        //The list of derivations should not keep the merged tables in
+        //memory. The merged block takes the place of the last one
+        std::vector<FCBlock> derivations;
+        for (auto &block : listDerivations) {
+            if (block.table == job->tables.back()) {
+                block.table = job->result;
+            } else if (std::find(job->tables.begin(), job->tables.end(),
+                                 block.table) != job->tables.end()) {
+                continue;
+            }
+            derivations.push_back(block);
+        }
+        listDerivations.swap(derivations);
+    }
+
+    //Blocks older than the oldest last execution of a rule are never read on
+    //their own, since all rules read either all of them or none
+    size_t maxIteration = iteration;
+    for (const auto &rule : ruleset) {
+        maxIteration = std::min(maxIteration, (size_t) rule.lastExecution);
+    }
+    if (predicatesTables[pred] == NULL || compactor->isBusy(pred)) {
+        return;
+    }
+    std::vector<FCBlock> run = predicatesTables[pred]->getCompactionRun(
+                                   maxIteration, COMPACT_MAX_ROWS,
+                                   COMPACT_MIN_BLOCKS);
+    if (!run.empty()) {
+        std::shared_ptr<CompactionJob> job(new CompactionJob());
+        job->pred = pred;
+        job->iteration = run.back().iteration;
+        for (const auto &block : run) {
+            job->tables.push_back(block.table);
+        }
+        compactor->submit(job);
+    }
+}
+
 void SemiNaiver::saveStatistics(StatsRule &stats) {
     statsRuleExecution.push_back(stats);
 }
 
+//Minimum number of rows of an intermediate result before the rest of the
+//rule is evaluated on several partitions in parallel
+#define MIN_ROWS_INTRARULE_PARTITION 4096
+
+static std::vector<std::shared_ptr<const FCInternalTable>> partitionTable(
+            std::shared_ptr<const FCInternalTable> table, const int nparts) {
+    std::vector<std::shared_ptr<const FCInternalTable>> out;
+    const uint8_t ncols = table->getRowSize();
+    FCInternalTableItr *itr = table->getIterator();
+    std::vector<const std::vector<Term_t> *> vectors = itr->getAllVectors(nparts);
+    const size_t sz = vectors[0]->size();
+    const size_t chunksz = (sz + nparts - 1) / nparts;
+    for (size_t begin = 0; begin < sz; begin += chunksz) {
+        const size_t end = std::min(sz, begin + chunksz);
+        std::vector<std::shared_ptr<Column>> columns;
+        for (uint8_t i = 0; i < ncols; ++i) {
+            std::vector<Term_t> slice(vectors[i]->begin() + begin,
+                                      vectors[i]->begin() + end);
+            columns.push_back(std::shared_ptr<Column>(
+                                  new InmemoryColumn(slice, true)));
+        }
+        std::shared_ptr<const Segment> seg(new Segment(ncols, columns));
+        //A slice of a sorted table is still sorted
+        out.push_back(std::shared_ptr<const FCInternalTable>(
+                          new InmemoryFCInternalTable(ncols, 0,
+                                  table->isSorted(), seg)));
+    }
+    itr->deleteAllVectors(vectors);
+    table->releaseIterator(itr);
+    return out;
+}
+
+//True if one of the atoms from startIdx on is on an EDB predicate
+static bool hasEDBAtoms(const RuleExecutionPlan &plan, const int startIdx) {
+    for (int idx = startIdx; idx < plan.plan.size(); ++idx) {
+        if (plan.plan[idx]->getPredicate().getType() == EDB) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct ParallelRemainingAtoms {
+    SemiNaiver *naiver;
+    const std::vector<std::shared_ptr<const FCInternalTable>> &partitions;
+    const int startIdx;
+    RuleExecutionPlan &plan;
+    const Literal &headLiteral;
+    const RuleExecutionDetails &ruleDetails;
+    const std::vector<FinalTableJoinProcessor*> &outputs;
+    std::vector<int> &processedTables;
+
+    ParallelRemainingAtoms(SemiNaiver *naiver,
+                           const std::vector<std::shared_ptr<const FCInternalTable>> &partitions,
+                           const int startIdx, RuleExecutionPlan &plan,
+                           const Literal &headLiteral,
+                           const RuleExecutionDetails &ruleDetails,
+                           const std::vector<FinalTableJoinProcessor*> &outputs,
+                           std::vector<int> &processedTables) :
+        naiver(naiver), partitions(partitions), startIdx(startIdx), plan(plan),
+        headLiteral(headLiteral), ruleDetails(ruleDetails), outputs(outputs),
+        processedTables(processedTables) {
+    }
+
+    void operator()(const tbb::blocked_range<int>& r) const {
+        const int nBodyLiterals = plan.plan.size();
+        for (int i = r.begin(); i != r.end(); ++i) {
+            std::shared_ptr<const FCInternalTable> current = partitions[i];
+            for (int idx = startIdx; idx < nBodyLiterals; ++idx) {
+                const Literal *bodyLiteral = plan.plan[idx];
+                std::vector<std::pair<uint8_t, uint8_t>> *filterValueVars = NULL;
+                for (int j = 0; j < plan.matches.size(); ++j) {
+                    if (plan.matches[j].posLiteralInOrder == idx) {
+                        filterValueVars = &plan.matches[j].matches;
+                    }
+                }
+
+                const bool lastLiteral = idx == (nBodyLiterals - 1);
+                ResultJoinProcessor *joinOutput;
+                if (!lastLiteral) {
+                    joinOutput = new InterTableJoinProcessor(
+                        plan.sizeOutputRelation[idx],
+                        plan.posFromFirst[idx],
+                        plan.posFromSecond[idx], -1);
+                } else {
+                    joinOutput = outputs[i];
+                }
+
+                size_t min = plan.ranges[idx].first;
+                size_t max = plan.ranges[idx].second;
+                if (min == 1)
+                    min = ruleDetails.lastExecution;
+                if (max == 1)
+                    max = ruleDetails.lastExecution - 1;
+
+                JoinExecutor::join(naiver, current.get(),
+                                   lastLiteral ? &headLiteral : NULL,
+                                   *bodyLiteral, min, max, filterValueVars,
+                                   plan.joinCoordinates[idx], joinOutput,
+                                   lastLiteral, ruleDetails, plan,
+                                   processedTables[i], idx, 1);
+
+                if (!lastLiteral) {
+                    joinOutput->consolidate(true);
+                    current = ((InterTableJoinProcessor*)joinOutput)->getTable();
+                    delete joinOutput;
+                    if (current == NULL || current->isEmpty()) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+};
+
+struct ParallelGetSegments {
+    const std::vector<FinalTableJoinProcessor*> &outputs;
+    std::vector<std::vector<std::shared_ptr<const Segment>>> &segments;
+
+    ParallelGetSegments(const std::vector<FinalTableJoinProcessor*> &outputs,
+                        std::vector<std::vector<std::shared_ptr<const Segment>>> &segments) :
+        outputs(outputs), segments(segments) {
+    }
+
+    void operator()(const tbb::blocked_range<int>& r) const {
+        for (int i = r.begin(); i != r.end(); ++i) {
+            segments[i] = outputs[i]->getAllSegments();
+        }
+    }
+};
+
+void SemiNaiver::executeRemainingAtomsPartitioned(
+    std::shared_ptr<const FCInternalTable> firstResults,
+    const int startIdx,
+    RuleExecutionPlan &plan,
+    Literal &headLiteral,
+    FCTable *endTable,
+    const uint32_t iteration,
+    const RuleExecutionDetails &ruleDetails,
+    const uint8_t orderExecution,
+    int &processedTables) {
+
+    //Make sure the EDB tables are loaded before the workers start, since
+    //getTableFromEDBLayer creates them lazily
+    for (int idx = startIdx; idx < plan.plan.size(); ++idx) {
+        if (plan.plan[idx]->getPredicate().getType() == EDB) {
+            getTable(*plan.plan[idx], 0, (size_t) - 1);
+        }
+    }
+
+    const int maxparts = firstResults->getNRows() / MIN_ROWS_INTRARULE_PARTITION;
+    std::vector<std::shared_ptr<const FCInternalTable>> partitions =
+        partitionTable(firstResults, std::min(nthreads, maxparts));
+    const int nparts = partitions.size();
+    BOOST_LOG_TRIVIAL(debug) << "Evaluating the remaining atoms on " << nparts
+                             << " partitions of " << firstResults->getNRows() << " rows";
+
+    //Every partition writes into its own container. Nothing is added to
+    //endTable until all partitions are finished.
+    const int lastIdx = plan.plan.size() - 1;
+    std::vector<FinalTableJoinProcessor*> outputs;
+    std::vector<int> partProcessedTables(nparts, 0);
+    for (int i = 0; i < nparts; ++i) {
+        outputs.push_back(new FinalTableJoinProcessor(
+                              plan.posFromFirst[lastIdx],
+                              plan.posFromSecond[lastIdx],
+                              listDerivations,
+                              endTable,
+                              headLiteral, &ruleDetails,
+                              orderExecution, iteration,
+                              false, 1));
+    }
+    tbb::parallel_for(tbb::blocked_range<int>(0, nparts, 1),
+                      ParallelRemainingAtoms(this, partitions, startIdx, plan,
+                              headLiteral, ruleDetails, outputs,
+                              partProcessedTables));
+
+    //Sort the partial results in parallel, then remove the duplicates
+    //(with the existing content and between partitions) and add them.
+    std::vector<std::vector<std::shared_ptr<const Segment>>> segments(nparts);
+    tbb::parallel_for(tbb::blocked_range<int>(0, nparts, 1),
+                      ParallelGetSegments(outputs, segments));
+    for (int i = 0; i < nparts; ++i) {
+        processedTables += partProcessedTables[i];
+        for (auto segment = segments[i].begin(); segment != segments[i].end();
+                ++segment) {
+            std::shared_ptr<const Segment> newseg =
+                endTable->retainFrom(*segment, false, nthreads);
+            if (!newseg->isEmpty()) {
+                outputs[i]->consolidateSegment(newseg);
+            }
+        }
+        delete outputs[i];
+    }
+}
+
 bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
                              const uint32_t iteration,
                              std::vector<ResultJoinProcessor*> *finalResultContainer) {
@@ -800,6 +1349,7 @@ bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
     boost::chrono::duration<double> durationJoin(0);
     boost::chrono::duration<double> durationConsolidation(0);
     boost::chrono::duration<double> durationFirstAtom(0);
+    ProfiledRule profile;
 
     //Get table corresponding to the head predicate
     FCTable *endTable = getTable(idHeadPredicate, headLiteral.
@@ -870,6 +1420,34 @@ bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
 
 	bool first = true;
         while (optimalOrderIdx < nBodyLiterals) {
+            //If the intermediate result is large, evaluate the remaining
+            //atoms on horizontal partitions of it in parallel. The EDB
+            //tables are then queried by several threads
+            if (!first && finalResultContainer == NULL && nthreads > 1 &&
+                    currentResults->getRowSize() > 0 &&
+                    currentResults->getNRows() >= 2 * MIN_ROWS_INTRARULE_PARTITION &&
+                    (layer.isMultithreaded() ||
+                     !hasEDBAtoms(plan, optimalOrderIdx))) {
+                boost::chrono::system_clock::time_point start = timens::system_clock::now();
+                executeRemainingAtomsPartitioned(currentResults, optimalOrderIdx,
+                                                 plan, headLiteral, endTable,
+                                                 iteration, ruleDetails,
+                                                 (uint8_t) orderExecution,
+                                                 processedTables);
+                durationJoin += boost::chrono::system_clock::now() - start;
+                if (profiler != NULL) {
+                    Profiler::addOperator(profile, "partitioned_join", NULL,
+                                          optimalOrderIdx,
+                                          profiler->getMicros(start),
+                                          profiler->getMicros(timens::system_clock::now()),
+                                          currentResults->getNRows(),
+                                          endTable->isEmpty(iteration) ? 0 :
+                                          endTable->getNRows(iteration));
+                }
+                saveDerivationIntoDerivationList(endTable);
+                break;
+            }
+
             const Literal *bodyLiteral = plan.plan[optimalOrderIdx];
 
             //This data structure is used to filter out rows where different columns
@@ -915,6 +1493,18 @@ bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
             BOOST_LOG_TRIVIAL(debug) << "Evaluating atom " << optimalOrderIdx << " " << bodyLiteral->tostring() <<
                                      " min=" << min << " max=" << max;
 
+            const bool wasFirst = first;
+            const size_t rowsIn = first ? 0 : currentResults->getNRows();
+            const char *algorithm = NULL;
+            if (profiler != NULL && !first) {
+                algorithm = JoinExecutor::getAlgorithmName(
+                                JoinExecutor::chooseAlgorithm(this,
+                                        currentResults.get(),
+                                        plan, optimalOrderIdx,
+                                        plan.joinCoordinates[optimalOrderIdx]));
+            }
+            const boost::chrono::system_clock::time_point startOp =
+                timens::system_clock::now();
             if (first) {
 		boost::chrono::system_clock::time_point startFirstA = timens::system_clock::now();
 		if (lastLiteral || bodyLiteral->getNVars() > 0) {
@@ -990,6 +1580,25 @@ bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
 		}
 #endif
             }
+            if (profiler != NULL && !first) {
+                size_t rowsOut = 0;
+                if (!lastLiteral) {
+                    rowsOut = currentResults != NULL ? currentResults->getNRows() : 0;
+                } else if (!endTable->isEmpty(iteration)) {
+                    rowsOut = endTable->getNRows(iteration);
+                }
+                Profiler::addOperator(profile, wasFirst ? "first_atom" : "join",
+                                      algorithm, optimalOrderIdx,
+                                      profiler->getMicros(startOp),
+                                      profiler->getMicros(startC), rowsIn,
+                                      rowsOut);
+                //The final consolidation removes the rows already in the head table
+                Profiler::addOperator(profile, lastLiteral ? "retain" : "consolidate",
+                                      NULL, optimalOrderIdx,
+                                      profiler->getMicros(startC),
+                                      profiler->getMicros(timens::system_clock::now()),
+                                      rowsOut, rowsOut);
+            }
             if (lastLiteral && finalResultContainer) {
                 finalResultContainer->push_back(joinOutput);
             } else {
@@ -1023,6 +1632,16 @@ bool SemiNaiver::executeRule(RuleExecutionDetails &ruleDetails,
         boost::chrono::system_clock::now() - startRule;
     double td = totalDuration.count() * 1000;
 
+    if (profiler != NULL) {
+        profile.ruleid = ruleDetails.ruleid;
+        profile.iteration = iteration;
+        profile.start = profiler->getMicros(startRule);
+        profile.duration = td * 1000;
+        profile.derived = prodDer ? endTable->getNRows(iteration) : 0;
+        profile.peakMemMB = (long) Utils::get_max_mem();
+        profiler->add(profile);
+    }
+
 #ifdef WEBINTERFACE
     StatsRule stats;
     stats.iteration = iteration;
@@ -1226,11 +1845,24 @@ size_t SemiNaiver::getSizeTable(const PredId_t predid) const {
     return predicatesTables[predid]->getNAllRows();
 }
 
+bool SemiNaiver::isEDBTableUnchanged(const PredId_t predid) const {
+    //The table is only created when the predicate is first read
+    return predicatesTables[predid] == NULL ||
+           predicatesTables[predid]->isOnlyEDB();
+}
+
 SemiNaiver::~SemiNaiver() {
+    compactor.reset();
+    if (checkpointThread.joinable()) {
+        checkpointThread.join();
+    }
+
     for (int i = 0; i < MAX_NPREDS; ++i) {
         if (predicatesTables[i] != NULL)
             delete predicatesTables[i];
     }
+    //The spilled tables must be released before the spill manager
+    listDerivations.clear();
 
     /*for (EDBCache::iterator itr = edbCache.begin(); itr != edbCache.end(); ++itr) {
         delete itr->second;
@@ -0,0 +1,280 @@
+#include <vlog/spilledtable.h>
+#include <vlog/columnio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+//Number of least recently used tables that are considered for eviction.
+//Among them, the one that was accessed the least is evicted first
+#define SPILL_LRU_WINDOW 8
+
+SpillManager::SpillManager(const size_t budget, std::string dir) :
+    budget(budget), dir(dir), usedMemory(0), pinnedMemory(0), counter(0),
+    nspills(0), nloads(0) {
+    if (!fs::exists(dir)) {
+        fs::create_directories(dir);
+    }
+    BOOST_LOG_TRIVIAL(info) << "Spilling blocks to " << dir <<
+                            " when they exceed " << budget << " bytes";
+}
+
+std::string SpillManager::getNewFile() {
+    boost::mutex::scoped_lock lock(mutex);
+    return dir + "/block-" + std::to_string(counter++);
+}
+
+void SpillManager::touch(SpilledFCInternalTable *table) {
+    boost::mutex::scoped_lock lock(mutex);
+    table->accesses++;
+    if (table->resident && table->lruPos != lru.begin()) {
+        lru.splice(lru.begin(), lru, table->lruPos);
+    }
+}
+
+void SpillManager::loaded(SpilledFCInternalTable *table) {
+    boost::mutex::scoped_lock lock(mutex);
+    table->accesses++;
+    if (!table->resident) {
+        lru.push_front(table);
+        table->lruPos = lru.begin();
+        table->resident = true;
+        usedMemory += table->getMemorySize();
+        if (table->onDisk)
+            nloads++;
+    }
+}
+
+void SpillManager::unregister(SpilledFCInternalTable *table) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (table->resident) {
+        lru.erase(table->lruPos);
+        table->resident = false;
+        usedMemory -= table->getMemorySize();
+    }
+}
+
+void SpillManager::setPinnedMemory(const size_t size) {
+    boost::mutex::scoped_lock lock(mutex);
+    pinnedMemory = size;
+}
+
+void SpillManager::enforceBudget() {
+    size_t attempts;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        attempts = lru.size();
+    }
+    while (true) {
+        SpilledFCInternalTable *victim = NULL;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if (usedMemory + pinnedMemory <= budget || lru.empty() ||
+                    attempts == 0) {
+                break;
+            }
+            attempts--;
+            std::list<SpilledFCInternalTable*>::iterator itr = lru.end();
+            --itr;
+            victim = *itr;
+            for (int i = 0; i < SPILL_LRU_WINDOW && itr != lru.begin(); ++i) {
+                --itr;
+                if ((*itr)->accesses < victim->accesses) {
+                    victim = *itr;
+                }
+            }
+            lru.erase(victim->lruPos);
+            victim->resident = false;
+            usedMemory -= victim->getMemorySize();
+        }
+
+        if (victim->evict()) {
+            boost::mutex::scoped_lock lock(mutex);
+            nspills++;
+        } else {
+            //Some iterators are still open. Try again later
+            boost::mutex::scoped_lock lock(mutex);
+            if (!victim->resident) {
+                lru.push_front(victim);
+                victim->lruPos = lru.begin();
+                victim->resident = true;
+                usedMemory += victim->getMemorySize();
+            }
+        }
+    }
+}
+
+SpillManager::~SpillManager() {
+    BOOST_LOG_TRIVIAL(debug) << "Blocks moved to disk " << nspills <<
+                             " loaded from disk " << nloads;
+}
+
+SpilledFCInternalTable::SpilledFCInternalTable(SpillManager *manager,
+        std::shared_ptr<const FCInternalTable> table,
+        const size_t iteration) :
+    manager(manager), nfields(table->getRowSize()), iteration(iteration),
+    nrows(table->getNRows()), sorted(table->isSorted()),
+    file(manager->getNewFile()), table(table), onDisk(false),
+    resident(false), accesses(0) {
+    manager->loaded(this);
+}
+
+bool SpilledFCInternalTable::evict() {
+    boost::mutex::scoped_lock lock(mutex);
+    if (table == NULL) {
+        return true;
+    }
+    if (!openIterators.empty()) {
+        return false;
+    }
+    if (!onDisk) {
+        //The table is immutable. It must be written only once
+        std::ofstream out(file, std::ios_base::binary);
+        ColumnIO::write(out, table.get());
+        if (!out) {
+            BOOST_LOG_TRIVIAL(error) << "Failed writing the block on " << file;
+            throw 10;
+        }
+        onDisk = true;
+    }
+    table.reset();
+    return true;
+}
+
+std::shared_ptr<const FCInternalTable> SpilledFCInternalTable::acquire() const {
+    std::shared_ptr<const FCInternalTable> t;
+    bool load = false;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if (table == NULL) {
+            std::ifstream in(file, std::ios_base::binary);
+            std::shared_ptr<const Segment> seg = ColumnIO::read(in);
+            table = std::shared_ptr<const FCInternalTable>(
+                        new InmemoryFCInternalTable(nfields, iteration, sorted,
+                                                    seg));
+            load = true;
+        }
+        t = table;
+    }
+    SpilledFCInternalTable *self = const_cast<SpilledFCInternalTable*>(this);
+    if (load) {
+        manager->loaded(self);
+    } else {
+        manager->touch(self);
+    }
+    return t;
+}
+
+FCInternalTableItr *SpilledFCInternalTable::registerIterator(
+    FCInternalTableItr *itr,
+    std::shared_ptr<const FCInternalTable> t) const {
+    boost::mutex::scoped_lock lock(mutex);
+    openIterators.insert(std::make_pair(itr, t));
+    return itr;
+}
+
+bool SpilledFCInternalTable::supportsDirectAccess() const {
+    return acquire()->supportsDirectAccess();
+}
+
+std::shared_ptr<const FCInternalTable> SpilledFCInternalTable::cloneWithIteration(
+    const size_t iteration) const {
+    return acquire()->cloneWithIteration(iteration);
+}
+
+FCInternalTableItr *SpilledFCInternalTable::getIterator() const {
+    std::shared_ptr<const FCInternalTable> t = acquire();
+    return registerIterator(t->getIterator(), t);
+}
+
+FCInternalTableItr *SpilledFCInternalTable::getSortedIterator() const {
+    std::shared_ptr<const FCInternalTable> t = acquire();
+    return registerIterator(t->getSortedIterator(), t);
+}
+
+FCInternalTableItr *SpilledFCInternalTable::getSortedIterator(int nthreads) const {
+    std::shared_ptr<const FCInternalTable> t = acquire();
+    return registerIterator(t->getSortedIterator(nthreads), t);
+}
+
+size_t SpilledFCInternalTable::estimateNRows(const uint8_t nconstantsToFilter,
+        const uint8_t *posConstantsToFilter,
+        const Term_t *valuesConstantsToFilter) const {
+    if (nconstantsToFilter == 0) {
+        //No need to load the table
+        return nrows;
+    }
+    return acquire()->estimateNRows(nconstantsToFilter, posConstantsToFilter,
+                                    valuesConstantsToFilter);
+}
+
+std::shared_ptr<const FCInternalTable> SpilledFCInternalTable::filter(
+    const uint8_t nPosToCopy, const uint8_t *posVarsToCopy,
+    const uint8_t nPosToFilter, const uint8_t *posConstantsToFilter,
+    const Term_t *valuesConstantsToFilter, const uint8_t nRepeatedVars,
+    const std::pair<uint8_t, uint8_t> *repeatedVars, int nthreads) const {
+    return acquire()->filter(nPosToCopy, posVarsToCopy, nPosToFilter,
+                             posConstantsToFilter, valuesConstantsToFilter,
+                             nRepeatedVars, repeatedVars, nthreads);
+}
+
+std::shared_ptr<Column> SpilledFCInternalTable::getColumn(
+    const uint8_t columnIdx) const {
+    return acquire()->getColumn(columnIdx);
+}
+
+bool SpilledFCInternalTable::isColumnConstant(const uint8_t columnid) const {
+    return acquire()->isColumnConstant(columnid);
+}
+
+Term_t SpilledFCInternalTable::getValueConstantColumn(
+    const uint8_t columnid) const {
+    return acquire()->getValueConstantColumn(columnid);
+}
+
+Term_t SpilledFCInternalTable::get(const size_t rowId,
+                                   const uint8_t columnId) const {
+    return acquire()->get(rowId, columnId);
+}
+
+std::shared_ptr<const FCInternalTable> SpilledFCInternalTable::merge(
+    std::shared_ptr<const FCInternalTable> t, int nthreads) const {
+    return acquire()->merge(t, nthreads);
+}
+
+FCInternalTableItr *SpilledFCInternalTable::sortBy(
+    const std::vector<uint8_t> &fields) const {
+    std::shared_ptr<const FCInternalTable> t = acquire();
+    return registerIterator(t->sortBy(fields), t);
+}
+
+FCInternalTableItr *SpilledFCInternalTable::sortBy(
+    const std::vector<uint8_t> &fields, const int nthreads) const {
+    std::shared_ptr<const FCInternalTable> t = acquire();
+    return registerIterator(t->sortBy(fields, nthreads), t);
+}
+
+void SpilledFCInternalTable::releaseIterator(FCInternalTableItr *itr) const {
+    std::shared_ptr<const FCInternalTable> t;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        auto el = openIterators.find(itr);
+        if (el == openIterators.end()) {
+            BOOST_LOG_TRIVIAL(error) << "Iterator not created by this table";
+            throw 10;
+        }
+        t = el->second;
+        openIterators.erase(el);
+    }
+    t->releaseIterator(itr);
+}
+
+SpilledFCInternalTable::~SpilledFCInternalTable() {
+    manager->unregister(this);
+    if (onDisk) {
+        fs::remove(file);
+    }
+}
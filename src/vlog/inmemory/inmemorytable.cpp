@@ -0,0 +1,729 @@
+#include <vlog/inmemory/inmemorytable.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <fstream>
+#include <cstring>
+
+/***** InmemoryIterator *****/
+
+void InmemoryIterator::init(PredId_t predid, const InmemoryPermutation *perm,
+                            const size_t start, const size_t end,
+                            const std::vector<std::pair<uint8_t, uint8_t>> &repeatedVars,
+                            const std::vector<std::pair<uint8_t, Term_t>> &filters,
+                            const int sortField) {
+    this->predid = predid;
+    this->perm = perm;
+    this->start = start;
+    this->current = start;
+    this->nextRow = start;
+    this->end = end;
+    this->repeatedVars = repeatedVars;
+    this->filters = filters;
+    this->sortField = sortField;
+    checkedBlock = ~0ul;
+    isFirst = true;
+    skipDuplicatedFirst = false;
+}
+
+bool InmemoryIterator::isValid(const size_t i) const {
+    for (const auto &p : repeatedVars) {
+        if (perm->get(p.first, i) != perm->get(p.second, i)) {
+            return false;
+        }
+    }
+    for (const auto &f : filters) {
+        if (perm->get(f.first, i) != f.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InmemoryIterator::skipBlock(const size_t block) const {
+    for (const auto &f : filters) {
+        const size_t idx = f.first * perm->nblocks + block;
+        if (f.second < perm->blockMin[idx] || f.second > perm->blockMax[idx]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool InmemoryIterator::hasNext() {
+    while (nextRow < end) {
+        if (perm->blockMin != NULL && !filters.empty()) {
+            //Skip the blocks that cannot contain the constants
+            const size_t block = nextRow / perm->blockSize;
+            if (block != checkedBlock) {
+                checkedBlock = block;
+                if (skipBlock(block)) {
+                    nextRow = std::min(end, (block + 1) * perm->blockSize);
+                    continue;
+                }
+            }
+        }
+        if (!isValid(nextRow)) {
+            nextRow++;
+        } else if (skipDuplicatedFirst && !isFirst && sortField >= 0 &&
+                   perm->get(sortField, nextRow) ==
+                   perm->get(sortField, current)) {
+            nextRow++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+void InmemoryIterator::next() {
+    hasNext();
+    current = nextRow++;
+    isFirst = false;
+}
+
+Term_t InmemoryIterator::getElementAt(const uint8_t p) {
+    return perm->get(p, current);
+}
+
+void InmemoryIterator::moveTo(const uint8_t field, const Term_t t) {
+    if ((int) field != sortField) {
+        BOOST_LOG_TRIVIAL(error) << "moveTo is only supported on the first sorted field";
+        throw 10;
+    }
+    //The rows in the range are sorted by this field
+    size_t first = nextRow;
+    size_t len = end - nextRow;
+    while (len > 0) {
+        const size_t half = len / 2;
+        if (perm->get(field, first + half) < t) {
+            first += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+    nextRow = first;
+}
+
+void InmemoryIterator::skipDuplicatedFirstColumn() {
+    skipDuplicatedFirst = true;
+}
+
+size_t InmemoryIterator::count() {
+    if (repeatedVars.empty() && filters.empty() && !skipDuplicatedFirst) {
+        return end - start;
+    }
+    size_t n = 0;
+    while (hasNext()) {
+        next();
+        n++;
+    }
+    return n;
+}
+
+const char *InmemoryIterator::getUnderlyingArray(uint8_t column) {
+    //Only if the rows of the range are stored contiguously
+    if (perm->index != NULL || !repeatedVars.empty() || !filters.empty()) {
+        return NULL;
+    }
+    return (const char*) (perm->columns[column] + start);
+}
+
+std::pair<uint8_t, std::pair<uint8_t, uint8_t>> InmemoryIterator::getSizeElemUnderlyingArray(uint8_t column) {
+    if (getUnderlyingArray(column) == NULL) {
+        return std::make_pair(0, std::make_pair(0, 0));
+    }
+    return std::make_pair(sizeof(Term_t), std::make_pair(0, 0));
+}
+
+/***** InmemoryTable *****/
+
+static void splitLine(const std::string &line, const char separator,
+                      std::vector<std::string> &fields) {
+    fields.clear();
+    size_t i = 0;
+    while (true) {
+        std::string field;
+        if (i < line.size() && line[i] == '"') {
+            //Quoted field. Two quotes are an escaped quote
+            i++;
+            while (i < line.size()) {
+                if (line[i] == '"') {
+                    if (i + 1 < line.size() && line[i + 1] == '"') {
+                        field += '"';
+                        i += 2;
+                    } else {
+                        i++;
+                        break;
+                    }
+                } else {
+                    field += line[i++];
+                }
+            }
+            while (i < line.size() && line[i] != separator) {
+                i++;
+            }
+        } else {
+            const size_t next = std::min(line.find(separator, i), line.size());
+            field = line.substr(i, next - i);
+            i = next;
+        }
+        fields.push_back(field);
+        if (i >= line.size()) {
+            break;
+        }
+        i++; //skip the separator
+    }
+}
+
+InmemoryTable::InmemoryTable(PredId_t predid) : predid(predid), arity(0),
+    nrows(0), scanWithoutIndex(false) {
+}
+
+InmemoryTable::InmemoryTable(PredId_t predid, std::string path,
+                             std::string separator,
+                             std::shared_ptr<Dictionary> dict) :
+    dict(dict), predid(predid), arity(0), nrows(0), scanWithoutIndex(false) {
+    char sep;
+    if (separator == "") {
+        sep = boost::algorithm::ends_with(path, ".csv") ||
+              boost::algorithm::ends_with(path, ".csv.gz") ? ',' : '\t';
+    } else if (separator == "tab") {
+        sep = '\t';
+    } else if (separator == "comma") {
+        sep = ',';
+    } else if (separator.size() == 1) {
+        sep = separator[0];
+    } else {
+        BOOST_LOG_TRIVIAL(error) << "Separator " << separator << " is not supported";
+        throw 10;
+    }
+    load(path, sep);
+    sortAndRemoveDuplicates();
+
+    InmemoryPermutation perm;
+    for (uint8_t i = 0; i < arity; ++i) {
+        perm.order.push_back(i);
+        perm.columns.push_back(data[i].data());
+    }
+    permutations.push_back(perm);
+}
+
+void InmemoryTable::load(std::string path, char separator) {
+    std::ifstream file(path, std::ios_base::binary);
+    if (!file) {
+        BOOST_LOG_TRIVIAL(error) << "The file " << path << " does not exist. Check the edb.conf file.";
+        throw 10;
+    }
+    boost::iostreams::filtering_istream in;
+    if (boost::algorithm::ends_with(path, ".gz")) {
+        in.push(boost::iostreams::gzip_decompressor());
+    }
+    in.push(file);
+
+    std::string line;
+    std::vector<std::string> fields;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.resize(line.size() - 1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        splitLine(line, separator, fields);
+        if (arity == 0) {
+            if (fields.size() > 255) {
+                BOOST_LOG_TRIVIAL(error) << "Relations with more than 255 columns are not supported";
+                throw 10;
+            }
+            arity = (uint8_t) fields.size();
+            data.resize(arity);
+        } else if (fields.size() != arity) {
+            BOOST_LOG_TRIVIAL(error) << "Line " << nrows + 1 << " of " << path <<
+                                     " has " << fields.size() <<
+                                     " fields instead of " << (int) arity;
+            throw 10;
+        }
+        for (uint8_t i = 0; i < arity; ++i) {
+            data[i].push_back(dict->getOrAdd(fields[i]));
+        }
+        nrows++;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Loaded " << nrows << " rows of arity " <<
+                            (int) arity << " from " << path;
+}
+
+struct InmemoryRowSorter {
+    const std::vector<const Term_t*> &columns;
+    const std::vector<uint8_t> &order;
+
+    InmemoryRowSorter(const std::vector<const Term_t*> &columns,
+                      const std::vector<uint8_t> &order) :
+        columns(columns), order(order) {}
+
+    bool operator()(const uint64_t r1, const uint64_t r2) const {
+        for (const auto c : order) {
+            if (columns[c][r1] != columns[c][r2]) {
+                return columns[c][r1] < columns[c][r2];
+            }
+        }
+        return false;
+    }
+};
+
+void InmemoryTable::sortAndRemoveDuplicates() {
+    std::vector<uint8_t> order;
+    std::vector<const Term_t*> columns;
+    for (uint8_t i = 0; i < arity; ++i) {
+        order.push_back(i);
+        columns.push_back(data[i].data());
+    }
+    std::vector<uint64_t> idx(nrows);
+    for (size_t i = 0; i < nrows; ++i) {
+        idx[i] = i;
+    }
+    InmemoryRowSorter sorter(columns, order);
+    std::sort(idx.begin(), idx.end(), sorter);
+
+    std::vector<std::vector<Term_t>> sorted(arity);
+    for (size_t i = 0; i < nrows; ++i) {
+        if (i > 0 && !sorter(idx[i - 1], idx[i])) {
+            continue; //duplicate
+        }
+        for (uint8_t j = 0; j < arity; ++j) {
+            sorted[j].push_back(data[j][idx[i]]);
+        }
+    }
+    data.swap(sorted);
+    nrows = arity > 0 ? data[0].size() : 0;
+}
+
+int InmemoryTable::cmp(const InmemoryPermutation &perm, const size_t i,
+                       const Term_t *key, const uint8_t sizeKey) const {
+    for (uint8_t j = 0; j < sizeKey; ++j) {
+        const Term_t v = perm.get(perm.order[j], i);
+        if (v < key[j]) {
+            return -1;
+        } else if (v > key[j]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+std::vector<uint8_t> InmemoryTable::getOrder(const Literal &query,
+        const std::vector<uint8_t> &positions,
+        const std::vector<uint8_t> &sortFields,
+        std::vector<bool> &bound, size_t &nsorted) {
+    std::vector<uint8_t> order;
+    bound.resize(arity);
+    for (uint8_t i = 0; i < arity; ++i) {
+        if (!query.getTermAtPos(i).isVariable()) {
+            order.push_back(i);
+            bound[i] = true;
+        }
+    }
+    for (const auto p : positions) {
+        if (!bound[p]) {
+            order.push_back(p);
+            bound[p] = true;
+        }
+    }
+    //The fields to sort are indices among the variables
+    std::vector<bool> added(bound);
+    std::vector<uint8_t> posVars = query.getPosVars();
+    nsorted = 0;
+    for (const auto f : sortFields) {
+        if (!added[posVars[f]]) {
+            order.push_back(posVars[f]);
+            added[posVars[f]] = true;
+            nsorted++;
+        }
+    }
+    for (uint8_t i = 0; i < arity; ++i) {
+        if (!added[i]) {
+            order.push_back(i);
+        }
+    }
+    return order;
+}
+
+const InmemoryPermutation *InmemoryTable::getPermutation(
+    const std::vector<uint8_t> &order, const size_t nbound,
+    const size_t nsorted, size_t &prefix) {
+    std::vector<bool> isBound(arity);
+    for (size_t i = 0; i < nbound; ++i) {
+        isBound[order[i]] = true;
+    }
+
+    boost::mutex::scoped_lock lock(mutex);
+    //A permutation fits if it starts with the bound columns, in any order,
+    //followed by the columns to sort
+    const InmemoryPermutation *best = NULL;
+    size_t bestPrefix = 0;
+    for (const auto &perm : permutations) {
+        size_t p = 0;
+        while (p < arity && isBound[perm.order[p]]) {
+            p++;
+        }
+        if (p == nbound && std::equal(order.begin() + nbound,
+                                      order.begin() + nbound + nsorted,
+                                      perm.order.begin() + nbound)) {
+            prefix = p;
+            return &perm;
+        }
+        if (best == NULL || p > bestPrefix) {
+            best = &perm;
+            bestPrefix = p;
+        }
+    }
+    if (scanWithoutIndex && nsorted == 0 && best != NULL) {
+        prefix = bestPrefix;
+        return best;
+    }
+
+    //Build a new index on top of the first permutation
+    const InmemoryPermutation &base = permutations.front();
+    builtIndices.push_back(std::vector<uint64_t>(nrows));
+    std::vector<uint64_t> &idx = builtIndices.back();
+    for (size_t i = 0; i < nrows; ++i) {
+        idx[i] = base.index == NULL ? i : base.index[i];
+    }
+    std::sort(idx.begin(), idx.end(), InmemoryRowSorter(base.columns, order));
+    InmemoryPermutation perm;
+    perm.order = order;
+    perm.columns = base.columns;
+    perm.index = idx.data();
+    permutations.push_back(perm);
+    BOOST_LOG_TRIVIAL(debug) << "Built a new index on predicate " << predid;
+    prefix = nbound;
+    return &permutations.back();
+}
+
+InmemoryIterator *InmemoryTable::getIterator(const Literal &query,
+        const std::vector<uint8_t> &positions,
+        const Term_t *values,
+        const std::vector<uint8_t> &sortFields) {
+    if (query.getTupleSize() != arity) {
+        BOOST_LOG_TRIVIAL(error) << "The literal has arity " <<
+                                 query.getTupleSize() << " but the relation " <<
+                                 (int) arity;
+        throw 10;
+    }
+    std::vector<Term_t> boundValues(arity);
+    for (uint8_t i = 0; i < arity; ++i) {
+        VTerm t = query.getTermAtPos(i);
+        if (!t.isVariable()) {
+            boundValues[i] = t.getValue();
+        }
+    }
+    for (size_t i = 0; i < positions.size(); ++i) {
+        boundValues[positions[i]] = values[i];
+    }
+    std::vector<bool> bound;
+    size_t nsorted;
+    std::vector<uint8_t> order = getOrder(query, positions, sortFields, bound,
+                                          nsorted);
+    size_t nbound = 0;
+    for (uint8_t i = 0; i < arity; ++i) {
+        if (bound[i])
+            nbound++;
+    }
+    size_t prefix;
+    const InmemoryPermutation *perm = getPermutation(order, nbound, nsorted,
+                                      prefix);
+
+    std::vector<Term_t> key;
+    std::vector<std::pair<uint8_t, Term_t>> filters;
+    for (uint8_t i = 0; i < arity; ++i) {
+        const uint8_t c = perm->order[i];
+        if (i < prefix) {
+            key.push_back(boundValues[c]);
+        } else if (bound[c]) {
+            filters.push_back(std::make_pair(c, boundValues[c]));
+        }
+    }
+
+    //Binary search on the bound prefix
+    const uint8_t sizeKey = (uint8_t) key.size();
+    size_t start = 0;
+    size_t len = nrows;
+    while (len > 0) {
+        const size_t half = len / 2;
+        if (cmp(*perm, start + half, key.data(), sizeKey) < 0) {
+            start += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+    size_t end = start;
+    len = nrows - start;
+    while (len > 0) {
+        const size_t half = len / 2;
+        if (cmp(*perm, end + half, key.data(), sizeKey) <= 0) {
+            end += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+
+    const int sortField = prefix < arity && filters.empty() ?
+                          perm->order[prefix] : -1;
+    InmemoryIterator *itr = new InmemoryIterator();
+    itr->init(predid, perm, start, end, query.getRepeatedVars(), filters,
+              sortField);
+    return itr;
+}
+
+bool InmemoryTable::exists(const Literal &query,
+                           const std::vector<uint8_t> &positions,
+                           const Term_t *values) {
+    std::vector<uint8_t> sortFields;
+    InmemoryIterator *itr = getIterator(query, positions, values, sortFields);
+    const bool out = itr->hasNext();
+    delete itr;
+    return out;
+}
+
+std::vector<std::shared_ptr<Column>> InmemoryTable::checkNewIn(
+                                      const Literal &l1,
+                                      std::vector<uint8_t> &posInL1,
+                                      const Literal &l2,
+std::vector<uint8_t> &posInL2) {
+    std::vector<uint8_t> posVars1 = l1.getPosVars();
+    std::vector<uint8_t> posVars2 = l2.getPosVars();
+    std::vector<uint8_t> fields2;
+    for (const auto p : posInL2) {
+        fields2.push_back(posVars2[p]);
+    }
+
+    std::vector<std::shared_ptr<ColumnWriter>> cols;
+    for (size_t i = 0; i < posInL1.size(); ++i) {
+        cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+    }
+
+    //Values are sorted by the fields, so duplicates are consecutive
+    InmemoryIterator *itr = getIterator(l1, std::vector<uint8_t>(), NULL,
+                                        posInL1);
+    std::vector<Term_t> prev(posInL1.size());
+    std::vector<Term_t> cur(posInL1.size());
+    bool first = true;
+    while (itr->hasNext()) {
+        itr->next();
+        for (size_t i = 0; i < posInL1.size(); ++i) {
+            cur[i] = itr->getElementAt(posVars1[posInL1[i]]);
+        }
+        if (!first && cur == prev) {
+            continue;
+        }
+        first = false;
+        prev = cur;
+        if (!exists(l2, fields2, cur.data())) {
+            for (size_t i = 0; i < cur.size(); ++i) {
+                cols[i]->add(cur[i]);
+            }
+        }
+    }
+    delete itr;
+
+    std::vector<std::shared_ptr<Column>> output;
+    for (auto &writer : cols) {
+        output.push_back(writer->getColumn());
+    }
+    return output;
+}
+
+std::vector<std::shared_ptr<Column>> InmemoryTable::checkNewIn(
+                                      std::vector <
+                                      std::shared_ptr<Column >> &checkValues,
+                                      const Literal &l,
+std::vector<uint8_t> &posInL) {
+    std::vector<uint8_t> posVars = l.getPosVars();
+    std::vector<uint8_t> fields;
+    for (const auto p : posInL) {
+        fields.push_back(posVars[p]);
+    }
+
+    std::vector<std::shared_ptr<ColumnWriter>> cols;
+    std::vector<std::unique_ptr<ColumnReader>> readers;
+    for (size_t i = 0; i < checkValues.size(); ++i) {
+        cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+        readers.push_back(checkValues[i]->getReader());
+    }
+
+    std::vector<Term_t> prev(checkValues.size());
+    std::vector<Term_t> cur(checkValues.size());
+    bool first = true;
+    while (!readers.empty() && readers[0]->hasNext()) {
+        for (size_t i = 0; i < readers.size(); ++i) {
+            cur[i] = readers[i]->next();
+        }
+        if (!first && cur == prev) {
+            continue;
+        }
+        first = false;
+        prev = cur;
+        if (!exists(l, fields, cur.data())) {
+            for (size_t i = 0; i < cur.size(); ++i) {
+                cols[i]->add(cur[i]);
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<Column>> output;
+    for (auto &writer : cols) {
+        output.push_back(writer->getColumn());
+    }
+    return output;
+}
+
+std::shared_ptr<Column> InmemoryTable::checkIn(
+    std::vector<Term_t> &values,
+    const Literal &l,
+    uint8_t posInL,
+    size_t &sizeOutput) {
+    std::vector<uint8_t> fields;
+    fields.push_back(l.getPosVars()[posInL]);
+
+    std::unique_ptr<ColumnWriter> col(new ColumnWriter());
+    sizeOutput = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0 && values[i] == values[i - 1]) {
+            continue;
+        }
+        if (exists(l, fields, &values[i])) {
+            col->add(values[i]);
+            sizeOutput++;
+        }
+    }
+    return col->getColumn();
+}
+
+void InmemoryTable::query(QSQQuery *query, TupleTable *outputTable,
+                          std::vector<uint8_t> *posToFilter,
+                          std::vector<Term_t> *valuesToFilter) {
+    const Literal *l = query->getLiteral();
+    const uint8_t npos = query->getNPosToCopy();
+    uint8_t *pos = query->getPosToCopy();
+    std::vector<uint64_t> row(npos);
+    std::vector<uint8_t> positions;
+    std::vector<uint8_t> sortFields;
+    if (posToFilter == NULL || posToFilter->size() == 0) {
+        InmemoryIterator *itr = getIterator(*l, positions, NULL, sortFields);
+        while (itr->hasNext()) {
+            itr->next();
+            for (uint8_t i = 0; i < npos; ++i) {
+                row[i] = itr->getElementAt(pos[i]);
+            }
+            outputTable->addRow(row.data());
+        }
+        delete itr;
+    } else {
+        //One lookup for every tuple of values
+        const size_t n = posToFilter->size();
+        for (size_t j = 0; j + n <= valuesToFilter->size(); j += n) {
+            InmemoryIterator *itr = getIterator(*l, *posToFilter,
+                                                &valuesToFilter->at(j),
+                                                sortFields);
+            while (itr->hasNext()) {
+                itr->next();
+                for (uint8_t i = 0; i < npos; ++i) {
+                    row[i] = itr->getElementAt(pos[i]);
+                }
+                outputTable->addRow(row.data());
+            }
+            delete itr;
+        }
+    }
+}
+
+size_t InmemoryTable::estimateCardinality(const Literal &query) {
+    InmemoryIterator *itr = getIterator(query, std::vector<uint8_t>(), NULL,
+                                        std::vector<uint8_t>());
+    const size_t n = itr->estimateCount();
+    delete itr;
+    return n;
+}
+
+size_t InmemoryTable::getCardinality(const Literal &query) {
+    InmemoryIterator *itr = getIterator(query, std::vector<uint8_t>(), NULL,
+                                        std::vector<uint8_t>());
+    const size_t n = itr->count();
+    delete itr;
+    return n;
+}
+
+size_t InmemoryTable::getCardinalityColumn(const Literal &query,
+        uint8_t posColumn) {
+    if (!query.getTermAtPos(posColumn).isVariable()) {
+        return isEmpty(query, NULL, NULL) ? 0 : 1;
+    }
+    //Sort by the column and count the distinct values
+    std::vector<uint8_t> posVars = query.getPosVars();
+    std::vector<uint8_t> sortFields;
+    for (uint8_t i = 0; i < posVars.size(); ++i) {
+        if (posVars[i] == posColumn) {
+            sortFields.push_back(i);
+            break;
+        }
+    }
+    InmemoryIterator *itr = getIterator(query, std::vector<uint8_t>(), NULL,
+                                        sortFields);
+    itr->skipDuplicatedFirstColumn();
+    const size_t n = itr->count();
+    delete itr;
+    return n;
+}
+
+bool InmemoryTable::isEmpty(const Literal &query,
+                            std::vector<uint8_t> *posToFilter,
+                            std::vector<Term_t> *valuesToFilter) {
+    if (posToFilter == NULL || posToFilter->size() == 0) {
+        return !exists(query, std::vector<uint8_t>(), NULL);
+    }
+    return !exists(query, *posToFilter, valuesToFilter->data());
+}
+
+EDBIterator *InmemoryTable::getIterator(const Literal &query) {
+    return getIterator(query, std::vector<uint8_t>(), NULL,
+                       std::vector<uint8_t>());
+}
+
+EDBIterator *InmemoryTable::getSortedIterator(const Literal &query,
+        const std::vector<uint8_t> &fields) {
+    return getIterator(query, std::vector<uint8_t>(), NULL, fields);
+}
+
+void InmemoryTable::releaseIterator(EDBIterator *itr) {
+    delete itr;
+}
+
+bool InmemoryTable::getDictNumber(const char *text, const size_t sizeText,
+                                  uint64_t &id) {
+    SimpleHashmap::iterator itr = dict->getMap().find(std::string(text, sizeText));
+    if (itr == dict->getMap().end()) {
+        return false;
+    }
+    id = itr->second;
+    return true;
+}
+
+bool InmemoryTable::getDictText(const uint64_t id, char *text) {
+    std::string value = dict->getRawValue(id);
+    if (value == "") {
+        return false;
+    }
+    memcpy(text, value.c_str(), value.size() + 1);
+    return true;
+}
+
+uint64_t InmemoryTable::getNTerms() {
+    //The ids start from 1
+    return dict->size() + 1;
+}
@@ -0,0 +1,372 @@
+#include <vlog/inmemory/mmaptable.h>
+#include <vlog/edb.h>
+#include <vlog/concepts.h>
+
+#include <kognac/consts.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+namespace fs = boost::filesystem;
+
+#define MMAP_BLOCKSIZE 4096
+
+/***** MmapFile *****/
+
+MmapFile::MmapFile(std::string path) : data(NULL), size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        BOOST_LOG_TRIVIAL(error) << "The file " << path << " cannot be opened. Check the edb.conf file.";
+        throw 10;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        BOOST_LOG_TRIVIAL(error) << "Failed fstat on " << path;
+        throw 10;
+    }
+    size = st.st_size;
+    if (size > 0) {
+        void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            BOOST_LOG_TRIVIAL(error) << "Failed mmap on " << path;
+            throw 10;
+        }
+        data = (const char*) addr;
+    }
+    //The mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+MmapFile::~MmapFile() {
+    if (data != NULL) {
+        munmap((void*) data, size);
+    }
+}
+
+/***** MmapDictionary *****/
+
+MmapDictionary::MmapDictionary(std::string path) : file(path) {
+    const uint64_t *header = (const uint64_t*) file.getData();
+    if (file.getSize() < 24 || memcmp(file.getData(), "VLOGDIC1", 8) != 0) {
+        BOOST_LOG_TRIVIAL(error) << "The file " << path << " is not a dictionary created by convert";
+        throw 10;
+    }
+    nterms = header[1];
+    maxid = header[2];
+    ids = header + 3;
+    offsets = ids + nterms;
+    bytext = offsets + nterms + 1;
+    blob = (const char*) (bytext + nterms);
+    if (blob + offsets[nterms] > file.getData() + file.getSize()) {
+        BOOST_LOG_TRIVIAL(error) << "The dictionary " << path << " is truncated";
+        throw 10;
+    }
+}
+
+int MmapDictionary::cmpText(const uint64_t idx, const char *text,
+                            const size_t sizeText) const {
+    const size_t len = offsets[idx + 1] - offsets[idx];
+    const int r = memcmp(blob + offsets[idx], text, std::min(len, sizeText));
+    if (r != 0) {
+        return r;
+    }
+    return len < sizeText ? -1 : (len > sizeText ? 1 : 0);
+}
+
+bool MmapDictionary::getDictNumber(const char *text, const size_t sizeText,
+                                   uint64_t &id) const {
+    size_t first = 0;
+    size_t len = nterms;
+    while (len > 0) {
+        const size_t half = len / 2;
+        if (cmpText(bytext[first + half], text, sizeText) < 0) {
+            first += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+    if (first < nterms && cmpText(bytext[first], text, sizeText) == 0) {
+        id = ids[bytext[first]];
+        return true;
+    }
+    return false;
+}
+
+bool MmapDictionary::getDictText(const uint64_t id, char *text) const {
+    const uint64_t *pos = std::lower_bound(ids, ids + nterms, id);
+    if (pos == ids + nterms || *pos != id) {
+        return false;
+    }
+    const size_t idx = pos - ids;
+    const size_t len = offsets[idx + 1] - offsets[idx];
+    memcpy(text, blob + offsets[idx], len);
+    text[len] = '\0';
+    return true;
+}
+
+/***** MmapTable *****/
+
+MmapTable::MmapTable(PredId_t predid, std::string path,
+                     std::shared_ptr<MmapDictionary> dict) :
+    InmemoryTable(predid), dict(dict) {
+    file = std::unique_ptr<MmapFile>(new MmapFile(path));
+    const uint64_t *header = (const uint64_t*) file->getData();
+    if (file->getSize() < 40 || memcmp(file->getData(), "VLOGREL1", 8) != 0) {
+        BOOST_LOG_TRIVIAL(error) << "The file " << path << " is not a relation created by convert";
+        throw 10;
+    }
+    arity = (uint8_t) header[1];
+    nrows = header[2];
+    const uint64_t nperms = header[3];
+    const uint64_t blockSize = header[4];
+    const size_t nblocks = (nrows + blockSize - 1) / blockSize;
+
+    const uint64_t *p = header + 5;
+    for (uint64_t i = 0; i < nperms; ++i) {
+        InmemoryPermutation perm;
+        for (uint8_t j = 0; j < arity; ++j) {
+            perm.order.push_back((uint8_t) *p++);
+        }
+        for (uint8_t j = 0; j < arity; ++j) {
+            perm.columns.push_back((const Term_t*) p);
+            p += nrows;
+        }
+        perm.blockSize = blockSize;
+        perm.nblocks = nblocks;
+        perm.blockMin = (const Term_t*) p;
+        p += arity * nblocks;
+        perm.blockMax = (const Term_t*) p;
+        p += arity * nblocks;
+        permutations.push_back(perm);
+    }
+    if ((const char*) p > file->getData() + file->getSize()) {
+        BOOST_LOG_TRIVIAL(error) << "The relation " << path << " is truncated";
+        throw 10;
+    }
+    //All the common orders are on disk already
+    scanWithoutIndex = true;
+    BOOST_LOG_TRIVIAL(debug) << "Mapped " << path << ": " << nrows <<
+                             " rows, " << nperms << " permutations";
+}
+
+bool MmapTable::getDictNumber(const char *text, const size_t sizeText,
+                              uint64_t &id) {
+    return dict->getDictNumber(text, sizeText, id);
+}
+
+bool MmapTable::getDictText(const uint64_t id, char *text) {
+    return dict->getDictText(id, text);
+}
+
+uint64_t MmapTable::getNTerms() {
+    return dict->getNTerms();
+}
+
+void MmapTable::writePermutation(std::ofstream &out,
+                                 const std::vector<std::vector<Term_t>> &rows,
+                                 const std::vector<uint8_t> &order,
+                                 const size_t blockSize) {
+    const size_t nrows = rows.empty() ? 0 : rows[0].size();
+    const uint8_t arity = (uint8_t) rows.size();
+    std::vector<uint64_t> idx(nrows);
+    for (size_t i = 0; i < nrows; ++i) {
+        idx[i] = i;
+    }
+    std::sort(idx.begin(), idx.end(), [&](const uint64_t r1, const uint64_t r2) {
+        for (const auto c : order) {
+            if (rows[c][r1] != rows[c][r2]) {
+                return rows[c][r1] < rows[c][r2];
+            }
+        }
+        return false;
+    });
+
+    for (const auto c : order) {
+        const uint64_t v = c;
+        out.write((const char*) &v, 8);
+    }
+    const size_t nblocks = (nrows + blockSize - 1) / blockSize;
+    std::vector<Term_t> blockMin(arity * nblocks);
+    std::vector<Term_t> blockMax(arity * nblocks);
+    std::vector<Term_t> column(nrows);
+    for (uint8_t c = 0; c < arity; ++c) {
+        for (size_t i = 0; i < nrows; ++i) {
+            const Term_t v = rows[c][idx[i]];
+            column[i] = v;
+            const size_t b = c * nblocks + i / blockSize;
+            if (i % blockSize == 0 || v < blockMin[b])
+                blockMin[b] = v;
+            if (i % blockSize == 0 || v > blockMax[b])
+                blockMax[b] = v;
+        }
+        out.write((const char*) column.data(), sizeof(Term_t) * nrows);
+    }
+    out.write((const char*) blockMin.data(), sizeof(Term_t) * blockMin.size());
+    out.write((const char*) blockMax.data(), sizeof(Term_t) * blockMax.size());
+}
+
+void MmapTable::convertRelation(EDBLayer &layer, const PredId_t predid,
+                                const uint8_t arity, std::string path) {
+    //Read all the rows with a literal of only variables
+    VTuple tuple(arity);
+    for (uint8_t i = 0; i < arity; ++i) {
+        tuple.set(VTerm(i + 1, 0), i);
+    }
+    Literal query(layer.getDBPredicate(predid), tuple);
+    std::vector<std::vector<Term_t>> rows(arity);
+    EDBIterator *itr = layer.getIterator(query);
+    while (itr->hasNext()) {
+        itr->next();
+        for (uint8_t i = 0; i < arity; ++i) {
+            rows[i].push_back(itr->getElementAt(i));
+        }
+    }
+    layer.releaseIterator(itr);
+
+    //Remove the duplicates
+    size_t nrows = arity > 0 ? rows[0].size() : 0;
+    std::vector<uint8_t> order;
+    for (uint8_t i = 0; i < arity; ++i) {
+        order.push_back(i);
+    }
+    std::vector<uint64_t> idx(nrows);
+    for (size_t i = 0; i < nrows; ++i) {
+        idx[i] = i;
+    }
+    auto less = [&](const uint64_t r1, const uint64_t r2) {
+        for (const auto c : order) {
+            if (rows[c][r1] != rows[c][r2]) {
+                return rows[c][r1] < rows[c][r2];
+            }
+        }
+        return false;
+    };
+    std::sort(idx.begin(), idx.end(), less);
+    std::vector<std::vector<Term_t>> unique(arity);
+    for (size_t i = 0; i < nrows; ++i) {
+        if (i == 0 || less(idx[i - 1], idx[i])) {
+            for (uint8_t j = 0; j < arity; ++j) {
+                unique[j].push_back(rows[j][idx[i]]);
+            }
+        }
+    }
+    rows.swap(unique);
+    unique.clear();
+    nrows = arity > 0 ? rows[0].size() : 0;
+
+    //All the orders for small arities, otherwise one starting with each column
+    std::vector<std::vector<uint8_t>> orders;
+    if (arity <= 3) {
+        do {
+            orders.push_back(order);
+        } while (std::next_permutation(order.begin(), order.end()));
+    } else {
+        for (uint8_t c = 0; c < arity; ++c) {
+            std::vector<uint8_t> o;
+            o.push_back(c);
+            for (uint8_t j = 0; j < arity; ++j) {
+                if (j != c)
+                    o.push_back(j);
+            }
+            orders.push_back(o);
+        }
+    }
+
+    std::ofstream out(path, std::ios_base::binary);
+    out.write("VLOGREL1", 8);
+    const uint64_t header[4] = {arity, nrows, orders.size(), MMAP_BLOCKSIZE};
+    out.write((const char*) header, sizeof(header));
+    for (const auto &o : orders) {
+        writePermutation(out, rows, o, MMAP_BLOCKSIZE);
+    }
+    out.close();
+    if (!out) {
+        BOOST_LOG_TRIVIAL(error) << "Failed writing " << path;
+        throw 10;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Written " << path << ": " << nrows <<
+                            " rows, " << orders.size() << " permutations";
+}
+
+void MmapTable::convertDictionary(EDBLayer &layer, std::string path) {
+    const uint64_t n = layer.getNTerms();
+    std::vector<uint64_t> ids;
+    std::vector<uint64_t> offsets;
+    std::string blob;
+    char text[MAX_TERM_SIZE];
+    offsets.push_back(0);
+    for (uint64_t id = 0; id < n; ++id) {
+        if (layer.getDictText(id, text)) {
+            ids.push_back(id);
+            blob.append(text);
+            offsets.push_back(blob.size());
+        }
+    }
+    //Pad the blob to a multiple of 8 bytes
+    blob.resize((blob.size() + 7) / 8 * 8, '\0');
+
+    std::vector<uint64_t> bytext(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        bytext[i] = i;
+    }
+    std::sort(bytext.begin(), bytext.end(), [&](const uint64_t i1, const uint64_t i2) {
+        const size_t l1 = offsets[i1 + 1] - offsets[i1];
+        const size_t l2 = offsets[i2 + 1] - offsets[i2];
+        const int r = memcmp(blob.data() + offsets[i1], blob.data() + offsets[i2],
+                             std::min(l1, l2));
+        return r < 0 || (r == 0 && l1 < l2);
+    });
+
+    std::ofstream out(path, std::ios_base::binary);
+    out.write("VLOGDIC1", 8);
+    const uint64_t header[2] = {ids.size(), ids.empty() ? 0 : ids.back()};
+    out.write((const char*) header, sizeof(header));
+    out.write((const char*) ids.data(), 8 * ids.size());
+    out.write((const char*) offsets.data(), 8 * offsets.size());
+    out.write((const char*) bytext.data(), 8 * bytext.size());
+    out.write(blob.data(), blob.size());
+    out.close();
+    if (!out) {
+        BOOST_LOG_TRIVIAL(error) << "Failed writing " << path;
+        throw 10;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Written the dictionary with " << ids.size() <<
+                            " terms";
+}
+
+void MmapTable::convert(EDBLayer &layer, std::string outdir) {
+    if (!fs::exists(outdir)) {
+        fs::create_directories(outdir);
+    }
+    convertDictionary(layer, outdir + "/dict.bin");
+
+    Dictionary preds(layer.getPredDictionary());
+    std::ofstream conf(outdir + "/edb.conf");
+    int i = 0;
+    for (const auto &p : preds.getMap()) {
+        const PredId_t predid = (PredId_t) p.second;
+        if (layer.getEDBTable(predid) == NULL) {
+            continue;
+        }
+        const uint8_t arity = layer.getDBPredicate(predid).getCardinality();
+        convertRelation(layer, predid, arity, outdir + "/" + p.first + ".rel");
+        conf << "EDB" << i << "_predname=" << p.first << std::endl;
+        conf << "EDB" << i << "_type=MMAP" << std::endl;
+        conf << "EDB" << i << "_param0=" << fs::absolute(outdir).string() <<
+             std::endl;
+        conf << "EDB" << i << "_param1=" << p.first << std::endl;
+        i++;
+    }
+}
@@ -122,7 +122,8 @@ MAPIIterator::MAPIIterator(Mapi con, string sqlQuery,
 
     handle = MAPITable::doquery(con, sqlQuery);
 
-    columns = fieldsTable.size();
+    //Aggregates and projections do not return one column per field
+    columns = mapi_get_field_count(handle);
     values = new uint64_t[columns];
     for (int i = 0; i < columns; i++) {
 	mapi_bind_var(handle, i, MAPI_ULONGLONG, &values[i]); 
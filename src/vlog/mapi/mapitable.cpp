@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 
 MapiHdl MAPITable::doquery(Mapi dbh, string q) { 
@@ -49,7 +50,8 @@ void MAPITable::update(Mapi dbh, string q) {
 }
 
 MAPITable::MAPITable(string host, int port, string user, string pwd, string dbname,
-                       string tablename, string tablefields) {
+                       string tablename, string tablefields,
+                       string statistics) {
 
     this->tablename = tablename;
     con = mapi_connect(host.c_str(), port, user.c_str(), pwd.c_str(), "sql", dbname.c_str()); 
@@ -58,6 +60,18 @@ MAPITable::MAPITable(string host, int port, string user, string pwd, string dbna
 	mapi_destroy(con); 
 	throw 10;
     }
+    pool = std::unique_ptr<ConnectionPool<Mapi>>(
+            new ConnectionPool<Mapi>([host, port, user, pwd, dbname]() {
+                Mapi c = mapi_connect(host.c_str(), port, user.c_str(), pwd.c_str(), "sql", dbname.c_str());
+                if (mapi_error(c)) {
+                    mapi_explain(c, stderr);
+                    mapi_destroy(c);
+                    throw 10;
+                }
+                return c;
+            }, [](Mapi c) {
+                mapi_destroy(c);
+            }));
 
     //Extract fields
     std::stringstream ss(tablefields);
@@ -65,6 +79,25 @@ MAPITable::MAPITable(string host, int port, string user, string pwd, string dbna
     while (std::getline(ss, item, ',')) {
         this->fieldTables.push_back(item);
     }
+    initStatistics(statistics);
+}
+
+void MAPITable::executeUpdate(const string &sql) {
+    BOOST_LOG_TRIVIAL(debug) << "SQL update: " << sql;
+    update(con, sql);
+}
+
+EDBIterator *MAPITable::executeQuery(const string &sql, const Literal &query,
+                                     const uint8_t ncolumns) {
+    //The iterator binds one variable per column of the result set
+    return new MAPIIterator(con, sql, fieldTables, query);
+}
+
+EDBIterator *MAPITable::executePooledQuery(const string &sql,
+        const Literal &query, const uint8_t ncolumns) {
+    Mapi c = pool->acquire();
+    return new PooledIterator<Mapi>(pool.get(), c,
+            new MAPIIterator(c, sql, fieldTables, query));
 }
 
 // If valuesToFilter is larger than this, use a temporary table instead of a test on the individual values
@@ -213,7 +246,7 @@ void MAPITable::query(QSQQuery *query, TupleTable *outputTable,
     }
 }
 
-size_t MAPITable::getCardinality(const Literal &q) {
+size_t MAPITable::exactCardinality(const Literal &q) {
     string query = "SELECT COUNT(*) as c from " + tablename;
 
     string cond = literalConstraintsToSQLQuery(q, fieldTables);
@@ -233,7 +266,7 @@ size_t MAPITable::getCardinality(const Literal &q) {
     return (size_t) result;
 }
 
-size_t MAPITable::getCardinalityColumn(const Literal &q, uint8_t posColumn) {
+size_t MAPITable::exactCardinalityColumn(const Literal &q, uint8_t posColumn) {
     
     string query = "SELECT COUNT(DISTINCT " + fieldTables[posColumn] + ") as c from " + tablename;
 
@@ -288,11 +321,19 @@ bool MAPITable::isEmpty(const Literal &q, std::vector<uint8_t> *posToFilter,
 }
 
 EDBIterator *MAPITable::getIterator(const Literal &query) {
+    EDBIterator *itr = partitionedScan(query, NULL, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new MAPIIterator(con, tablename, query, fieldTables, NULL);
 }
 
 EDBIterator *MAPITable::getSortedIterator(const Literal &query,
         const std::vector<uint8_t> &fields) {
+    EDBIterator *itr = partitionedScan(query, &fields, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new MAPIIterator(con, tablename, query, fieldTables, &fields);
 }
 
@@ -324,6 +365,30 @@ bool MAPITable::getDictText(const uint64_t id, char *text) {
     return false;
 }
 
+void MAPITable::getDictTexts(const std::vector<uint64_t> &ids,
+                             std::vector<std::string> &texts,
+                             std::vector<bool> &found) {
+    std::unordered_map<uint64_t, string> results;
+    size_t end;
+    for (size_t start = 0; start < ids.size(); start = end) {
+        string query = dictTextsQuery(ids, start, end);
+        MapiHdl handle = doquery(con, query);
+        while (mapi_fetch_row(handle)) {
+            char *p;
+            const uint64_t id = strtoull(mapi_fetch_field(handle, 0), &p, 10);
+            results[id] = string(mapi_fetch_field(handle, 1));
+        }
+        mapi_close_handle(handle);
+    }
+    texts.resize(ids.size());
+    found.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto itr = results.find(ids[i]);
+        found[i] = itr != results.end();
+        texts[i] = found[i] ? itr->second : string();
+    }
+}
+
 uint64_t MAPITable::getNTerms() {
     string query = "SELECT COUNT(*) as c from dict";
     MapiHdl handle = doquery(con, query);
@@ -336,5 +401,6 @@ uint64_t MAPITable::getNTerms() {
 }
 
 MAPITable::~MAPITable() {
+    pool.reset();
     mapi_destroy(con);
 }
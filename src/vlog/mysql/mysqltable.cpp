@@ -10,15 +10,27 @@
 
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 
 MySQLTable::MySQLTable(string host, string user, string pwd, string dbname,
-                       string tablename, string tablefields) {
+                       string tablename, string tablefields,
+                       string statistics) {
     con = NULL;
     this->tablename = tablename;
     driver = get_driver_instance();
     con = driver->connect(host, user, pwd);
     con->setSchema(dbname);
+    sql::Driver *d = driver;
+    pool = std::unique_ptr<ConnectionPool<sql::Connection*>>(
+            new ConnectionPool<sql::Connection*>([d, host, user, pwd, dbname]() {
+                sql::Connection *c = d->connect(host, user, pwd);
+                c->setSchema(dbname);
+                return c;
+            }, [](sql::Connection *c) {
+                c->close();
+                delete c;
+            }));
 
     //Extract fields
     std::stringstream ss(tablefields);
@@ -26,6 +38,28 @@ MySQLTable::MySQLTable(string host, string user, string pwd, string dbname,
     while (std::getline(ss, item, ',')) {
         this->fieldTables.push_back(item);
     }
+    initStatistics(statistics);
+}
+
+void MySQLTable::executeUpdate(const string &sql) {
+    sql::Statement *stmt = con->createStatement();
+    BOOST_LOG_TRIVIAL(debug) << "SQL update: " << sql;
+    MYSQLCALL(stmt->execute(sql))
+    delete stmt;
+}
+
+EDBIterator *MySQLTable::executeQuery(const string &sql, const Literal &query,
+                                      const uint8_t ncolumns) {
+    return new MySQLIterator(con, sql, query);
+}
+
+EDBIterator *MySQLTable::executePooledQuery(const string &sql,
+        const Literal &query, const uint8_t ncolumns) {
+    //The client library needs to know the threads that use it
+    driver->threadInit();
+    sql::Connection *c = pool->acquire();
+    return new PooledIterator<sql::Connection*>(pool.get(), c,
+            new MySQLIterator(c, sql, query));
 }
 
 // If valuesToFilter is larger than this, use a temporary table instead of a test on the individual values
@@ -173,7 +207,7 @@ void MySQLTable::query(QSQQuery *query, TupleTable *outputTable,
     }
 }
 
-size_t MySQLTable::getCardinality(const Literal &q) {
+size_t MySQLTable::exactCardinality(const Literal &q) {
     string query = "SELECT COUNT(*) as c from " + tablename;
 
     string cond = literalConstraintsToSQLQuery(q, fieldTables);
@@ -194,7 +228,7 @@ size_t MySQLTable::getCardinality(const Literal &q) {
     return card;
 }
 
-size_t MySQLTable::getCardinalityColumn(const Literal &q, uint8_t posColumn) {
+size_t MySQLTable::exactCardinalityColumn(const Literal &q, uint8_t posColumn) {
     
     string query = "SELECT COUNT(DISTINCT " + fieldTables[posColumn] + ") as c from " + tablename;
 
@@ -232,31 +266,38 @@ bool MySQLTable::isEmpty(const Literal &q, std::vector<uint8_t> *posToFilter,
 		to_string(valuesToFilter->at(i));
     }
 
-    string query = "SELECT COUNT(*) as c from " + tablename;
+    //Stop at the first matching row instead of counting all of them
+    string query = "SELECT 1 from " + tablename;
 
     if (cond != "") {
 	query += " WHERE " + cond;
     }
+    query += " LIMIT 1";
 
     sql::Statement *stmt;
     stmt = con->createStatement();
     sql::ResultSet *res = stmt->executeQuery(query);
-    size_t card = 0;
-    if (res->first()) {
-	card = res->getInt(1);
-    }
-    BOOST_LOG_TRIVIAL(debug) << "SQL Query: " << query << ", in isEmpty, cardinality = " << card;
+    const bool empty = !res->first();
+    BOOST_LOG_TRIVIAL(debug) << "SQL Query: " << query << ", in isEmpty, empty = " << empty;
     delete res;
     delete stmt;
-    return card == 0;
+    return empty;
 }
 
 EDBIterator *MySQLTable::getIterator(const Literal &query) {
+    EDBIterator *itr = partitionedScan(query, NULL, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new MySQLIterator(con, tablename, query, fieldTables, NULL);
 }
 
 EDBIterator *MySQLTable::getSortedIterator(const Literal &query,
         const std::vector<uint8_t> &fields) {
+    EDBIterator *itr = partitionedScan(query, &fields, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new MySQLIterator(con, tablename, query, fieldTables, &fields);
 }
 
@@ -295,6 +336,31 @@ bool MySQLTable::getDictText(const uint64_t id, char *text) {
     return resp;
 }
 
+void MySQLTable::getDictTexts(const std::vector<uint64_t> &ids,
+                              std::vector<std::string> &texts,
+                              std::vector<bool> &found) {
+    std::unordered_map<uint64_t, string> results;
+    size_t end;
+    for (size_t start = 0; start < ids.size(); start = end) {
+        string query = dictTextsQuery(ids, start, end);
+        sql::Statement *stmt;
+        stmt = con->createStatement();
+        sql::ResultSet *res = stmt->executeQuery(query);
+        while (res->next()) {
+            results[res->getUInt64(1)] = res->getString(2);
+        }
+        delete res;
+        delete stmt;
+    }
+    texts.resize(ids.size());
+    found.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto itr = results.find(ids[i]);
+        found[i] = itr != results.end();
+        texts[i] = found[i] ? itr->second : string();
+    }
+}
+
 uint64_t MySQLTable::getNTerms() {
     string query = "SELECT COUNT(*) as c from dict";
     sql::Statement *stmt;
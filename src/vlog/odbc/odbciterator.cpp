@@ -1,6 +1,40 @@
 #include <vlog/odbc/odbciterator.h>
 #include <vlog/odbc/odbctable.h>
 
+void ODBCIterator::execute(SQLHANDLE con, string sqlQuery) {
+    ODBCTable::check(SQLAllocHandle(SQL_HANDLE_STMT, con, &stmt), "allocate statement handle");
+    //Fetch blocks of rows, bound column by column
+    rowsFetched = 0;
+    currentRow = 0;
+    ODBCTable::check(SQLSetStmtAttr(stmt, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER) SQL_BIND_BY_COLUMN, 0), "SQLSetStmtAttr");
+    ODBCTable::check(SQLSetStmtAttr(stmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER) ODBC_ROWSET_SIZE, 0), "SQLSetStmtAttr");
+    ODBCTable::check(SQLSetStmtAttr(stmt, SQL_ATTR_ROWS_FETCHED_PTR, &rowsFetched, 0), "SQLSetStmtAttr");
+    ODBCTable::check(SQLExecDirectA(stmt, (SQLCHAR *) sqlQuery.c_str(), SQL_NTS), "execute query");
+    SQLNumResultCols(stmt, &columns);
+    indicator = new SQLLEN[columns * ODBC_ROWSET_SIZE];
+    values = new SQLUBIGINT[columns * ODBC_ROWSET_SIZE];
+    for (int i = 0; i < columns; i++) {
+	ODBCTable::check(SQLBindCol(stmt, i + 1, SQL_C_UBIGINT, &values[i * ODBC_ROWSET_SIZE], sizeof(SQLUBIGINT), &indicator[i * ODBC_ROWSET_SIZE]), "SQLBindCol");
+    }
+    hasNextValue = fetchRow();
+    hasNextChecked = true;
+}
+
+bool ODBCIterator::fetchRow() {
+    if (currentRow + 1 < rowsFetched) {
+	currentRow++;
+	return true;
+    }
+    SQLRETURN ret = SQLFetch(stmt);
+    ODBCTable::check(ret, "SQLFetch");
+    currentRow = 0;
+    if (ret == SQL_NO_DATA) {
+	rowsFetched = 0;
+	return false;
+    }
+    return rowsFetched > 0;
+}
+
 ODBCIterator::ODBCIterator(SQLHANDLE con, string tableName,
                              const Literal &query,
                              const std::vector<string> &fieldsTable,
@@ -80,18 +114,7 @@ ODBCIterator::ODBCIterator(SQLHANDLE con, string tableName,
 
     BOOST_LOG_TRIVIAL(debug) << "SQL query: " << sqlQuery;
 
-    ODBCTable::check(SQLAllocHandle(SQL_HANDLE_STMT, con, &stmt), "allocate statement handle");
-    ODBCTable::check(SQLExecDirectA(stmt, (SQLCHAR *) sqlQuery.c_str(), SQL_NTS), "execute query");
-    SQLNumResultCols(stmt, &columns);
-    indicator = new SQLLEN[columns];
-    values = new SQLUBIGINT[columns];
-    for (int i = 0; i < columns; i++) {
-	ODBCTable::check(SQLBindCol(stmt, i + 1, SQL_C_UBIGINT, &values[i], sizeof(SQLUBIGINT), &indicator[i]), "SQLBindCol");
-    }
-    SQLRETURN ret = SQLFetch(stmt);
-    ODBCTable::check(ret, "SQLFetch");
-    hasNextValue = ret != SQL_NO_DATA;
-    hasNextChecked = true;
+    execute(con, sqlQuery);
 }
 
 
@@ -119,18 +142,7 @@ ODBCIterator::ODBCIterator(SQLHANDLE con, string sqlQuery,
 
     BOOST_LOG_TRIVIAL(debug) << "SQL query: " << sqlQuery;
 
-    ODBCTable::check(SQLAllocHandle(SQL_HANDLE_STMT, con, &stmt), "allocate statement handle");
-    ODBCTable::check(SQLExecDirectA(stmt, (SQLCHAR *) sqlQuery.c_str(), SQL_NTS), "execute query");
-    SQLNumResultCols(stmt, &columns);
-    indicator = new SQLLEN[columns];
-    values = new SQLUBIGINT[columns];
-    for (int i = 0; i < columns; i++) {
-	ODBCTable::check(SQLBindCol(stmt, i + 1, SQL_C_UBIGINT, &values[i], sizeof(SQLUBIGINT), &indicator[i]), "SQLBindCol");
-    }
-    SQLRETURN ret = SQLFetch(stmt);
-    ODBCTable::check(ret, "SQLFetch");
-    hasNextValue = ret != SQL_NO_DATA;
-    hasNextChecked = true;
+    execute(con, sqlQuery);
 }
 
 
@@ -140,16 +152,12 @@ bool ODBCIterator::hasNext() {
 	return hasNextValue;
     }
     if (isFirst || ! skipDuplicatedFirst) {
-	SQLRETURN ret = SQLFetch(stmt);
-	ODBCTable::check(ret, "SQLFetch");
-	hasNextValue = ret != SQL_NO_DATA;
+	hasNextValue = fetchRow();
     } else {
 	Term_t oldval = getElementAt(posFirstVar);
 	bool stop = false;
 	while (! stop) {
-	    SQLRETURN ret = SQLFetch(stmt);
-	    ODBCTable::check(ret, "SQLFetch");
-	    hasNextValue = ret != SQL_NO_DATA;
+	    hasNextValue = fetchRow();
 	    if (hasNextValue) {
 		if (getElementAt(posFirstVar) != oldval) {
 		    stop = true;
@@ -179,8 +187,8 @@ void ODBCIterator::next() {
 
 void ODBCIterator::clear() {
     if (indicator != NULL) {
-	delete indicator;
-	delete values;
+	delete[] indicator;
+	delete[] values;
 	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
     }
     indicator = NULL;
@@ -195,8 +203,9 @@ void ODBCIterator::skipDuplicatedFirstColumn() {
 
 Term_t ODBCIterator::getElementAt(const uint8_t p) {
     // BOOST_LOG_TRIVIAL(debug) << "ODBCIterator::getElementAt()";
-    if (indicator[p] != SQL_NULL_DATA) {
-	return values[p];
+    const size_t idx = p * ODBC_ROWSET_SIZE + currentRow;
+    if (indicator[idx] != SQL_NULL_DATA) {
+	return values[idx];
     }
     throw 10;
 }
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 
 void ODBCTable::check(SQLRETURN rc, string msg) {
@@ -18,13 +19,25 @@ void ODBCTable::check(SQLRETURN rc, string msg) {
 }
 
 ODBCTable::ODBCTable(string user, string pwd, string dbname,
-                       string tablename, string tablefields) {
+                       string tablename, string tablefields,
+                       string statistics) {
 
     this->tablename = tablename;
     check(SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &env), "allocate environment handle");
     check(SQLSetEnvAttr(env, SQL_ATTR_ODBC_VERSION, (SQLPOINTER) SQL_OV_ODBC3, 0), "setting ODBC version");
     check(SQLAllocHandle(SQL_HANDLE_DBC, env, &con), "allocate connection handle");
     check(SQLConnectA(con, (SQLCHAR *) dbname.c_str(), SQL_NTS, (SQLCHAR *) user.c_str(), SQL_NTS, (SQLCHAR *) pwd.c_str(), SQL_NTS), "connect");
+    SQLHANDLE e = env;
+    pool = std::unique_ptr<ConnectionPool<SQLHANDLE>>(
+            new ConnectionPool<SQLHANDLE>([e, user, pwd, dbname]() {
+                SQLHANDLE c;
+                check(SQLAllocHandle(SQL_HANDLE_DBC, e, &c), "allocate connection handle");
+                check(SQLConnectA(c, (SQLCHAR *) dbname.c_str(), SQL_NTS, (SQLCHAR *) user.c_str(), SQL_NTS, (SQLCHAR *) pwd.c_str(), SQL_NTS), "connect");
+                return c;
+            }, [](SQLHANDLE c) {
+                SQLDisconnect(c);
+                SQLFreeHandle(SQL_HANDLE_DBC, c);
+            }));
 
     //Extract fields
     std::stringstream ss(tablefields);
@@ -32,6 +45,27 @@ ODBCTable::ODBCTable(string user, string pwd, string dbname,
     while (std::getline(ss, item, ',')) {
         this->fieldTables.push_back(item);
     }
+    initStatistics(statistics);
+}
+
+void ODBCTable::executeUpdate(const string &sql) {
+    SQLHANDLE stmt;
+    check(SQLAllocHandle(SQL_HANDLE_STMT, con, &stmt), "allocate statement handle");
+    BOOST_LOG_TRIVIAL(debug) << "SQL update: " << sql;
+    check(SQLExecDirectA(stmt, (SQLCHAR *) sql.c_str(), SQL_NTS), "execute update");
+    SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+}
+
+EDBIterator *ODBCTable::executeQuery(const string &sql, const Literal &query,
+                                     const uint8_t ncolumns) {
+    return new ODBCIterator(con, sql, query);
+}
+
+EDBIterator *ODBCTable::executePooledQuery(const string &sql,
+        const Literal &query, const uint8_t ncolumns) {
+    SQLHANDLE c = pool->acquire();
+    return new PooledIterator<SQLHANDLE>(pool.get(), c,
+            new ODBCIterator(c, sql, query));
 }
 
 // If valuesToFilter is larger than this, use a temporary table instead of a test on the individual values
@@ -194,7 +228,7 @@ void ODBCTable::query(QSQQuery *query, TupleTable *outputTable,
     }
 }
 
-size_t ODBCTable::getCardinality(const Literal &q) {
+size_t ODBCTable::exactCardinality(const Literal &q) {
     string query = "SELECT COUNT(*) as c from " + tablename;
 
     string cond = literalConstraintsToSQLQuery(q, fieldTables);
@@ -215,7 +249,7 @@ size_t ODBCTable::getCardinality(const Literal &q) {
     return (size_t) result;
 }
 
-size_t ODBCTable::getCardinalityColumn(const Literal &q, uint8_t posColumn) {
+size_t ODBCTable::exactCardinalityColumn(const Literal &q, uint8_t posColumn) {
     
     string query = "SELECT COUNT(DISTINCT " + fieldTables[posColumn] + ") as c from " + tablename;
 
@@ -273,11 +307,19 @@ bool ODBCTable::isEmpty(const Literal &q, std::vector<uint8_t> *posToFilter,
 }
 
 EDBIterator *ODBCTable::getIterator(const Literal &query) {
+    EDBIterator *itr = partitionedScan(query, NULL, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new ODBCIterator(con, tablename, query, fieldTables, NULL);
 }
 
 EDBIterator *ODBCTable::getSortedIterator(const Literal &query,
         const std::vector<uint8_t> &fields) {
+    EDBIterator *itr = partitionedScan(query, &fields, false);
+    if (itr != NULL) {
+        return itr;
+    }
     return new ODBCIterator(con, tablename, query, fieldTables, &fields);
 }
 
@@ -314,6 +356,36 @@ bool ODBCTable::getDictText(const uint64_t id, char *text) {
     return SQL_SUCCEEDED(res);
 }
 
+void ODBCTable::getDictTexts(const std::vector<uint64_t> &ids,
+                             std::vector<std::string> &texts,
+                             std::vector<bool> &found) {
+    std::unordered_map<uint64_t, string> results;
+    char text[8192];
+    size_t end;
+    for (size_t start = 0; start < ids.size(); start = end) {
+        string query = dictTextsQuery(ids, start, end);
+        SQLHANDLE stmt;
+        check(SQLAllocHandle(SQL_HANDLE_STMT, con, &stmt), "allocate statement handle");
+        check(SQLExecDirectA(stmt, (SQLCHAR *) query.c_str(), SQL_NTS), "execute query");
+        while (SQL_SUCCEEDED(SQLFetch(stmt))) {
+            SQLLEN numBytes;
+            SQLUBIGINT id;
+            check(SQLGetData(stmt, 1, SQL_C_UBIGINT, &id, sizeof(SQLUBIGINT), &numBytes), "get result");
+            check(SQLGetData(stmt, 2, SQL_C_CHAR, text, 8192, &numBytes), "get result");
+            text[numBytes] = 0;
+            results[(uint64_t) id] = string(text);
+        }
+        SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+    }
+    texts.resize(ids.size());
+    found.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto itr = results.find(ids[i]);
+        found[i] = itr != results.end();
+        texts[i] = found[i] ? itr->second : string();
+    }
+}
+
 uint64_t ODBCTable::getNTerms() {
     string query = "SELECT COUNT(*) as c from dict";
     SQLHANDLE stmt;
@@ -329,6 +401,7 @@ uint64_t ODBCTable::getNTerms() {
 }
 
 ODBCTable::~ODBCTable() {
+    pool.reset();
     SQLDisconnect(con);
     SQLFreeHandle(SQL_HANDLE_DBC, con);
     SQLFreeHandle(SQL_HANDLE_ENV, env);
@@ -522,6 +522,20 @@ TupleIterator *Reasoner::getMagicIterator(Literal &query,
         EDBLayer &edb, Program &program, bool returnOnlyVars,
         std::vector<uint8_t> *sortByFields) {
 
+    //Answers of a previous query that subsumes this one
+    TupleTable *cachedTable = edb.getAnswerCache().get(&program, query,
+                              posJoins, possibleValuesJoins, returnOnlyVars);
+    if (cachedTable != NULL) {
+        BOOST_LOG_TRIVIAL(debug) << "Answers of " << query.tostring(&program, &edb) << " found in the cache";
+        std::shared_ptr<TupleTable> pCachedTable(cachedTable);
+        if (sortByFields != NULL && !sortByFields->empty()) {
+            std::shared_ptr<TupleTable> sortTab = std::shared_ptr<TupleTable>(
+                    pCachedTable->sortBy(*sortByFields));
+            return new TupleTableItr(sortTab);
+        } else {
+            return new TupleTableItr(pCachedTable);
+        }
+    }
 
     //To use if the flag returnOnlyVars is set to false
     uint64_t outputTuple[3];    // Used in trident method, so no Term_t
@@ -666,6 +680,10 @@ TupleIterator *Reasoner::getMagicIterator(Literal &query,
         itr.moveNextCount();
     }
 
+    if (posJoins == NULL) {
+        edb.getAnswerCache().add(&program, query, finalTable, returnOnlyVars);
+    }
+
     std::shared_ptr<TupleTable> pFinalTable(finalTable);
     delete naiver;
 
@@ -880,12 +898,23 @@ TupleIterator *Reasoner::getTopDownIterator(Literal &query,
         }
     }
 
-    QSQQuery rootQuery(query);
-    BOOST_LOG_TRIVIAL(debug) << "QSQQuery = " << rootQuery.tostring();
-    std::unique_ptr<QSQR> evaluator = std::unique_ptr<QSQR>(new QSQR(edb, &program));
-    TupleTable *finalTable;
-    finalTable = evaluator->evaluateQuery(QSQR_EVAL, &rootQuery, newPosJoins.size() > 0 ? &newPosJoins : NULL,
-                                          possibleValuesJoins, returnOnlyVars);
+    //Answers of a previous query that subsumes this one
+    TupleTable *finalTable = edb.getAnswerCache().get(&program, query,
+                             posJoins, possibleValuesJoins, returnOnlyVars);
+    if (finalTable == NULL) {
+        QSQQuery rootQuery(query);
+        BOOST_LOG_TRIVIAL(debug) << "QSQQuery = " << rootQuery.tostring();
+        std::unique_ptr<QSQR> evaluator = std::unique_ptr<QSQR>(new QSQR(edb, &program));
+        evaluator->setNThreads(qsqrThreads);
+        finalTable = evaluator->evaluateQuery(QSQR_EVAL, &rootQuery, newPosJoins.size() > 0 ? &newPosJoins : NULL,
+                                              possibleValuesJoins, returnOnlyVars);
+        if (posJoins == NULL) {
+            edb.getAnswerCache().add(&program, query, finalTable,
+                                     returnOnlyVars);
+        }
+    } else {
+        BOOST_LOG_TRIVIAL(debug) << "Answers of " << query.tostring(&program, &edb) << " found in the cache";
+    }
 
     //Return an iterator of the bindings
     std::shared_ptr<TupleTable> pFinalTable(finalTable);
@@ -1,8 +1,15 @@
 #include <vlog/trident/tridenttable.h>
+#include <vlog/prefetchiterator.h>
 
 #include <trident/sparql/sparqloperators.h>
 #include <trident/binarytables/newcolumntable.h>
 
+#include <boost/thread.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <exception>
+
 void antiJoinOneColumn(int posJoin1, int posJoin2,
                        NewColumnTable *pitr1, NewColumnTable *pitr2,
                        std::shared_ptr<ColumnWriter> col) {
@@ -83,6 +90,7 @@ std::vector<std::shared_ptr<Column>> TridentTable::performAntiJoin(
                                       std::vector<uint8_t> &pos1,
                                       const Literal &l2,
 std::vector<uint8_t> &pos2) {
+    TridentQuerier *tq = getThreadQuerier();
 
     TridentTupleItr itr1, itr2;
 
@@ -93,13 +101,13 @@ std::vector<uint8_t> &pos2) {
     if (pos1.size() == 2) {
         fieldToSort.push_back(l1.getPosVars()[pos1[1]]);
     }
-    itr1.init(q, &t1, &fieldToSort, true, multithreaded ? &mutex : NULL);
+    itr1.init(tq->q, &t1, &fieldToSort, true, getMutex(tq));
     VTuple t2 = l2.getTuple();
     fieldToSort.clear();
     fieldToSort.push_back(l2.getPosVars()[pos2[0]]);
     if (pos2.size() == 2)
         fieldToSort.push_back(l2.getPosVars()[pos2[1]]);
-    itr2.init(q, &t2, &fieldToSort, true, multithreaded ? &mutex : NULL);
+    itr2.init(tq->q, &t2, &fieldToSort, true, getMutex(tq));
 
     //Output
     std::vector<std::shared_ptr<ColumnWriter>> cols;
@@ -149,6 +157,12 @@ std::vector<std::shared_ptr<Column>> TridentTable::performAntiJoin(
                                       std::shared_ptr<Column >> &valuesToCheck,
                                       const Literal &l,
 std::vector<uint8_t> &pos) {
+    if (valuesToCheck[0]->size() >= TRIDENT_ANTIJOIN_PARALLEL_THRESHOLD) {
+        const bool firstCol = pos[0] == 1 || (pos[0] == 0 && l.getNVars() == 2);
+        return parallelAntiJoin(valuesToCheck, l, pos, firstCol);
+    }
+
+    TridentQuerier *tq = getThreadQuerier();
 
     VTuple t = l.getTuple();
     assert(l.getNVars() < l.getTupleSize());
@@ -157,7 +171,7 @@ std::vector<uint8_t> &pos) {
     if (pos.size() == 2)
         fieldToSort.push_back(l.getPosVars()[pos[1]]);
     TridentTupleItr itr;
-    itr.init(q, &t, &fieldToSort, true, multithreaded ? &mutex : NULL);
+    itr.init(tq->q, &t, &fieldToSort, true, getMutex(tq));
 
     //Output
     std::vector<std::shared_ptr<ColumnWriter>> cols;
@@ -365,13 +379,237 @@ std::vector<uint8_t> &pos) {
     return output;
 }
 
+//Values in [begin, end) of the sorted (and possibly duplicated) values that
+//do not appear in the column of pitr
+static void antiJoinPartition(NewColumnTable *pitr, const bool firstCol,
+                              const std::vector<Term_t> &values,
+                              const size_t begin, const size_t end,
+                              ColumnWriter *out) {
+    bool more = pitr->hasNext();
+    if (more) {
+        pitr->next();
+        //Seek to the beginning of the partition
+        Term_t v1 = firstCol ? pitr->getValue1() : pitr->getValue2();
+        if (v1 < values[begin]) {
+            if (firstCol) {
+                pitr->moveto(values[begin], 0);
+            } else {
+                pitr->moveto(pitr->getValue1(), values[begin]);
+            }
+            more = pitr->hasNext();
+            if (more) {
+                pitr->next();
+            }
+        }
+    }
+    for (size_t i = begin; i < end; ++i) {
+        const Term_t v = values[i];
+        if (i > begin && v == values[i - 1]) {
+            continue;
+        }
+        while (more && (firstCol ? pitr->getValue1() : pitr->getValue2()) < v) {
+            more = pitr->hasNext();
+            if (more) {
+                pitr->next();
+            }
+        }
+        if (!more || (firstCol ? pitr->getValue1() : pitr->getValue2()) != v) {
+            out->add(v);
+        }
+    }
+}
+
+static void antiJoinPartition(NewColumnTable *pitr,
+                              const std::vector<Term_t> &values1,
+                              const std::vector<Term_t> &values2,
+                              const size_t begin, const size_t end,
+                              ColumnWriter *out1, ColumnWriter *out2) {
+    bool more = pitr->hasNext();
+    if (more) {
+        pitr->next();
+        if (pitr->getValue1() < values1[begin] ||
+                (pitr->getValue1() == values1[begin] &&
+                 pitr->getValue2() < values2[begin])) {
+            pitr->moveto(values1[begin], values2[begin]);
+            more = pitr->hasNext();
+            if (more) {
+                pitr->next();
+            }
+        }
+    }
+    for (size_t i = begin; i < end; ++i) {
+        const Term_t cv1 = values1[i];
+        const Term_t cv2 = values2[i];
+        if (i > begin && cv1 == values1[i - 1] && cv2 == values2[i - 1]) {
+            continue;
+        }
+        while (more && (pitr->getValue1() < cv1 ||
+                        (pitr->getValue1() == cv1 && pitr->getValue2() < cv2))) {
+            more = pitr->hasNext();
+            if (more) {
+                pitr->next();
+            }
+        }
+        if (!more || pitr->getValue1() != cv1 || pitr->getValue2() != cv2) {
+            out1->add(cv1);
+            out2->add(cv2);
+        }
+    }
+}
+
+//Querier of the pool, given back when it goes out of scope
+struct PooledQuerier {
+    ConnectionPool<TridentQuerier*> *pool;
+    TridentQuerier *tq;
+
+    PooledQuerier(ConnectionPool<TridentQuerier*> *pool) : pool(pool),
+        tq(pool->acquire()) {
+    }
+
+    ~PooledQuerier() {
+        pool->release(tq);
+    }
+};
+
+//Merges every partition of the values to check with the KB. The first
+//exception of a partition is kept and rethrown by the caller
+struct ParallelAntiJoin {
+    ConnectionPool<TridentQuerier*> *pool;
+    VTuple &t;
+    std::vector<uint8_t> &fieldToSort;
+    const size_t ncols;
+    const bool firstCol;
+    const std::vector<std::vector<Term_t>> &values;
+    const std::vector<size_t> &bounds;
+    std::vector<std::vector<std::shared_ptr<ColumnWriter>>> &partCols;
+    //Shared by the copies of the body
+    boost::mutex &mutex;
+    std::exception_ptr &error;
+
+    ParallelAntiJoin(ConnectionPool<TridentQuerier*> *pool, VTuple &t,
+                     std::vector<uint8_t> &fieldToSort, const size_t ncols,
+                     const bool firstCol,
+                     const std::vector<std::vector<Term_t>> &values,
+                     const std::vector<size_t> &bounds,
+                     std::vector<std::vector<std::shared_ptr<ColumnWriter>>> &partCols,
+                     boost::mutex &mutex, std::exception_ptr &error) :
+        pool(pool), t(t), fieldToSort(fieldToSort), ncols(ncols),
+        firstCol(firstCol), values(values), bounds(bounds),
+        partCols(partCols), mutex(mutex), error(error) {
+    }
+
+    void operator()(const tbb::blocked_range<size_t>& r) const {
+        for (size_t p = r.begin(); p != r.end(); ++p) {
+            try {
+                PooledQuerier pq(pool);
+                TridentTupleItr itr;
+                itr.init(pq.tq->q, &t, &fieldToSort, true, NULL);
+                NewColumnTable *pitr = (NewColumnTable*) itr.getPhysicalIterator();
+                if (ncols == 1) {
+                    if (firstCol)
+                        pitr->ignoreSecondColumn();
+                    antiJoinPartition(pitr, firstCol, values[0], bounds[p],
+                                      bounds[p + 1], partCols[p][0].get());
+                } else {
+                    antiJoinPartition(pitr, values[0], values[1], bounds[p],
+                                      bounds[p + 1], partCols[p][0].get(),
+                                      partCols[p][1].get());
+                }
+            } catch (...) {
+                boost::mutex::scoped_lock lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+};
+
+std::vector<std::shared_ptr<Column>> TridentTable::parallelAntiJoin(
+                                      std::vector <
+                                      std::shared_ptr<Column >> &valuesToCheck,
+                                      const Literal &l,
+                                      std::vector<uint8_t> &pos,
+const bool firstCol) {
+    std::vector<std::vector<Term_t>> values;
+    for (auto &col : valuesToCheck) {
+        values.push_back(col->getReader()->asVector());
+    }
+    const size_t n = values[0].size();
+
+    //Partition boundaries. Equal keys stay in the same partition, so that
+    //the duplicates are removed within a partition
+    size_t nparts = boost::thread::hardware_concurrency();
+    if (nparts > TRIDENT_ANTIJOIN_MAXPARTITIONS) {
+        nparts = TRIDENT_ANTIJOIN_MAXPARTITIONS;
+    } else if (nparts == 0) {
+        nparts = 1;
+    }
+    std::vector<size_t> bounds;
+    bounds.push_back(0);
+    for (size_t i = 1; i < nparts; ++i) {
+        size_t b = std::max(n * i / nparts, bounds.back());
+        while (b > 0 && b < n && values[0][b] == values[0][b - 1]) {
+            b++;
+        }
+        if (b > bounds.back() && b < n) {
+            bounds.push_back(b);
+        }
+    }
+    bounds.push_back(n);
+    nparts = bounds.size() - 1;
+
+    VTuple t = l.getTuple();
+    std::vector<uint8_t> fieldToSort;
+    fieldToSort.push_back(l.getPosVars()[pos[0]]);
+    if (pos.size() == 2)
+        fieldToSort.push_back(l.getPosVars()[pos[1]]);
+
+    //Output of every partition
+    std::vector<std::vector<std::shared_ptr<ColumnWriter>>> partCols(nparts);
+    for (auto &cols : partCols) {
+        for (size_t i = 0; i < pos.size(); ++i) {
+            cols.push_back(std::shared_ptr<ColumnWriter>(new ColumnWriter()));
+        }
+    }
+
+    boost::mutex errorMutex;
+    std::exception_ptr error;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nparts, 1),
+                      ParallelAntiJoin(partitionQueriers.get(), t, fieldToSort,
+                                       pos.size(), firstCol, values, bounds,
+                                       partCols, errorMutex, error));
+    if (error) {
+        BOOST_LOG_TRIVIAL(error) << "The anti-join of a partition failed";
+        std::rethrow_exception(error);
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Anti-join of " << n << " values in " << nparts << " partitions";
+
+    //Concatenate the partitions in order
+    std::vector<std::shared_ptr<Column>> output;
+    for (size_t i = 0; i < pos.size(); ++i) {
+        if (nparts == 1) {
+            output.push_back(partCols[0][i]->getColumn());
+        } else {
+            ColumnWriter writer;
+            for (size_t p = 0; p < nparts; ++p) {
+                if (!partCols[p][i]->isEmpty()) {
+                    writer.concatenate(partCols[p][i]->getColumn().get());
+                }
+            }
+            output.push_back(writer.getColumn());
+        }
+    }
+    return output;
+}
+
 // Local
 void TridentTable::getQueryFromEDBRelation0(QSQQuery *query,
         TupleTable *outputTable) {
+    TridentQuerier *tq = getThreadQuerier();
     //No join to perform. Simply execute the query using TupleKBIterator
     VTuple tuple = query->getLiteral()->getTuple();
     TridentTupleItr itr;
-    itr.init(q, &tuple, NULL, multithreaded ? &mutex : NULL);
+    itr.init(tq->q, &tuple, NULL, getMutex(tq));
     uint64_t row[3];
     uint8_t *pos = query->getPosToCopy();
     const uint8_t npos = query->getNPosToCopy();
@@ -388,6 +626,7 @@ void TridentTable::getQueryFromEDBRelation0(QSQQuery *query,
 void TridentTable::getQueryFromEDBRelation3(QSQQuery *query,
         TupleTable *outputTable,
         std::vector<Term_t> *valuesToFilter) {
+    TridentQuerier *tq = getThreadQuerier();
     //Group by predicate
     std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>*> map;
     for (std::vector<Term_t>::iterator itr = valuesToFilter->begin();
@@ -438,19 +677,19 @@ void TridentTable::getQueryFromEDBRelation3(QSQQuery *query,
         std::vector<std::pair<uint64_t, uint64_t>> *pairs = itr->second;
         std::sort(pairs->begin(), pairs->end());
         if (multithreaded) {
-            mutex.lock();
+            tq->mutex.lock();
         }
-        ArrayItr *firstItr = q->getArrayIterator();
+        ArrayItr *firstItr = tq->q->getArrayIterator();
         std::shared_ptr<std::vector<std::pair<uint64_t, uint64_t>>> spairs = std::shared_ptr<std::vector<std::pair<uint64_t, uint64_t>>>(pairs);
         firstItr->init(spairs, -1, -1);
         firstItr->setKey(itr->first);
         p2.predicate(itr->first);
 
-        std::shared_ptr<NestedJoinPlan> plan(new NestedJoinPlan(p2, q,
+        std::shared_ptr<NestedJoinPlan> plan(new NestedJoinPlan(p2, tq->q,
                                              posToCopy, joins, posVarsToReturn));
-        NestedMergeJoinItr join(q, plan, firstItr, outputTable, LONG_MAX);
+        NestedMergeJoinItr join(tq->q, plan, firstItr, outputTable, LONG_MAX);
         if (multithreaded) {
-            mutex.unlock();
+            tq->mutex.unlock();
         }
         if (join.hasNext()) {
             //Calling hasNext() of NWayJoin should populate the entire outputTable
@@ -562,6 +801,7 @@ void TridentTable::getQueryFromEDBRelation12(VTerm s, VTerm p, VTerm o,
         std::vector<int> &posVarsToReturn,
         std::vector<std::pair<int, int>> &joins,
         std::vector<std::vector<int>> &posToCopy) {
+    TridentQuerier *tq = getThreadQuerier();
     //Sort pairs
     std::sort(pairs->begin(), pairs->end());
 
@@ -602,20 +842,20 @@ void TridentTable::getQueryFromEDBRelation12(VTerm s, VTerm p, VTerm o,
         p2.object(o.getValue());
     }
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    ArrayItr *firstItr = q->getArrayIterator();
+    ArrayItr *firstItr = tq->q->getArrayIterator();
     std::shared_ptr<std::vector<std::pair<uint64_t, uint64_t>>> spairs =
         std::shared_ptr <
         std::vector<std::pair<uint64_t, uint64_t> >> (pairs, dummydeleter);
     firstItr->init(spairs, -1, -1);
-    std::shared_ptr<NestedJoinPlan> plan(new NestedJoinPlan(p2, q, posToCopy,
+    std::shared_ptr<NestedJoinPlan> plan(new NestedJoinPlan(p2, tq->q, posToCopy,
                                          joins, posVarsToReturn));
 
     //execute the plan and copy the results in the table
-    NestedMergeJoinItr join(q, plan, firstItr, outputTable, LONG_MAX);
+    NestedMergeJoinItr join(tq->q, plan, firstItr, outputTable, LONG_MAX);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
     if (join.hasNext()) {
         //Calling hasNext() of NWayJoin should populate the entire outputTable
@@ -632,6 +872,7 @@ std::shared_ptr<Column> TridentTable::checkIn(
     const Literal &l,
     uint8_t posInL,
     size_t &sizeOutput) {
+    TridentQuerier *tq = getThreadQuerier();
 
 //Do some checks
     if (l.getNVars() == 0 || l.getNVars() == 3) {
@@ -647,7 +888,7 @@ std::shared_ptr<Column> TridentTable::checkIn(
     std::vector<uint8_t> fieldToSort;
     fieldToSort.push_back(l.getPosVars()[posInL]);
     TridentTupleItr itr1;
-    itr1.init(q, &t, &fieldToSort, true, multithreaded ? &mutex : NULL);
+    itr1.init(tq->q, &t, &fieldToSort, true, getMutex(tq));
     PairItr *pitrO = itr1.getPhysicalIterator();
 
     NewColumnTable *pitr = (NewColumnTable*)pitrO;
@@ -705,6 +946,7 @@ std::vector<uint8_t> &posInL) {
 }
 
 size_t TridentTable::getCardinality(const Literal &query) {
+    TridentQuerier *tq = getThreadQuerier();
     const Literal *literal = &query;
     long s, p, o;
     VTerm t = literal->getTermAtPos(0);
@@ -726,11 +968,11 @@ size_t TridentTable::getCardinality(const Literal &query) {
         o = t.getValue();
     }
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    size_t result = q->getCard(s, p, o);
+    size_t result = tq->q->getCard(s, p, o);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
     if (query.getNUniqueVars() < query.getNVars()) {
         result = result / 10;   // ???
@@ -741,6 +983,7 @@ size_t TridentTable::getCardinality(const Literal &query) {
 
 //same as above
 size_t TridentTable::estimateCardinality(const Literal &query) {
+    TridentQuerier *tq = getThreadQuerier();
     const Literal *literal = &query;
     long s, p, o;
     VTerm t = literal->getTermAtPos(0);
@@ -762,11 +1005,11 @@ size_t TridentTable::estimateCardinality(const Literal &query) {
         o = t.getValue();
     }
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    size_t result = q->getCard(s, p, o);
+    size_t result = tq->q->getCard(s, p, o);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
     if (query.getNUniqueVars() < query.getNVars()) {
         result = result / 10;   // ???
@@ -778,6 +1021,7 @@ size_t TridentTable::estimateCardinality(const Literal &query) {
 bool TridentTable::isEmpty(const Literal &query,
                            std::vector<uint8_t> *posToFilter,
                            std::vector<Term_t> *valuesToFilter) {
+    TridentQuerier *tq = getThreadQuerier();
     const Literal *literal = &query;
     long s, p, o;
     VTerm t = literal->getTermAtPos(0);
@@ -815,11 +1059,11 @@ bool TridentTable::isEmpty(const Literal &query,
     }
 
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    bool retval = q->isEmpty(s, p, o);
+    bool retval = tq->q->isEmpty(s, p, o);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
     /*
     BOOST_LOG_TRIVIAL(debug) << "isEmpty, query = " << query.tostring(NULL, NULL)
@@ -831,17 +1075,21 @@ bool TridentTable::isEmpty(const Literal &query,
 
 void TridentTable::releaseIterator(EDBIterator * itr) {
     ((TridentIterator*)itr)->clear();
+    //The iterator may be released by another thread than the one that
+    //created it
+    TridentQuerier *tq = ((TridentIterator*)itr)->getOwner();
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    kbItrFactory.release((TridentIterator*)itr);
+    tq->itrFactory.release((TridentIterator*)itr);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
 }
 
 size_t TridentTable::getCardinalityColumn(const Literal &query,
         uint8_t posColumn) {
+    TridentQuerier *tq = getThreadQuerier();
     const Literal *literal = &query;
     long s, p, o;
     VTerm t = literal->getTermAtPos(0);
@@ -863,11 +1111,11 @@ size_t TridentTable::getCardinalityColumn(const Literal &query,
         o = t.getValue();
     }
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    size_t result = q->getCard(s, p, o, posColumn);
+    size_t result = tq->q->getCard(s, p, o, posColumn);
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
     // BOOST_LOG_TRIVIAL(debug) << "getCardinalityColumn, query = " << query.tostring(NULL, NULL)
     //                          << ", posColumn = " << (int) posColumn << ", result = " << result;
@@ -896,22 +1144,39 @@ void TridentTable::query(QSQQuery *query, TupleTable *outputTable,
     //                          << ", result size = " << outputTable->getNRows();
 }
 
-TridentIterator *TridentTable::getTridentIter() {
+TridentQuerier *TridentTable::getThreadQuerier() {
+    if (!multithreaded) {
+        return mainQuerier;
+    }
+    TridentQuerier *tq = threadQuerier.get();
+    if (tq == NULL) {
+        //First access from this thread
+        boost::mutex::scoped_lock lock(mutex);
+        tq = new TridentQuerier(kb->query());
+        queriers.push_back(tq);
+        threadQuerier.reset(tq);
+    }
+    return tq;
+}
+
+TridentIterator *TridentTable::getTridentIter(TridentQuerier *tq) {
     if (multithreaded) {
-        mutex.lock();
+        tq->mutex.lock();
     }
-    TridentIterator *retval = kbItrFactory.get();
+    TridentIterator *retval = tq->itrFactory.get();
     if (multithreaded) {
-        mutex.unlock();
+        tq->mutex.unlock();
     }
+    retval->setOwner(tq);
     return retval;
 }
 
 EDBIterator *TridentTable::getIterator(const Literal &query) {
     const Literal *literal = &query;
     // BOOST_LOG_TRIVIAL(debug) << "Get iterator for query " << literal->tostring(NULL, NULL);
-    TridentIterator *itr = getTridentIter();
-    itr->init(query.getPredicate().getId(), q, *literal, multithreaded ? &mutex : NULL);
+    TridentQuerier *tq = getThreadQuerier();
+    TridentIterator *itr = getTridentIter(tq);
+    itr->init(query.getPredicate().getId(), tq->q, *literal, getMutex(tq));
     return itr;
 }
 
@@ -919,11 +1184,23 @@ EDBIterator *TridentTable::getSortedIterator(const Literal &query,
         const std::vector<uint8_t> &fields) {
     const Literal *literal = &query;
     // BOOST_LOG_TRIVIAL(debug) << "Get sorted iterator for query " << literal->tostring(NULL, NULL);
-    TridentIterator *itr = getTridentIter();
-    itr->init(query.getPredicate().getId(), q, *literal, fields, multithreaded ? &mutex : NULL);
+    TridentQuerier *tq = getThreadQuerier();
+    TridentIterator *itr = getTridentIter(tq);
+    itr->init(query.getPredicate().getId(), tq->q, *literal, fields, getMutex(tq));
     return itr;
 }
 
+EDBIterator *TridentTable::getPrefetchingIterator(const Literal &query,
+        const std::vector<uint8_t> *fields) {
+    if (!multithreaded) {
+        return NULL;
+    }
+    EDBIterator *itr = fields == NULL ? getIterator(query) :
+                       getSortedIterator(query, *fields);
+    return new PrefetchingEDBIterator(itr, query.getPredicate().getId(),
+                                      query.getTupleSize());
+}
+
 bool TridentTable::getDictNumber(const char *text, const size_t sizeText,
                                  uint64_t &id) {
     return dict->getNumber(text, sizeText, (nTerm*)&id);
@@ -936,3 +1213,17 @@ bool TridentTable::getDictText(const uint64_t id, char *text) {
 uint64_t TridentTable::getNTerms() {
     return kb->getNTerms();
 }
+
+TridentTable::~TridentTable() {
+    partitionQueriers.reset();
+    threadQuerier.reset();
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        for (auto tq : queriers) {
+            delete tq;
+        }
+        queriers.clear();
+    }
+    delete mainQuerier;
+    delete kb;
+}